@@ -0,0 +1,162 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Command line tool to query binary log segments, e.g.:
+//   slog_binlog --call_site=12 --format=text /tmp/slog.*.slogseg
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "slog_cc/analysis_tools/binlog/slog_binlog_reader.h"
+#include "slog_cc/printer/printer.h"
+#include "slog_cc/util/string_util.h"
+
+namespace {
+
+constexpr char kUsage[] =
+    "Usage: slog_binlog [options] <segment files>\n"
+    "Prints records of binary log segments matching all given filters.\n"
+    "  --from_ns=<ns>     skip records with global time before <ns>\n"
+    "  --to_ns=<ns>       skip records with global time after <ns>\n"
+    "  --call_site=<id>   print records of one call site only\n"
+    "  --format=<format>  json (default), text or count\n"
+    "  --info             print a summary of segments instead of records\n"
+    "  --write_index      save the index of each segment next to it, so\n"
+    "                     next queries don't have to scan the segment\n";
+
+const char* blockStatusName(slog::SlogBlockStatus status) {
+  switch (status) {
+    case slog::SlogBlockStatus::kOk:
+      return "ok";
+    case slog::SlogBlockStatus::kEnd:
+      return "complete";
+    case slog::SlogBlockStatus::kTruncated:
+      return "truncated";
+    case slog::SlogBlockStatus::kCorrupted:
+      return "corrupted";
+  }
+  return "unknown";
+}
+
+void printInfo(slog::SlogLogReader* reader) {
+  for (size_t i = 0; i < reader->numSegments(); ++i) {
+    const slog::SlogSegmentReader& segment = reader->segment(i);
+    const auto& index = segment.index();
+    std::cout << segment.path() << ": sequence " << segment.header().sequence
+              << ", " << index.size() << " blocks, " << segment.numRecords()
+              << " records, " << segment.dictionary().numCallSites()
+              << " call sites, " << blockStatusName(segment.tailStatus())
+              << (segment.indexLoaded() ? ", index loaded" : "");
+    int64_t min_global_ns = 0;
+    int64_t max_global_ns = 0;
+    bool has_records = false;
+    for (const auto& entry : index) {
+      if (entry.num_records == 0) {
+        continue;
+      }
+      min_global_ns =
+          has_records ? std::min(min_global_ns, entry.min_global_ns)
+                      : entry.min_global_ns;
+      max_global_ns =
+          has_records ? std::max(max_global_ns, entry.max_global_ns)
+                      : entry.max_global_ns;
+      has_records = true;
+    }
+    if (has_records) {
+      std::cout << ", global time [" << min_global_ns << ", " << max_global_ns
+                << "]";
+    }
+    std::cout << std::endl;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  slog::SlogRecordFilter filter;
+  std::string format = "json";
+  bool info = false;
+  bool write_index = false;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const std::string value = arg.substr(arg.find('=') + 1);
+    if (slog::util::startsWith(arg, "--from_ns=")) {
+      filter.min_global_ns = std::strtoll(value.c_str(), nullptr, 10);
+    } else if (slog::util::startsWith(arg, "--to_ns=")) {
+      filter.max_global_ns = std::strtoll(value.c_str(), nullptr, 10);
+    } else if (slog::util::startsWith(arg, "--call_site=")) {
+      filter.call_site_id = std::strtol(value.c_str(), nullptr, 10);
+    } else if (slog::util::startsWith(arg, "--format=")) {
+      format = value;
+    } else if (arg == "--info") {
+      info = true;
+    } else if (arg == "--write_index") {
+      write_index = true;
+    } else if (slog::util::startsWith(arg, "--")) {
+      std::cerr << "Unknown option " << arg << "\n" << kUsage;
+      return 1;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.empty() ||
+      (format != "json" && format != "text" && format != "count")) {
+    std::cerr << kUsage;
+    return 1;
+  }
+
+  slog::SlogLogReader reader;
+  if (!reader.open(paths)) {
+    std::cerr << "Failed to open segments." << std::endl;
+    return 1;
+  }
+  if (write_index) {
+    for (size_t i = 0; i < reader.numSegments(); ++i) {
+      if (!reader.segment(i).saveIndex()) {
+        std::cerr << "Failed to save index of " << reader.segment(i).path()
+                  << std::endl;
+      }
+    }
+  }
+  if (info) {
+    printInfo(&reader);
+    return 0;
+  }
+
+  const slog::SlogPrinter printer;
+  const slog::SlogCallSite unknown_call_site("?", "?", 0);
+  size_t count = 0;
+  auto range = reader.query(filter);
+  for (auto it = range.begin(); it != range.end(); ++it) {
+    ++count;
+    if (format == "json") {
+      std::cout << printer.jsonString(it->toRecord()) << "\n";
+    } else if (format == "text") {
+      const slog::SlogCallSite* call_site =
+          it.segment().callSite(it->call_site_id());
+      std::cout << printer.stderrLine(it->toRecord(), call_site != nullptr
+                                                          ? *call_site
+                                                          : unknown_call_site)
+                << "\n";
+    }
+  }
+  if (format == "count") {
+    std::cout << count << std::endl;
+  }
+  return 0;
+}
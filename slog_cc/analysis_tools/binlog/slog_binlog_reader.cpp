@@ -0,0 +1,437 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/analysis_tools/binlog/slog_binlog_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "slog_cc/util/crc32c.h"
+#include "slog_cc/util/varint.h"
+
+namespace slog {
+
+namespace {
+
+// Layout of the index sidecar file:
+//
+//   char[8] kIndexMagic
+//   u32     format version (kIndexVersion)
+//   u32     CRC-32C of everything after this field
+//   i64     segment sequence number, i64 segment creation time, unix ns
+//   varint  size of the segment prefix covered by the index
+//   varint  number of call sites, each: varint id, varint line,
+//           string function, string file
+//   varint  number of keys, each: string
+//   varint  number of blocks, each: varint offset delta, varint num_records,
+//           zigzag min_elapsed_ns, varint elapsed span, zigzag min_global_ns,
+//           varint global span, varint number of call sites, varint deltas of
+//           sorted call site IDs
+//
+// A segment that grew after the index was saved keeps the index of its prefix,
+// only the new blocks are scanned.
+constexpr char kIndexMagic[8] = {'S', 'L', 'O', 'G', 'I', 'D', 'X', 0};
+constexpr uint32_t kIndexVersion = 1;
+constexpr size_t kIndexPreambleSize = 16;
+
+bool readString(const char** pos, const char* end, std::string* value) {
+  const char* data = nullptr;
+  size_t size = 0;
+  if (!util::readLengthPrefixed(pos, end, &data, &size)) {
+    return false;
+  }
+  value->assign(data, size);
+  return true;
+}
+
+void appendString(const std::string& value, std::string* out) {
+  util::appendLengthPrefixed(value.data(), value.size(), out);
+}
+
+}  // namespace
+
+SlogMappedFile::~SlogMappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+bool SlogMappedFile::open(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      size_ = 0;
+      return false;
+    }
+    // Queries mostly scan blocks forward.
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(data);
+  }
+  close(fd);
+  return true;
+}
+
+bool SlogRecordFilter::matchesBlock(const SlogBlockIndexEntry& block) const {
+  if (block.num_records == 0 || block.max_global_ns < min_global_ns ||
+      block.min_global_ns > max_global_ns) {
+    return false;
+  }
+  return call_site_id < 0 ||
+         std::binary_search(block.call_site_ids.begin(),
+                            block.call_site_ids.end(), call_site_id);
+}
+
+bool SlogRecordFilter::matches(const SlogRecordView& record) const {
+  return record.time().global_ns >= min_global_ns &&
+         record.time().global_ns <= max_global_ns &&
+         (call_site_id < 0 || record.call_site_id() == call_site_id);
+}
+
+bool SlogSegmentReader::open(const std::string& path) {
+  path_ = path;
+  if (!file_.open(path) ||
+      !parseSegmentHeader(file_.data(), file_.size(), &header_)) {
+    return false;
+  }
+  index_loaded_ = loadIndex();
+  if (!index_loaded_) {
+    index_.clear();
+    decoder_.reset();
+  }
+  return buildIndex();
+}
+
+bool SlogSegmentReader::buildIndex() {
+  const char* const begin = file_.data();
+  const char* pos = begin + kSlogSegmentHeaderSize;
+  if (!index_.empty()) {
+    // Continue after the last indexed block.
+    const SlogBlockIndexEntry& last = index_.back();
+    const char* payload = nullptr;
+    size_t payload_size = 0;
+    pos = begin + last.offset;
+    if (readBlock(&pos, begin + file_.size(), &payload, &payload_size) !=
+        SlogBlockStatus::kOk) {
+      return false;
+    }
+  }
+  const char* const end = begin + file_.size();
+  const char* payload = nullptr;
+  size_t payload_size = 0;
+  SlogDecodedBatch batch;
+  while (true) {
+    const char* block_start = pos;
+    tail_status_ = readBlock(&pos, end, &payload, &payload_size);
+    if (tail_status_ != SlogBlockStatus::kOk) {
+      break;
+    }
+    size_t consumed = 0;
+    if (!decoder_.decodeBatch(payload, payload_size, &batch, &consumed)) {
+      pos = block_start;
+      tail_status_ = SlogBlockStatus::kCorrupted;
+      break;
+    }
+    SlogBlockIndexEntry entry;
+    entry.offset = block_start - begin;
+    entry.num_records = batch.records.size();
+    for (size_t i = 0; i < batch.records.size(); ++i) {
+      const SlogTimestamps& time = batch.records[i].time();
+      if (i == 0) {
+        entry.min_elapsed_ns = entry.max_elapsed_ns = time.elapsed_ns;
+        entry.min_global_ns = entry.max_global_ns = time.global_ns;
+      } else {
+        entry.min_elapsed_ns = std::min(entry.min_elapsed_ns, time.elapsed_ns);
+        entry.max_elapsed_ns = std::max(entry.max_elapsed_ns, time.elapsed_ns);
+        entry.min_global_ns = std::min(entry.min_global_ns, time.global_ns);
+        entry.max_global_ns = std::max(entry.max_global_ns, time.global_ns);
+      }
+      entry.call_site_ids.push_back(batch.records[i].call_site_id());
+    }
+    std::sort(entry.call_site_ids.begin(), entry.call_site_ids.end());
+    entry.call_site_ids.erase(
+        std::unique(entry.call_site_ids.begin(), entry.call_site_ids.end()),
+        entry.call_site_ids.end());
+    index_.emplace_back(std::move(entry));
+  }
+  return true;
+}
+
+bool SlogSegmentReader::loadIndex() {
+  SlogMappedFile file;
+  if (!file.open(indexPath(path_)) || file.size() < kIndexPreambleSize ||
+      memcmp(file.data(), kIndexMagic, sizeof(kIndexMagic)) != 0) {
+    return false;
+  }
+  const char* pos = file.data() + sizeof(kIndexMagic);
+  const char* const end = file.data() + file.size();
+  uint32_t version = 0;
+  uint32_t crc = 0;
+  util::readFixed(&pos, end, &version);
+  util::readFixed(&pos, end, &crc);
+  if (version != kIndexVersion || util::crc32c(pos, end - pos) != crc) {
+    return false;
+  }
+
+  int64_t sequence = 0;
+  int64_t created_unix_ns = 0;
+  uint64_t covered_size = 0;
+  uint64_t num_call_sites = 0;
+  if (!util::readFixed(&pos, end, &sequence) ||
+      !util::readFixed(&pos, end, &created_unix_ns) ||
+      !util::readVarint(&pos, end, &covered_size) ||
+      sequence != header_.sequence ||
+      created_unix_ns != header_.created_unix_ns ||
+      covered_size > file_.size() ||
+      !util::readVarint(&pos, end, &num_call_sites)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < num_call_sites; ++i) {
+    uint64_t id = 0;
+    uint64_t line = 0;
+    std::string function;
+    std::string file_name;
+    if (!util::readVarint(&pos, end, &id) ||
+        !util::readVarint(&pos, end, &line) ||
+        !readString(&pos, end, &function) ||
+        !readString(&pos, end, &file_name)) {
+      return false;
+    }
+    decoder_.addCallSite(static_cast<int32_t>(id),
+                         SlogCallSite(function, file_name, line));
+  }
+  uint64_t num_keys = 0;
+  if (!util::readVarint(&pos, end, &num_keys)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < num_keys; ++i) {
+    std::string key;
+    if (!readString(&pos, end, &key)) {
+      return false;
+    }
+    decoder_.addKey(key);
+  }
+
+  uint64_t num_blocks = 0;
+  if (!util::readVarint(&pos, end, &num_blocks) ||
+      num_blocks > static_cast<uint64_t>(end - pos)) {
+    return false;
+  }
+  index_.resize(num_blocks);
+  uint64_t offset = 0;
+  for (SlogBlockIndexEntry& entry : index_) {
+    uint64_t offset_delta = 0;
+    uint64_t num_records = 0;
+    uint64_t min_elapsed = 0;
+    uint64_t elapsed_span = 0;
+    uint64_t min_global = 0;
+    uint64_t global_span = 0;
+    uint64_t num_entry_call_sites = 0;
+    if (!util::readVarint(&pos, end, &offset_delta) ||
+        !util::readVarint(&pos, end, &num_records) ||
+        !util::readVarint(&pos, end, &min_elapsed) ||
+        !util::readVarint(&pos, end, &elapsed_span) ||
+        !util::readVarint(&pos, end, &min_global) ||
+        !util::readVarint(&pos, end, &global_span) ||
+        !util::readVarint(&pos, end, &num_entry_call_sites) ||
+        num_entry_call_sites > static_cast<uint64_t>(end - pos)) {
+      return false;
+    }
+    offset += offset_delta;
+    entry.offset = offset;
+    entry.num_records = num_records;
+    entry.min_elapsed_ns = util::zigzagDecode(min_elapsed);
+    entry.max_elapsed_ns = entry.min_elapsed_ns + elapsed_span;
+    entry.min_global_ns = util::zigzagDecode(min_global);
+    entry.max_global_ns = entry.min_global_ns + global_span;
+    uint64_t call_site_id = 0;
+    for (uint64_t i = 0; i < num_entry_call_sites; ++i) {
+      uint64_t delta = 0;
+      if (!util::readVarint(&pos, end, &delta)) {
+        return false;
+      }
+      call_site_id += delta;
+      entry.call_site_ids.push_back(static_cast<int32_t>(call_site_id));
+    }
+  }
+  return pos == end && (index_.empty() || index_.back().offset < covered_size);
+}
+
+bool SlogSegmentReader::saveIndex() const {
+  std::string body;
+  util::appendFixed(header_.sequence, &body);
+  util::appendFixed(header_.created_unix_ns, &body);
+  uint64_t covered_size = kSlogSegmentHeaderSize;
+  if (!index_.empty()) {
+    const char* pos = file_.data() + index_.back().offset;
+    const char* payload = nullptr;
+    size_t payload_size = 0;
+    readBlock(&pos, file_.data() + file_.size(), &payload, &payload_size);
+    covered_size = pos - file_.data();
+  }
+  util::appendVarint(covered_size, &body);
+
+  std::vector<int32_t> call_site_ids;
+  for (size_t id = 0; id < decoder_.numCallSites(); ++id) {
+    if (decoder_.callSite(id) != nullptr) {
+      call_site_ids.push_back(id);
+    }
+  }
+  util::appendVarint(call_site_ids.size(), &body);
+  for (int32_t id : call_site_ids) {
+    const SlogCallSite* call_site = decoder_.callSite(id);
+    util::appendVarint(id, &body);
+    util::appendVarint(call_site->line(), &body);
+    appendString(call_site->function(), &body);
+    appendString(call_site->file(), &body);
+  }
+  util::appendVarint(decoder_.numKeys(), &body);
+  for (size_t i = 0; i < decoder_.numKeys(); ++i) {
+    appendString(decoder_.key(i), &body);
+  }
+
+  util::appendVarint(index_.size(), &body);
+  uint64_t offset = 0;
+  for (const SlogBlockIndexEntry& entry : index_) {
+    util::appendVarint(entry.offset - offset, &body);
+    offset = entry.offset;
+    util::appendVarint(entry.num_records, &body);
+    util::appendVarint(util::zigzagEncode(entry.min_elapsed_ns), &body);
+    util::appendVarint(entry.max_elapsed_ns - entry.min_elapsed_ns, &body);
+    util::appendVarint(util::zigzagEncode(entry.min_global_ns), &body);
+    util::appendVarint(entry.max_global_ns - entry.min_global_ns, &body);
+    util::appendVarint(entry.call_site_ids.size(), &body);
+    int32_t prev_id = 0;
+    for (int32_t id : entry.call_site_ids) {
+      util::appendVarint(id - prev_id, &body);
+      prev_id = id;
+    }
+  }
+
+  std::string data(kIndexMagic, sizeof(kIndexMagic));
+  util::appendFixed(kIndexVersion, &data);
+  util::appendFixed(util::crc32c(body.data(), body.size()), &data);
+  data += body;
+
+  // Write to a temporary file and rename it, so readers never see a partial
+  // index.
+  const std::string path = indexPath(path_);
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+    if (!file.good()) {
+      return false;
+    }
+  }
+  return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+size_t SlogSegmentReader::numRecords() const {
+  size_t num_records = 0;
+  for (const SlogBlockIndexEntry& entry : index_) {
+    num_records += entry.num_records;
+  }
+  return num_records;
+}
+
+bool SlogSegmentReader::decodeBlock(size_t block_index,
+                                    SlogDecodedBatch* batch) {
+  return decodeBlock(block_index, &decoder_, batch);
+}
+
+bool SlogSegmentReader::decodeBlock(size_t block_index,
+                                    SlogRecordDecoder* decoder,
+                                    SlogDecodedBatch* batch) const {
+  const char* pos = file_.data() + index_[block_index].offset;
+  const char* payload = nullptr;
+  size_t payload_size = 0;
+  size_t consumed = 0;
+  return readBlock(&pos, file_.data() + file_.size(), &payload,
+                   &payload_size) == SlogBlockStatus::kOk &&
+         decoder->decodeBatch(payload, payload_size, batch, &consumed);
+}
+
+bool SlogLogReader::open(const std::vector<std::string>& paths) {
+  segments_.clear();
+  for (const std::string& path : paths) {
+    segments_.emplace_back(new SlogSegmentReader());
+    if (!segments_.back()->open(path)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+SlogLogReader::Iterator::Iterator(SlogLogReader* reader,
+                                  const SlogRecordFilter& filter,
+                                  size_t segment_index)
+    : reader_(reader), filter_(filter), segment_index_(segment_index) {
+  settle();
+}
+
+SlogLogReader::Iterator& SlogLogReader::Iterator::operator++() {
+  ++record_index_;
+  settle();
+  return *this;
+}
+
+void SlogLogReader::Iterator::settle() {
+  while (segment_index_ < reader_->segments_.size()) {
+    SlogSegmentReader& segment = *reader_->segments_[segment_index_];
+    const auto& index = segment.index();
+    while (block_index_ < index.size()) {
+      if (!block_decoded_) {
+        if (!filter_.matchesBlock(index[block_index_]) ||
+            !segment.decodeBlock(block_index_, &batch_)) {
+          ++block_index_;
+          continue;
+        }
+        block_decoded_ = true;
+        record_index_ = 0;
+      }
+      for (; record_index_ < batch_.records.size(); ++record_index_) {
+        if (filter_.matches(batch_.records[record_index_])) {
+          return;
+        }
+      }
+      block_decoded_ = false;
+      ++block_index_;
+    }
+    ++segment_index_;
+    block_index_ = 0;
+  }
+  // The end iterator.
+  block_index_ = 0;
+  record_index_ = 0;
+}
+
+}  // namespace slog
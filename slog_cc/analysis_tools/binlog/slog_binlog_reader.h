@@ -0,0 +1,223 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_analysis_tools_binlog_slog_binlog_reader
+#define slog_cc_analysis_tools_binlog_slog_binlog_reader
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "slog_cc/codec/codec.h"
+#include "slog_cc/codec/segment.h"
+
+namespace slog {
+
+// Read-only memory mapping of a whole file.
+class SlogMappedFile {
+ public:
+  SlogMappedFile() = default;
+  ~SlogMappedFile();
+  SlogMappedFile(const SlogMappedFile&) = delete;
+  SlogMappedFile& operator=(const SlogMappedFile&) = delete;
+
+  // Returns false if the file can't be opened or mapped. Empty files are
+  // mapped successfully with data() == nullptr.
+  bool open(const std::string& path);
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Summary of one block of a segment. The index has one entry per block, so it
+// is small compared to the data and lets queries skip blocks without touching
+// their pages.
+struct SlogBlockIndexEntry {
+  // Offset of the block header from the beginning of the segment file.
+  uint64_t offset = 0;
+  uint32_t num_records = 0;
+  int64_t min_elapsed_ns = 0;
+  int64_t max_elapsed_ns = 0;
+  int64_t min_global_ns = 0;
+  int64_t max_global_ns = 0;
+  // Sorted distinct call sites of the records in the block.
+  std::vector<int32_t> call_site_ids;
+};
+
+// Selects records for a query. Times are inclusive and refer to
+// SlogTimestamps::global_ns, which is comparable between processes.
+struct SlogRecordFilter {
+  int64_t min_global_ns = std::numeric_limits<int64_t>::min();
+  int64_t max_global_ns = std::numeric_limits<int64_t>::max();
+  // -1 selects all call sites.
+  int32_t call_site_id = -1;
+
+  bool matchesBlock(const SlogBlockIndexEntry& block) const;
+  bool matches(const SlogRecordView& record) const;
+};
+
+// Reads one segment file written by SlogSegmentWriter. The file is mapped into
+// memory and decoded records reference the mapping directly.
+//
+// A sparse index is built by a single pass over the segment on open, or loaded
+// from the `<segment>.idx` sidecar file written by saveIndex(). The index also
+// keeps the complete call site and key dictionary of the segment, so any block
+// can be decoded without reading the blocks before it.
+class SlogSegmentReader {
+ public:
+  // Returns false if the file can't be mapped or is not a segment. A torn or
+  // corrupted tail is not an error: blocks before it are readable and
+  // tailStatus() reports what stopped the scan.
+  bool open(const std::string& path);
+
+  // Writes the index next to the segment, returns false on I/O errors.
+  bool saveIndex() const;
+
+  static std::string indexPath(const std::string& segment_path) {
+    return segment_path + ".idx";
+  }
+
+  SLOG_INLINE const std::string& path() const { return path_; }
+  SLOG_INLINE const SlogSegmentHeader& header() const { return header_; }
+  SLOG_INLINE const std::vector<SlogBlockIndexEntry>& index() const {
+    return index_;
+  }
+  SLOG_INLINE bool indexLoaded() const { return index_loaded_; }
+  SLOG_INLINE SlogBlockStatus tailStatus() const { return tail_status_; }
+  size_t numRecords() const;
+
+  // Returns nullptr for unknown call sites.
+  SLOG_INLINE const SlogCallSite* callSite(int32_t call_site_id) const {
+    return decoder_.callSite(call_site_id);
+  }
+  SLOG_INLINE const SlogRecordDecoder& dictionary() const { return decoder_; }
+
+  // Decodes the block `block_index` of index(). Views in `batch` stay valid
+  // while the reader is alive.
+  bool decodeBlock(size_t block_index, SlogDecodedBatch* batch);
+  // Same using a given decoder, e.g. a per-thread copy of dictionary() to
+  // decode blocks in parallel. Key views reference `decoder`.
+  bool decodeBlock(size_t block_index, SlogRecordDecoder* decoder,
+                   SlogDecodedBatch* batch) const;
+
+ private:
+  bool buildIndex();
+  bool loadIndex();
+
+  std::string path_;
+  SlogMappedFile file_;
+  SlogSegmentHeader header_;
+  std::vector<SlogBlockIndexEntry> index_;
+  bool index_loaded_ = false;
+  SlogBlockStatus tail_status_ = SlogBlockStatus::kEnd;
+  SlogRecordDecoder decoder_;
+};
+
+// Queries records across a set of segments, e.g. all segments of one sink.
+//
+// Usage:
+//   SlogLogReader reader;
+//   reader.open(paths);
+//   SlogRecordFilter filter;
+//   filter.call_site_id = 7;
+//   for (const SlogRecordView& record : reader.query(filter)) { ... }
+class SlogLogReader {
+ public:
+  // Opens all segments, returns false if any of them fails to open.
+  bool open(const std::vector<std::string>& paths);
+
+  SLOG_INLINE size_t numSegments() const { return segments_.size(); }
+  SLOG_INLINE SlogSegmentReader& segment(size_t i) { return *segments_[i]; }
+
+  // Iterates records matching a filter in file order. Blocks are selected with
+  // the index and decoded lazily, one at a time. The iterator is move-only:
+  // record views point into its current decoded block.
+  class Iterator {
+   public:
+    Iterator(Iterator&&) = default;
+    Iterator& operator=(Iterator&&) = default;
+
+    SLOG_INLINE const SlogRecordView& operator*() const {
+      return batch_.records[record_index_];
+    }
+    SLOG_INLINE const SlogRecordView* operator->() const {
+      return &batch_.records[record_index_];
+    }
+    Iterator& operator++();
+    SLOG_INLINE bool operator==(const Iterator& other) const {
+      return segment_index_ == other.segment_index_ &&
+             block_index_ == other.block_index_ &&
+             record_index_ == other.record_index_;
+    }
+    SLOG_INLINE bool operator!=(const Iterator& other) const {
+      return !(*this == other);
+    }
+
+    // The segment of the current record, e.g. to resolve its call site.
+    SLOG_INLINE const SlogSegmentReader& segment() const {
+      return reader_->segment(segment_index_);
+    }
+
+   private:
+    friend class SlogLogReader;
+    Iterator(SlogLogReader* reader, const SlogRecordFilter& filter,
+             size_t segment_index);
+    // Moves to the first matching record at or after the current position.
+    void settle();
+
+    SlogLogReader* reader_;
+    SlogRecordFilter filter_;
+    size_t segment_index_;
+    size_t block_index_ = 0;
+    size_t record_index_ = 0;
+    bool block_decoded_ = false;
+    SlogDecodedBatch batch_;
+  };
+
+  class Range {
+   public:
+    SLOG_INLINE Iterator begin() const {
+      return Iterator(reader_, filter_, 0);
+    }
+    SLOG_INLINE Iterator end() const {
+      return Iterator(reader_, filter_, reader_->segments_.size());
+    }
+
+   private:
+    friend class SlogLogReader;
+    Range(SlogLogReader* reader, const SlogRecordFilter& filter)
+        : reader_(reader), filter_(filter) {}
+
+    SlogLogReader* reader_;
+    SlogRecordFilter filter_;
+  };
+
+  SLOG_INLINE Range query(const SlogRecordFilter& filter) {
+    return Range(this, filter);
+  }
+
+ private:
+  std::vector<std::unique_ptr<SlogSegmentReader>> segments_;
+};
+
+}  // namespace slog
+
+#endif
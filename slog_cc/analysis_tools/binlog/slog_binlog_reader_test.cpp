@@ -0,0 +1,190 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/analysis_tools/binlog/slog_binlog_reader.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/sinks/binary_file_sink.h"
+
+namespace slog {
+
+namespace {
+
+constexpr int kNumBatches = 50;
+constexpr int kBatchSize = 20;
+constexpr int64_t kBaseGlobalNs = 1600000000000000000;
+// Only records of one batch use this call site.
+constexpr int32_t kRareCallSiteId = 7;
+constexpr int kRareBatch = 31;
+
+SlogCallSite lookupCallSite(int32_t id) {
+  return SlogCallSite("func" + std::to_string(id), "dir/file.cpp", id * 10);
+}
+
+}  // namespace
+
+class SlogBinlogReaderTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    char dir_template[] = "/tmp/slog_binlog_reader_test.XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir_template));
+    options_.directory = dir_template;
+    options_.file_prefix = "test";
+
+    // Closed by the destructor rather than flush(), which would pad the end
+    // of the segment.
+    std::unique_ptr<SlogSegmentWriter> writer(new SlogSegmentWriter(options_));
+    int64_t i = 0;
+    for (int batch_index = 0; batch_index < kNumBatches; ++batch_index) {
+      std::vector<SlogRecord> records;
+      for (int j = 0; j < kBatchSize; ++j, ++i) {
+        const int32_t call_site_id =
+            batch_index == kRareBatch ? kRareCallSiteId : 1 + i % 5;
+        SlogRecord record(/*thread_id=*/1, call_site_id, INFO);
+        record.set_time(SlogTimestamps{i * 1000, kBaseGlobalNs + i * 1000,
+                                       SlogGlobalClockTypeId::kWallTimeClock});
+        record.addTag("i", i);
+        record.addTag("name", "record" + std::to_string(i));
+        records.emplace_back(std::move(record));
+      }
+      writer->write(records, lookupCallSite, kRareCallSiteId + 1);
+    }
+    writer.reset();
+    segments_ = SlogSegmentWriter(options_).listSegments();
+    ASSERT_EQ(1, segments_.size());
+  }
+
+  void TearDown() override {
+    for (const auto& path : segments_) {
+      unlink(path.c_str());
+      unlink(SlogSegmentReader::indexPath(path).c_str());
+    }
+    rmdir(options_.directory.c_str());
+  }
+
+  static std::vector<int64_t> queryValues(SlogLogReader* reader,
+                                          const SlogRecordFilter& filter) {
+    std::vector<int64_t> values;
+    for (const SlogRecordView& record : reader->query(filter)) {
+      values.push_back(record.find_tag("i")->valueInt());
+    }
+    return values;
+  }
+
+ protected:
+  SlogBinaryFileSinkOptions options_;
+  std::vector<std::string> segments_;
+};
+
+TEST_F(SlogBinlogReaderTest, index_and_queries) {
+  SlogLogReader reader;
+  ASSERT_TRUE(reader.open(segments_));
+  const SlogSegmentReader& segment = reader.segment(0);
+  EXPECT_FALSE(segment.indexLoaded());
+  EXPECT_EQ(SlogBlockStatus::kEnd, segment.tailStatus());
+  // A dictionary block and one block per batch.
+  ASSERT_EQ(kNumBatches + 1, segment.index().size());
+  EXPECT_EQ(kNumBatches * kBatchSize, segment.numRecords());
+
+  const auto all = queryValues(&reader, SlogRecordFilter());
+  ASSERT_EQ(kNumBatches * kBatchSize, all.size());
+  for (size_t i = 0; i < all.size(); ++i) {
+    ASSERT_EQ(i, all[i]);
+  }
+
+  // The time range crosses block boundaries.
+  SlogRecordFilter time_filter;
+  time_filter.min_global_ns = kBaseGlobalNs + 15 * 1000;
+  time_filter.max_global_ns = kBaseGlobalNs + 64 * 1000;
+  const auto in_range = queryValues(&reader, time_filter);
+  ASSERT_EQ(50, in_range.size());
+  EXPECT_EQ(15, in_range.front());
+  EXPECT_EQ(64, in_range.back());
+
+  // Only one block contains the call site.
+  SlogRecordFilter call_site_filter;
+  call_site_filter.call_site_id = kRareCallSiteId;
+  int num_blocks = 0;
+  for (const auto& entry : segment.index()) {
+    num_blocks += call_site_filter.matchesBlock(entry);
+  }
+  EXPECT_EQ(1, num_blocks);
+  const auto rare = queryValues(&reader, call_site_filter);
+  ASSERT_EQ(kBatchSize, rare.size());
+  EXPECT_EQ(kRareBatch * kBatchSize, rare.front());
+
+  // Decoded records reference the dictionary of the segment.
+  auto range = reader.query(call_site_filter);
+  auto it = range.begin();
+  ASSERT_NE(nullptr, it.segment().callSite(it->call_site_id()));
+  EXPECT_EQ("func7", it.segment().callSite(it->call_site_id())->function());
+  EXPECT_EQ("record620", it->find_tag("name")->valueString().str());
+}
+
+TEST_F(SlogBinlogReaderTest, saved_index) {
+  {
+    SlogSegmentReader segment;
+    ASSERT_TRUE(segment.open(segments_[0]));
+    ASSERT_TRUE(segment.saveIndex());
+  }
+  SlogLogReader reader;
+  ASSERT_TRUE(reader.open(segments_));
+  EXPECT_TRUE(reader.segment(0).indexLoaded());
+  ASSERT_EQ(kNumBatches + 1, reader.segment(0).index().size());
+
+  SlogRecordFilter filter;
+  filter.call_site_id = kRareCallSiteId;
+  filter.max_global_ns = kBaseGlobalNs + (kRareBatch * kBatchSize + 4) * 1000;
+  const auto values = queryValues(&reader, filter);
+  ASSERT_EQ(5, values.size());
+  EXPECT_EQ(kRareBatch * kBatchSize, values.front());
+  EXPECT_EQ("func7", reader.segment(0).callSite(kRareCallSiteId)->function());
+}
+
+TEST_F(SlogBinlogReaderTest, truncated_segment) {
+  std::string data;
+  {
+    std::ifstream file(segments_[0], std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    data = content.str();
+  }
+  {
+    SlogSegmentReader segment;
+    ASSERT_TRUE(segment.open(segments_[0]));
+    ASSERT_TRUE(segment.saveIndex());
+  }
+  // A torn last block, the saved index covers the whole segment.
+  {
+    std::ofstream file(segments_[0], std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size() - 5);
+  }
+  SlogSegmentReader segment;
+  ASSERT_TRUE(segment.open(segments_[0]));
+  EXPECT_FALSE(segment.indexLoaded());
+  EXPECT_EQ(SlogBlockStatus::kTruncated, segment.tailStatus());
+  EXPECT_EQ((kNumBatches - 1) * kBatchSize, segment.numRecords());
+}
+
+}  // namespace slog
@@ -0,0 +1,128 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Command line tool printing the live stream of a SlogSocketSink, e.g.:
+//   slog_stream --socket=/tmp/slog.sock --format=text
+
+#include <signal.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "slog_cc/analysis_tools/stream/slog_stream_reader.h"
+#include "slog_cc/printer/printer.h"
+#include "slog_cc/util/string_util.h"
+
+namespace {
+
+constexpr char kUsage[] =
+    "Usage: slog_stream [options]\n"
+    "Listens on a Unix domain socket and prints records streamed to it.\n"
+    "  --socket=<path>    socket to listen on, /tmp/slog.sock by default\n"
+    "  --format=<format>  json (default), text or count\n"
+    "  --output=<file>    also save each stream as a segment file, the\n"
+    "                     connection number is appended to the name\n"
+    "  --max_records=<n>  exit after <n> records\n";
+
+std::atomic<bool> g_stop{false};
+
+void handleSignal(int) { g_stop = true; }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string socket_path = "/tmp/slog.sock";
+  std::string format = "json";
+  std::string output;
+  uint64_t max_records = 0;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const std::string value = arg.substr(arg.find('=') + 1);
+    if (slog::util::startsWith(arg, "--socket=")) {
+      socket_path = value;
+    } else if (slog::util::startsWith(arg, "--format=")) {
+      format = value;
+    } else if (slog::util::startsWith(arg, "--output=")) {
+      output = value;
+    } else if (slog::util::startsWith(arg, "--max_records=")) {
+      max_records = std::strtoull(value.c_str(), nullptr, 10);
+    } else {
+      std::cerr << kUsage;
+      return 1;
+    }
+  }
+  if (format != "json" && format != "text" && format != "count") {
+    std::cerr << kUsage;
+    return 1;
+  }
+
+  slog::SlogStreamReader reader(/*keep_stream_data=*/!output.empty());
+  if (!reader.listen(socket_path)) {
+    return 1;
+  }
+  signal(SIGINT, handleSignal);
+  signal(SIGTERM, handleSignal);
+
+  const slog::SlogPrinter printer;
+  const slog::SlogCallSite unknown_call_site("?", "?", 0);
+  uint64_t count = 0;
+  const auto print = [&](const slog::SlogDecodedBatch& batch,
+                         const slog::SlogRecordDecoder& decoder) {
+    for (const auto& record : batch.records) {
+      if (format == "json") {
+        std::cout << printer.jsonString(record.toRecord()) << "\n";
+      } else if (format == "text") {
+        const slog::SlogCallSite* call_site =
+            decoder.callSite(record.call_site_id());
+        std::cout << printer.stderrLine(record.toRecord(),
+                                        call_site != nullptr
+                                            ? *call_site
+                                            : unknown_call_site)
+                  << "\n";
+      }
+    }
+    count += batch.records.size();
+    std::cout.flush();
+  };
+
+  uint64_t saved_connections = 0;
+  const auto save = [&] {
+    if (output.empty() || reader.streamData().empty()) {
+      return;
+    }
+    std::ofstream file(output + "." + std::to_string(reader.numConnections()),
+                       std::ios::binary);
+    file << reader.streamData();
+    saved_connections = reader.numConnections();
+  };
+
+  while (!g_stop && (max_records == 0 || count < max_records)) {
+    const bool was_connected = reader.connected();
+    reader.poll(std::chrono::milliseconds(100), print);
+    if (was_connected && !reader.connected()) {
+      save();
+    }
+  }
+  if (reader.numConnections() != saved_connections) {
+    save();
+  }
+  if (format == "count") {
+    std::cout << count << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,163 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/analysis_tools/stream/slog_stream_reader.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "slog_cc/codec/segment.h"
+
+namespace slog {
+
+SlogStreamReader::~SlogStreamReader() {
+  if (connection_fd_ >= 0) {
+    close(connection_fd_);
+  }
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+  }
+}
+
+bool SlogStreamReader::listen(const std::string& socket_path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "slog: socket path is too long " << socket_path << std::endl;
+    return false;
+  }
+  std::memcpy(address.sun_path, socket_path.data(), socket_path.size());
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return false;
+  }
+  unlink(socket_path.c_str());
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) !=
+          0 ||
+      ::listen(fd, 4) != 0) {
+    std::cerr << "slog: failed to listen on " << socket_path << ": "
+              << std::strerror(errno) << std::endl;
+    close(fd);
+    return false;
+  }
+  socket_path_ = socket_path;
+  listen_fd_ = fd;
+  return true;
+}
+
+void SlogStreamReader::accept() {
+  const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  connection_fd_ = fd;
+  ++num_connections_;
+  data_.clear();
+  header_parsed_ = false;
+  decoded_size_ = 0;
+  decoder_.reset();
+}
+
+void SlogStreamReader::disconnect() {
+  close(connection_fd_);
+  connection_fd_ = -1;
+}
+
+size_t SlogStreamReader::decode(const SlogStreamCallback& callback) {
+  if (!header_parsed_) {
+    if (data_.size() < kSlogSegmentHeaderSize) {
+      return 0;
+    }
+    SlogSegmentHeader header;
+    if (!parseSegmentHeader(data_.data(), data_.size(), &header)) {
+      std::cerr << "slog: stream doesn't start with a segment header"
+                << std::endl;
+      disconnect();
+      return 0;
+    }
+    header_parsed_ = true;
+    decoded_size_ = kSlogSegmentHeaderSize;
+  }
+  size_t num_records = 0;
+  const char* pos = data_.data() + decoded_size_;
+  const char* end = data_.data() + data_.size();
+  const char* payload = nullptr;
+  size_t payload_size = 0;
+  SlogBlockStatus status;
+  while ((status = readBlock(&pos, end, &payload, &payload_size)) ==
+         SlogBlockStatus::kOk) {
+    SlogDecodedBatch batch;
+    size_t consumed = 0;
+    if (!decoder_.decodeBatch(payload, payload_size, &batch, &consumed)) {
+      status = SlogBlockStatus::kCorrupted;
+      break;
+    }
+    callback(batch, decoder_);
+    num_records += batch.records.size();
+  }
+  decoded_size_ = pos - data_.data();
+  if (!keep_stream_data_) {
+    data_.erase(0, decoded_size_);
+    decoded_size_ = 0;
+  }
+  if (status == SlogBlockStatus::kCorrupted) {
+    std::cerr << "slog: corrupted stream block" << std::endl;
+    disconnect();
+  }
+  return num_records;
+}
+
+size_t SlogStreamReader::poll(std::chrono::milliseconds timeout,
+                              const SlogStreamCallback& callback) {
+  if (listen_fd_ < 0) {
+    return 0;
+  }
+  pollfd fds[1];
+  fds[0].fd = connected() ? connection_fd_ : listen_fd_;
+  fds[0].events = POLLIN;
+  if (::poll(fds, 1, static_cast<int>(timeout.count())) <= 0) {
+    return 0;
+  }
+  if (!connected()) {
+    accept();
+    return 0;
+  }
+  char buffer[64 << 10];
+  size_t num_records = 0;
+  // Drain everything available, so a busy sink doesn't need many polls.
+  while (connected()) {
+    const ssize_t size = recv(connection_fd_, buffer, sizeof(buffer),
+                              MSG_DONTWAIT);
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    if (size <= 0) {
+      disconnect();
+      break;
+    }
+    data_.append(buffer, size);
+    num_records += decode(callback);
+  }
+  return num_records;
+}
+
+}  // namespace slog
@@ -0,0 +1,84 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_analysis_tools_stream_slog_stream_reader
+#define slog_cc_analysis_tools_stream_slog_stream_reader
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "slog_cc/codec/codec.h"
+
+namespace slog {
+
+// Called for each decoded batch. The decoder resolves call sites of records,
+// views are valid only during the call.
+using SlogStreamCallback = std::function<void(
+    const SlogDecodedBatch& batch, const SlogRecordDecoder& decoder)>;
+
+// Listens on a Unix domain socket and decodes the stream of a SlogSocketSink.
+// One sink is served at a time; when it disconnects the next one is accepted.
+//
+// Usage:
+//   SlogStreamReader reader;
+//   reader.listen("/tmp/slog.sock");
+//   while (running) {
+//     reader.poll(std::chrono::milliseconds(100), callback);
+//   }
+class SlogStreamReader {
+ public:
+  // With `keep_stream_data` received bytes of the current connection are kept
+  // and available with streamData(), otherwise they are released once decoded.
+  explicit SlogStreamReader(bool keep_stream_data = false)
+      : keep_stream_data_(keep_stream_data) {}
+  ~SlogStreamReader();
+  SlogStreamReader(const SlogStreamReader&) = delete;
+  SlogStreamReader& operator=(const SlogStreamReader&) = delete;
+
+  // Replaces a stale socket file at `socket_path`.
+  bool listen(const std::string& socket_path);
+
+  // Waits up to `timeout` for a connection or data and decodes all complete
+  // blocks received. Returns the number of decoded records.
+  size_t poll(std::chrono::milliseconds timeout,
+              const SlogStreamCallback& callback);
+
+  bool connected() const { return connection_fd_ >= 0; }
+  uint64_t numConnections() const { return num_connections_; }
+  // Raw bytes of the current or last stream received so far, a valid segment
+  // up to its last complete block. Only complete with keep_stream_data.
+  const std::string& streamData() const { return data_; }
+
+ private:
+  void accept();
+  void disconnect();
+  size_t decode(const SlogStreamCallback& callback);
+
+  const bool keep_stream_data_;
+  std::string socket_path_;
+  int listen_fd_ = -1;
+  int connection_fd_ = -1;
+  uint64_t num_connections_ = 0;
+  std::string data_;
+  bool header_parsed_ = false;
+  // Offset in data_ of the next block to decode.
+  size_t decoded_size_ = 0;
+  SlogRecordDecoder decoder_;
+};
+
+}  // namespace slog
+
+#endif
@@ -0,0 +1,142 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/analysis_tools/stream/slog_stream_reader.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/codec/segment.h"
+#include "slog_cc/context/context.h"
+#include "slog_cc/sinks/socket_sink.h"
+#include "slog_cc/slog.h"
+
+namespace slog {
+
+class SlogStreamReaderTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    options_.socket_path =
+        "/tmp/slog_stream_reader_test." + std::to_string(getpid()) + ".sock";
+    options_.reconnect_interval = std::chrono::milliseconds(0);
+  }
+
+  // Polls until `num_values` values of the "i" tag are received or a timeout.
+  void receive(SlogStreamReader* reader, size_t num_values,
+               std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (values_.size() < num_values &&
+           std::chrono::steady_clock::now() < deadline) {
+      reader->poll(std::chrono::milliseconds(10),
+                   [this](const SlogDecodedBatch& batch,
+                          const SlogRecordDecoder& decoder) {
+                     for (const auto& record : batch.records) {
+                       const SlogTagView* tag = record.find_tag("i");
+                       if (tag == nullptr) {
+                         continue;
+                       }
+                       values_.push_back(tag->valueInt());
+                       const SlogCallSite* call_site =
+                           decoder.callSite(record.call_site_id());
+                       EXPECT_NE(nullptr, call_site);
+                     }
+                   });
+    }
+  }
+
+ protected:
+  SlogSocketSinkOptions options_;
+  std::vector<int64_t> values_;
+};
+
+TEST_F(SlogStreamReaderTest, stream) {
+  SlogStreamReader reader(/*keep_stream_data=*/true);
+  ASSERT_TRUE(reader.listen(options_.socket_path));
+  SlogSocketSink sink(options_, SlogContext::getInstance());
+  for (int i = 0; i < 1000; ++i) {
+    SLOG(INFO).addTag("i", i);
+  }
+  SlogContext::getInstance()->waitAsyncSubscribers();
+  EXPECT_TRUE(sink.connected());
+  receive(&reader, 1000);
+  ASSERT_EQ(1000, values_.size());
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(i, values_[i]);
+  }
+  EXPECT_EQ(1000, sink.numSentRecords());
+  EXPECT_EQ(0, sink.numDroppedRecords());
+
+  // The stream is a valid segment.
+  SlogSegmentHeader header;
+  EXPECT_TRUE(parseSegmentHeader(reader.streamData().data(),
+                                 reader.streamData().size(), &header));
+}
+
+TEST_F(SlogStreamReaderTest, reconnect) {
+  SlogSocketSink sink(options_, SlogContext::getInstance());
+  // Records are dropped while no reader is listening.
+  SLOG(INFO).addTag("i", -1);
+  SlogContext::getInstance()->waitAsyncSubscribers();
+  EXPECT_FALSE(sink.connected());
+  EXPECT_EQ(1, sink.numDroppedRecords());
+
+  for (int connection = 0; connection < 2; ++connection) {
+    SlogStreamReader reader;
+    ASSERT_TRUE(reader.listen(options_.socket_path));
+    values_.clear();
+    // The first records after a reader restarts may be lost with the broken
+    // connection; the new stream starts with the full dictionary again.
+    for (int i = 0; i < 100 && values_.empty(); ++i) {
+      SLOG(INFO).addTag("i", i);
+      SlogContext::getInstance()->waitAsyncSubscribers();
+      receive(&reader, 1, std::chrono::milliseconds(100));
+    }
+    ASSERT_FALSE(values_.empty());
+    EXPECT_EQ(1, reader.numConnections());
+  }
+  EXPECT_GT(sink.numSentRecords(), 0);
+}
+
+TEST_F(SlogStreamReaderTest, slow_reader) {
+  options_.max_pending_bytes = 4096;
+  SlogStreamReader reader;
+  ASSERT_TRUE(reader.listen(options_.socket_path));
+  constexpr int kNumRecords = 20000;
+  {
+    SlogSocketSink sink(options_, SlogContext::getInstance());
+    // Nothing is read until all records are emitted, so the socket buffer and
+    // then the pending data limit fill up.
+    for (int i = 0; i < kNumRecords; ++i) {
+      SLOG(INFO).addTag("i", i).addTag("payload", std::string(100, 'x'));
+    }
+    SlogContext::getInstance()->waitAsyncSubscribers();
+    EXPECT_GT(sink.numDroppedRecords(), 0);
+    const uint64_t num_delivered = kNumRecords - sink.numDroppedRecords();
+    // Pending data is sent when the socket drains.
+    receive(&reader, num_delivered);
+    EXPECT_EQ(num_delivered, values_.size());
+    EXPECT_EQ(num_delivered, sink.numSentRecords());
+  }
+  for (size_t i = 1; i < values_.size(); ++i) {
+    ASSERT_LT(values_[i - 1], values_[i]);
+  }
+}
+
+}  // namespace slog
@@ -0,0 +1,876 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/analysis_tools/summary/slog_summarizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "slog_cc/analysis_tools/binlog/slog_binlog_reader.h"
+#include "slog_cc/events/scope.h"
+#include "slog_cc/primitives/record.h"
+#include "slog_cc/util/string_util.h"
+
+namespace slog {
+
+namespace {
+
+// A minimal scanner for the single-line JSON objects written by slog tools.
+// Values are returned as raw spans of the input, strings with their quotes.
+struct JsonSpan {
+  const char* begin = nullptr;
+  const char* end = nullptr;
+
+  bool empty() const { return begin == end; }
+  bool equals(const char* s) const {
+    const size_t n = strlen(s);
+    return static_cast<size_t>(end - begin) == n && memcmp(begin, s, n) == 0;
+  }
+};
+
+const char* skipSpaces(const char* pos, const char* end) {
+  while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) {
+    ++pos;
+  }
+  return pos;
+}
+
+// Returns the position after the string starting at `pos`, nullptr if it is
+// not terminated.
+const char* skipString(const char* pos, const char* end) {
+  for (++pos; pos < end; ++pos) {
+    if (*pos == '\\') {
+      ++pos;
+    } else if (*pos == '"') {
+      return pos + 1;
+    }
+  }
+  return nullptr;
+}
+
+// Returns the position after the value starting at `pos`, nullptr if it is
+// malformed.
+const char* skipValue(const char* pos, const char* end) {
+  if (pos >= end) {
+    return nullptr;
+  }
+  if (*pos == '"') {
+    return skipString(pos, end);
+  }
+  if (*pos == '{' || *pos == '[') {
+    int depth = 0;
+    while (pos < end) {
+      if (*pos == '"') {
+        pos = skipString(pos, end);
+        if (pos == nullptr) {
+          return nullptr;
+        }
+        continue;
+      }
+      if (*pos == '{' || *pos == '[') {
+        ++depth;
+      } else if (*pos == '}' || *pos == ']') {
+        if (--depth == 0) {
+          return pos + 1;
+        }
+      }
+      ++pos;
+    }
+    return nullptr;
+  }
+  // Numbers and literals.
+  const char* start = pos;
+  while (pos < end && *pos != ',' && *pos != '}' && *pos != ']' &&
+         *pos != ' ') {
+    ++pos;
+  }
+  return pos == start ? nullptr : pos;
+}
+
+// Calls f(key, value) for members of the object in `span`. Returns false if
+// the object is malformed.
+template <class F>
+bool forEachMember(JsonSpan span, F f) {
+  const char* pos = skipSpaces(span.begin, span.end);
+  const char* const end = span.end;
+  if (pos >= end || *pos != '{') {
+    return false;
+  }
+  pos = skipSpaces(pos + 1, end);
+  if (pos < end && *pos == '}') {
+    return true;
+  }
+  while (pos < end && *pos == '"') {
+    const char* key_end = skipString(pos, end);
+    if (key_end == nullptr) {
+      return false;
+    }
+    const JsonSpan key{pos + 1, key_end - 1};
+    pos = skipSpaces(key_end, end);
+    if (pos >= end || *pos != ':') {
+      return false;
+    }
+    pos = skipSpaces(pos + 1, end);
+    const char* value_end = skipValue(pos, end);
+    if (value_end == nullptr) {
+      return false;
+    }
+    f(key, JsonSpan{pos, value_end});
+    pos = skipSpaces(value_end, end);
+    if (pos < end && *pos == '}') {
+      return true;
+    }
+    if (pos >= end || *pos != ',') {
+      return false;
+    }
+    pos = skipSpaces(pos + 1, end);
+  }
+  return false;
+}
+
+// Calls f(value) for elements of the array in `span`.
+template <class F>
+bool forEachElement(JsonSpan span, F f) {
+  const char* pos = skipSpaces(span.begin, span.end);
+  const char* const end = span.end;
+  if (pos >= end || *pos != '[') {
+    return false;
+  }
+  pos = skipSpaces(pos + 1, end);
+  if (pos < end && *pos == ']') {
+    return true;
+  }
+  while (pos < end) {
+    const char* value_end = skipValue(pos, end);
+    if (value_end == nullptr) {
+      return false;
+    }
+    f(JsonSpan{pos, value_end});
+    pos = skipSpaces(value_end, end);
+    if (pos < end && *pos == ']') {
+      return true;
+    }
+    if (pos >= end || *pos != ',') {
+      return false;
+    }
+    pos = skipSpaces(pos + 1, end);
+  }
+  return false;
+}
+
+// Parses the 4 hex digits of a \u escape at `pos`, -1 if they aren't.
+int32_t hexCodeUnit(const char* pos, const char* end) {
+  if (end - pos < 4) {
+    return -1;
+  }
+  int32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    const char c = pos[i];
+    value <<= 4;
+    if (c >= '0' && c <= '9') {
+      value |= c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      value |= c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      value |= c - 'A' + 10;
+    } else {
+      return -1;
+    }
+  }
+  return value;
+}
+
+void appendUtf8(uint32_t code_point, std::string* out) {
+  if (code_point < 0x80) {
+    out->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out->push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else if (code_point < 0x10000) {
+    out->push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else {
+    out->push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  }
+}
+
+// Strips quotes and resolves escapes, \u escapes into UTF-8.
+std::string jsonStringValue(JsonSpan span) {
+  if (span.end - span.begin >= 2 && *span.begin == '"') {
+    ++span.begin;
+    --span.end;
+  }
+  std::string result;
+  result.reserve(span.end - span.begin);
+  for (const char* pos = span.begin; pos < span.end; ++pos) {
+    if (*pos != '\\' || pos + 1 == span.end) {
+      result += *pos;
+      continue;
+    }
+    ++pos;
+    switch (*pos) {
+      case 'n':
+        result += '\n';
+        break;
+      case 't':
+        result += '\t';
+        break;
+      case 'r':
+        result += '\r';
+        break;
+      case 'b':
+        result += '\b';
+        break;
+      case 'f':
+        result += '\f';
+        break;
+      case 'u': {
+        int32_t code_point = hexCodeUnit(pos + 1, span.end);
+        if (code_point < 0) {
+          // Malformed, kept as is.
+          result += "\\u";
+          break;
+        }
+        pos += 4;
+        if (code_point >= 0xd800 && code_point < 0xdc00 &&
+            span.end - pos > 6 && pos[1] == '\\' && pos[2] == 'u') {
+          const int32_t low = hexCodeUnit(pos + 3, span.end);
+          if (low >= 0xdc00 && low < 0xe000) {
+            code_point = 0x10000 + ((code_point - 0xd800) << 10) +
+                         (low - 0xdc00);
+            pos += 6;
+          }
+        }
+        appendUtf8(code_point, &result);
+        break;
+      }
+      default:
+        result += *pos;
+    }
+  }
+  return result;
+}
+
+// Numbers are quoted in SlogPrinter::jsonString() and not quoted in trace
+// events, both are accepted. Copies the number to a null-terminated buffer.
+void numberText(JsonSpan span, char (&buffer)[32]) {
+  if (span.end - span.begin >= 2 && *span.begin == '"') {
+    ++span.begin;
+    --span.end;
+  }
+  const size_t n = std::min<size_t>(span.end - span.begin, sizeof(buffer) - 1);
+  memcpy(buffer, span.begin, n);
+  buffer[n] = 0;
+}
+
+double jsonDouble(JsonSpan span) {
+  char buffer[32];
+  numberText(span, buffer);
+  return std::strtod(buffer, nullptr);
+}
+
+int64_t jsonInt(JsonSpan span) {
+  char buffer[32];
+  numberText(span, buffer);
+  return std::strtoll(buffer, nullptr, 10);
+}
+
+int severityFromName(const std::string& name) {
+  static const char* const kNames[] = {"Unknown", "Debug", "Info",
+                                       "Warning", "Error", "Fatal"};
+  for (int i = 0; i < 6; ++i) {
+    if (name == kNames[i]) {
+      return i;
+    }
+  }
+  return std::atoi(name.c_str());
+}
+
+// Extracts "file:line" from a line formatted by SlogPrinter::stderrLine(), e.g.
+// "I0404 11:52:51.913633  9812 example.cc:51] message".
+std::string callSiteFromStderrLine(const std::string& line) {
+  const size_t bracket = line.find("] ");
+  if (bracket == std::string::npos) {
+    return "";
+  }
+  const size_t space = line.rfind(' ', bracket);
+  return line.substr(space == std::string::npos ? 0 : space + 1,
+                     bracket - (space == std::string::npos ? 0 : space + 1));
+}
+
+std::string callSiteLabel(const SlogCallSite* call_site,
+                          int32_t call_site_id) {
+  if (call_site == nullptr || call_site->file().empty()) {
+    return "#" + std::to_string(call_site_id);
+  }
+  return util::split(call_site->file(), '/').back() + ":" +
+         std::to_string(call_site->line());
+}
+
+struct OpenScope {
+  std::string name;
+  int64_t start_ns;
+};
+
+struct ScopeClose {
+  int32_t thread_id;
+  // -1 for trace events, which are matched by nesting.
+  int64_t scope_id;
+  int64_t end_ns;
+};
+
+// Summary of one task plus scope records it couldn't pair on its own.
+class PartialSummary {
+ public:
+  explicit PartialSummary(int64_t rate_bucket_ns)
+      : rate_bucket_ns_(rate_bucket_ns) {}
+
+  SlogSummary& summary() { return summary_; }
+
+  void addRecord(int severity, int64_t global_ns) {
+    summary_.num_records += 1;
+    summary_.severity_counts[severity] += 1;
+    const int64_t remainder =
+        (global_ns % rate_bucket_ns_ + rate_bucket_ns_) % rate_bucket_ns_;
+    summary_.rate[global_ns - remainder] += 1;
+  }
+
+  void openScope(int32_t thread_id, int64_t scope_id, std::string name,
+                 int64_t start_ns) {
+    OpenScope scope{std::move(name), start_ns};
+    if (scope_id < 0) {
+      open_stacks_[thread_id].emplace_back(std::move(scope));
+      return;
+    }
+    const auto key = std::make_pair(thread_id, scope_id);
+    auto it = open_scopes_.find(key);
+    if (it == open_scopes_.end()) {
+      open_scopes_.emplace(key, std::move(scope));
+    } else {
+      // A reused ID, e.g. records of two processes in one file.
+      summary_.num_unmatched_scopes += 1;
+      it->second = std::move(scope);
+    }
+  }
+
+  void closeScope(const ScopeClose& close) {
+    if (!matchClose(close)) {
+      unmatched_closes_.push_back(close);
+    }
+  }
+
+  // Merges a summary of the data following this one.
+  void merge(PartialSummary&& next) {
+    SlogSummary& other = next.summary_;
+    summary_.num_records += other.num_records;
+    summary_.num_malformed += other.num_malformed;
+    summary_.num_unmatched_scopes += other.num_unmatched_scopes;
+    for (const auto& item : other.severity_counts) {
+      summary_.severity_counts[item.first] += item.second;
+    }
+    for (const auto& item : other.call_site_counts) {
+      summary_.call_site_counts[item.first] += item.second;
+    }
+    for (const auto& item : other.rate) {
+      summary_.rate[item.first] += item.second;
+    }
+    for (const auto& item : other.scope_durations_ns) {
+      summary_.scope_durations_ns[item.first].merge(item.second);
+    }
+    for (const ScopeClose& close : next.unmatched_closes_) {
+      if (!matchClose(close)) {
+        summary_.num_unmatched_scopes += 1;
+      }
+    }
+    for (auto& item : next.open_scopes_) {
+      openScope(item.first.first, item.first.second,
+                std::move(item.second.name), item.second.start_ns);
+    }
+    for (auto& item : next.open_stacks_) {
+      auto& stack = open_stacks_[item.first];
+      for (auto& scope : item.second) {
+        stack.emplace_back(std::move(scope));
+      }
+    }
+  }
+
+  // Counts scopes that are still open as unmatched.
+  void finish() {
+    summary_.num_unmatched_scopes += open_scopes_.size();
+    for (const auto& item : open_stacks_) {
+      summary_.num_unmatched_scopes += item.second.size();
+    }
+    open_scopes_.clear();
+    open_stacks_.clear();
+  }
+
+ private:
+  bool matchClose(const ScopeClose& close) {
+    if (close.scope_id < 0) {
+      auto it = open_stacks_.find(close.thread_id);
+      if (it == open_stacks_.end() || it->second.empty()) {
+        return false;
+      }
+      const OpenScope& scope = it->second.back();
+      addDuration(scope.name, close.end_ns - scope.start_ns);
+      it->second.pop_back();
+      return true;
+    }
+    auto it = open_scopes_.find(std::make_pair(close.thread_id, close.scope_id));
+    if (it == open_scopes_.end()) {
+      return false;
+    }
+    addDuration(it->second.name, close.end_ns - it->second.start_ns);
+    open_scopes_.erase(it);
+    return true;
+  }
+
+  void addDuration(const std::string& name, int64_t duration_ns) {
+    // Clocks of different threads may disagree by a little.
+    summary_.scope_durations_ns[name].record(
+        static_cast<uint64_t>(std::max<int64_t>(duration_ns, 0)));
+  }
+
+  const int64_t rate_bucket_ns_;
+  SlogSummary summary_;
+  std::map<std::pair<int32_t, int64_t>, OpenScope> open_scopes_;
+  std::unordered_map<int32_t, std::vector<OpenScope>> open_stacks_;
+  std::vector<ScopeClose> unmatched_closes_;
+};
+
+// Summarizes one SlogPrinter::jsonString() line, counting it by call site ID
+// in `call_site_counts`.
+bool summarizeJsonLine(
+    JsonSpan line, PartialSummary* partial,
+    std::unordered_map<int32_t, uint64_t>* call_site_counts) {
+  int32_t thread_id = 0;
+  int32_t call_site_id = -1;
+  int severity = 0;
+  int64_t global_ns = 0;
+  bool is_open = false;
+  bool is_close = false;
+  int64_t scope_id = -1;
+  std::string scope_name;
+  bool tags_ok = true;
+  const bool ok = forEachMember(line, [&](JsonSpan key, JsonSpan value) {
+    if (key.equals("thread_id")) {
+      thread_id = jsonInt(value);
+    } else if (key.equals("call_site_id")) {
+      call_site_id = jsonInt(value);
+    } else if (key.equals("severity")) {
+      severity = jsonInt(value);
+    } else if (key.equals("time")) {
+      forEachMember(value, [&](JsonSpan time_key, JsonSpan time_value) {
+        if (time_key.equals("global_ns")) {
+          global_ns = jsonInt(time_value);
+        }
+      });
+    } else if (key.equals("tags")) {
+      tags_ok = forEachElement(value, [&](JsonSpan tag) {
+        JsonSpan tag_key;
+        JsonSpan tag_value;
+        forEachMember(tag, [&](JsonSpan field, JsonSpan field_value) {
+          if (field.equals("key")) {
+            tag_key = field_value;
+          } else if (field.equals("valueString") ||
+                     field.equals("valueInt")) {
+            tag_value = field_value;
+          }
+        });
+        if (tag_key.end - tag_key.begin < 2) {
+          return;
+        }
+        // Keys are quoted.
+        tag_key.begin += 1;
+        tag_key.end -= 1;
+        if (tag_key.equals(kSlogTagKeyScopeOpen)) {
+          is_open = true;
+        } else if (tag_key.equals(kSlogTagKeyScopeClose)) {
+          is_close = true;
+        } else if (tag_key.equals(kSlogTagKeyScopeId)) {
+          scope_id = jsonInt(tag_value);
+        } else if (tag_key.equals(kSlogTagKeyScopeName)) {
+          scope_name = jsonStringValue(tag_value);
+        }
+      });
+    }
+  });
+  if (!ok || !tags_ok || call_site_id < 0) {
+    return false;
+  }
+  partial->addRecord(severity, global_ns);
+  (*call_site_counts)[call_site_id] += 1;
+  if (is_open && scope_id >= 0) {
+    partial->openScope(thread_id, scope_id, std::move(scope_name), global_ns);
+  } else if (is_close && scope_id >= 0) {
+    partial->closeScope(ScopeClose{thread_id, scope_id, global_ns});
+  }
+  return true;
+}
+
+// Summarizes one trace event line of SlogTraceSubscriber output.
+bool summarizeTraceLine(JsonSpan line, PartialSummary* partial) {
+  std::string name;
+  std::string phase;
+  std::string log_msg;
+  int64_t ts_ns = 0;
+  int32_t thread_id = 0;
+  const bool ok = forEachMember(line, [&](JsonSpan key, JsonSpan value) {
+    if (key.equals("name")) {
+      name = jsonStringValue(value);
+    } else if (key.equals("ph")) {
+      phase = jsonStringValue(value);
+    } else if (key.equals("ts")) {
+      ts_ns = static_cast<int64_t>(jsonDouble(value) * 1e3);
+    } else if (key.equals("tid")) {
+      thread_id = jsonInt(value);
+    } else if (key.equals("args")) {
+      forEachMember(value, [&](JsonSpan arg_key, JsonSpan arg_value) {
+        if (arg_key.equals("log_msg")) {
+          log_msg = jsonStringValue(arg_value);
+        }
+      });
+    }
+  });
+  if (!ok || phase.empty()) {
+    return false;
+  }
+  if (phase == "M") {
+    // Metadata, e.g. thread names.
+    return true;
+  }
+  if (phase == "B" || phase == "E") {
+    partial->addRecord(INFO, ts_ns);
+    partial->summary().call_site_counts[name] += 1;
+    if (phase == "B") {
+      partial->openScope(thread_id, -1, name, ts_ns);
+    } else {
+      partial->closeScope(ScopeClose{thread_id, -1, ts_ns});
+    }
+    return true;
+  }
+  partial->addRecord(severityFromName(name), ts_ns);
+  const std::string call_site = callSiteFromStderrLine(log_msg);
+  partial->summary().call_site_counts[call_site.empty() ? name : call_site] +=
+      1;
+  return true;
+}
+
+constexpr char kTraceEventsPrefix[] = "{\"traceEvents\"";
+constexpr ptrdiff_t kTraceEventsPrefixSize = sizeof(kTraceEventsPrefix) - 1;
+
+void summarizeTextLines(SlogLogFormat format, const char* begin,
+                        const char* end, PartialSummary* partial) {
+  // Of JSON lines, labeled once per task.
+  std::unordered_map<int32_t, uint64_t> call_site_counts;
+  while (begin < end) {
+    const char* line_end =
+        static_cast<const char*>(memchr(begin, '\n', end - begin));
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+    JsonSpan line{skipSpaces(begin, line_end), line_end};
+    while (line.end > line.begin &&
+           (line.end[-1] == ',' || line.end[-1] == ' ' ||
+            line.end[-1] == '\r')) {
+      --line.end;
+    }
+    begin = line_end + 1;
+    if (line.empty()) {
+      continue;
+    }
+    bool ok = false;
+    if (format == SlogLogFormat::kJsonLines) {
+      ok = summarizeJsonLine(line, partial, &call_site_counts);
+    } else if (*line.begin == ']' ||
+               (line.end - line.begin >= kTraceEventsPrefixSize &&
+                memcmp(line.begin, kTraceEventsPrefix,
+                       kTraceEventsPrefixSize) == 0)) {
+      // Framing of the trace event array.
+      ok = true;
+    } else {
+      ok = summarizeTraceLine(line, partial);
+    }
+    partial->summary().num_malformed += !ok;
+  }
+  for (const auto& item : call_site_counts) {
+    partial->summary().call_site_counts[callSiteLabel(nullptr, item.first)] +=
+        item.second;
+  }
+}
+
+void summarizeBlocks(const SlogSegmentReader& segment, size_t first_block,
+                     size_t end_block, PartialSummary* partial) {
+  SlogRecordDecoder decoder = segment.dictionary();
+  SlogDecodedBatch batch;
+  std::unordered_map<int32_t, uint64_t> call_site_counts;
+  const SlogStringView scope_open(kSlogTagKeyScopeOpen,
+                                  strlen(kSlogTagKeyScopeOpen));
+  const SlogStringView scope_close(kSlogTagKeyScopeClose,
+                                   strlen(kSlogTagKeyScopeClose));
+  const SlogStringView scope_id_key(kSlogTagKeyScopeId,
+                                    strlen(kSlogTagKeyScopeId));
+  const SlogStringView scope_name_key(kSlogTagKeyScopeName,
+                                      strlen(kSlogTagKeyScopeName));
+  for (size_t i = first_block; i < end_block; ++i) {
+    if (!segment.decodeBlock(i, &decoder, &batch)) {
+      partial->summary().num_malformed += 1;
+      continue;
+    }
+    for (const SlogRecordView& record : batch.records) {
+      const int64_t global_ns = record.time().global_ns;
+      partial->addRecord(record.severity(), global_ns);
+      call_site_counts[record.call_site_id()] += 1;
+
+      bool is_open = false;
+      bool is_close = false;
+      int64_t scope_id = -1;
+      SlogStringView scope_name;
+      for (const SlogTagView& tag : record) {
+        const SlogStringView key = tag.key();
+        if (key.empty() || key.data()[0] != '.') {
+          continue;
+        }
+        if (key == scope_open) {
+          is_open = true;
+        } else if (key == scope_close) {
+          is_close = true;
+        } else if (key == scope_id_key) {
+          scope_id = tag.valueInt();
+        } else if (key == scope_name_key) {
+          scope_name = tag.valueString();
+        }
+      }
+      if (is_open && scope_id >= 0) {
+        partial->openScope(record.thread_id(), scope_id, scope_name.str(),
+                           global_ns);
+      } else if (is_close && scope_id >= 0) {
+        partial->closeScope(ScopeClose{record.thread_id(), scope_id, global_ns});
+      }
+    }
+  }
+  for (const auto& item : call_site_counts) {
+    partial->summary().call_site_counts[callSiteLabel(
+        segment.callSite(item.first), item.first)] += item.second;
+  }
+}
+
+}  // namespace
+
+SlogLogFormat detectLogFormat(const char* data, size_t size) {
+  SlogSegmentHeader header;
+  if (parseSegmentHeader(data, size, &header)) {
+    return SlogLogFormat::kBinarySegment;
+  }
+  const std::string head(data, std::min<size_t>(size, 4096));
+  const size_t first = head.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos || head[first] != '{') {
+    return SlogLogFormat::kUnknown;
+  }
+  if (head.compare(first, kTraceEventsPrefixSize, kTraceEventsPrefix) == 0) {
+    return SlogLogFormat::kTraceJson;
+  }
+  return SlogLogFormat::kJsonLines;
+}
+
+std::vector<std::pair<std::string, uint64_t>> SlogSummary::topCallSites(
+    size_t n) const {
+  std::vector<std::pair<std::string, uint64_t>> top(call_site_counts.begin(),
+                                                    call_site_counts.end());
+  const auto by_count = [](const std::pair<std::string, uint64_t>& a,
+                           const std::pair<std::string, uint64_t>& b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+  };
+  if (top.size() > n) {
+    std::partial_sort(top.begin(), top.begin() + n, top.end(), by_count);
+    top.resize(n);
+  } else {
+    std::sort(top.begin(), top.end(), by_count);
+  }
+  return top;
+}
+
+std::vector<SlogScopeLatency> SlogSummary::scopeLatencies() const {
+  std::vector<SlogScopeLatency> latencies;
+  for (const auto& item : scope_durations_ns) {
+    const util::LogLinearHistogram& durations = item.second;
+    if (durations.count() == 0) {
+      continue;
+    }
+    SlogScopeLatency latency;
+    latency.name = item.first;
+    latency.count = durations.count();
+    latency.p50_ns = durations.valueAtPercentile(50);
+    latency.p90_ns = durations.valueAtPercentile(90);
+    latency.p99_ns = durations.valueAtPercentile(99);
+    latency.max_ns = durations.max();
+    latencies.emplace_back(std::move(latency));
+  }
+  std::sort(latencies.begin(), latencies.end(),
+            [](const SlogScopeLatency& a, const SlogScopeLatency& b) {
+              return a.name < b.name;
+            });
+  return latencies;
+}
+
+class SlogSummarizer::Impl {
+  struct Task {
+    SlogLogFormat format;
+    // Text formats: a range of complete lines.
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    // Binary segments: a range of blocks.
+    const SlogSegmentReader* segment = nullptr;
+    size_t first_block = 0;
+    size_t end_block = 0;
+  };
+
+ public:
+  explicit Impl(const SlogSummaryOptions& options) : options_(options) {}
+
+  bool addFile(const std::string& path) {
+    std::unique_ptr<SlogMappedFile> file(new SlogMappedFile());
+    if (!file->open(path)) {
+      std::cerr << "slog: failed to map " << path << std::endl;
+      return false;
+    }
+    const SlogLogFormat format = detectLogFormat(file->data(), file->size());
+    switch (format) {
+      case SlogLogFormat::kUnknown:
+        std::cerr << "slog: unknown format of " << path << std::endl;
+        return false;
+      case SlogLogFormat::kBinarySegment:
+        return addSegment(path);
+      case SlogLogFormat::kJsonLines:
+      case SlogLogFormat::kTraceJson:
+        addTextFile(format, *file);
+        files_.emplace_back(std::move(file));
+        return true;
+    }
+    return false;
+  }
+
+  SlogSummary run() {
+    std::vector<PartialSummary> partials(
+        tasks_.size(), PartialSummary(options_.rate_bucket_ns));
+    std::atomic<size_t> next_task{0};
+    const auto worker = [this, &partials, &next_task] {
+      for (size_t i = next_task++; i < tasks_.size(); i = next_task++) {
+        runTask(tasks_[i], &partials[i]);
+      }
+    };
+    size_t num_threads = options_.num_threads > 0
+                             ? options_.num_threads
+                             : std::thread::hardware_concurrency();
+    num_threads = std::max<size_t>(1, std::min(num_threads, tasks_.size()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+      threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    PartialSummary result(options_.rate_bucket_ns);
+    for (auto& partial : partials) {
+      result.merge(std::move(partial));
+    }
+    result.finish();
+    return std::move(result.summary());
+  }
+
+ private:
+  void addTextFile(SlogLogFormat format, const SlogMappedFile& file) {
+    const char* pos = file.data();
+    const char* const end = file.data() + file.size();
+    while (pos < end) {
+      const char* task_end =
+          pos + std::min<size_t>(options_.task_size, end - pos);
+      // Extend the task to the end of the line.
+      const char* newline = static_cast<const char*>(
+          memchr(task_end - 1, '\n', end - task_end + 1));
+      task_end = newline != nullptr ? newline + 1 : end;
+      Task task;
+      task.format = format;
+      task.begin = pos;
+      task.end = task_end;
+      tasks_.push_back(task);
+      pos = task_end;
+    }
+  }
+
+  bool addSegment(const std::string& path) {
+    std::unique_ptr<SlogSegmentReader> segment(new SlogSegmentReader());
+    if (!segment->open(path)) {
+      std::cerr << "slog: failed to read segment " << path << std::endl;
+      return false;
+    }
+    const auto& index = segment->index();
+    size_t first_block = 0;
+    size_t task_bytes = 0;
+    for (size_t i = 0; i < index.size(); ++i) {
+      const uint64_t block_end =
+          i + 1 < index.size() ? index[i + 1].offset : index[i].offset;
+      task_bytes += block_end - index[i].offset;
+      if (task_bytes >= options_.task_size || i + 1 == index.size()) {
+        Task task;
+        task.format = SlogLogFormat::kBinarySegment;
+        task.segment = segment.get();
+        task.first_block = first_block;
+        task.end_block = i + 1;
+        tasks_.push_back(task);
+        first_block = i + 1;
+        task_bytes = 0;
+      }
+    }
+    segments_.emplace_back(std::move(segment));
+    return true;
+  }
+
+  static void runTask(const Task& task, PartialSummary* partial) {
+    if (task.format == SlogLogFormat::kBinarySegment) {
+      summarizeBlocks(*task.segment, task.first_block, task.end_block,
+                      partial);
+    } else {
+      summarizeTextLines(task.format, task.begin, task.end, partial);
+    }
+  }
+
+  const SlogSummaryOptions options_;
+  std::vector<std::unique_ptr<SlogMappedFile>> files_;
+  std::vector<std::unique_ptr<SlogSegmentReader>> segments_;
+  std::vector<Task> tasks_;
+};
+
+SlogSummarizer::SlogSummarizer(const SlogSummaryOptions& options)
+    : impl_(new Impl(options)) {}
+
+SlogSummarizer::~SlogSummarizer() = default;
+
+bool SlogSummarizer::addFile(const std::string& path) {
+  return impl_->addFile(path);
+}
+
+SlogSummary SlogSummarizer::run() { return impl_->run(); }
+
+}  // namespace slog
@@ -0,0 +1,118 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_analysis_tools_summary_slog_summarizer
+#define slog_cc_analysis_tools_summary_slog_summarizer
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "slog_cc/util/histogram.h"
+
+namespace slog {
+
+enum class SlogLogFormat {
+  kUnknown,
+  // Binary segments written by SlogBinaryFileSink.
+  kBinarySegment,
+  // One SlogPrinter::jsonString() record per line.
+  kJsonLines,
+  // Chrome trace events written by SlogTraceSubscriber.
+  kTraceJson,
+};
+
+// Guesses the format of a log file from its first bytes.
+SlogLogFormat detectLogFormat(const char* data, size_t size);
+
+struct SlogSummaryOptions {
+  // Number of worker threads, 0 uses all hardware threads.
+  int num_threads = 0;
+  // Files are split into tasks of about this many bytes.
+  size_t task_size = 8 << 20;
+  // Width of the buckets of SlogSummary::rate.
+  int64_t rate_bucket_ns = 1000000000;
+};
+
+struct SlogScopeLatency {
+  std::string name;
+  uint64_t count = 0;
+  int64_t p50_ns = 0;
+  int64_t p90_ns = 0;
+  int64_t p99_ns = 0;
+  int64_t max_ns = 0;
+};
+
+// Aggregates over all records of the summarized files.
+struct SlogSummary {
+  uint64_t num_records = 0;
+  // Lines or blocks that couldn't be parsed.
+  uint64_t num_malformed = 0;
+  // Scope open records without a close record and vice versa.
+  uint64_t num_unmatched_scopes = 0;
+
+  // Records by severity.
+  std::map<int, uint64_t> severity_counts;
+  // Records by call site. Call sites are labeled "file:line" when the input
+  // has call site details, "#<call_site_id>" otherwise.
+  std::unordered_map<std::string, uint64_t> call_site_counts;
+  // Records by the start of their global time bucket. Trace JSON has
+  // timestamps relative to the first event, so do its buckets.
+  std::map<int64_t, uint64_t> rate;
+  // Durations of closed scopes by scope name, in ~4 KB per name however
+  // long the logs are.
+  std::unordered_map<std::string, util::LogLinearHistogram> scope_durations_ns;
+
+  // Call sites with most records, most frequent first.
+  std::vector<std::pair<std::string, uint64_t>> topCallSites(size_t n) const;
+  // Latency percentiles of all scopes, sorted by name. Percentiles are within
+  // the histogram bucket width, 12.5%, of the exact ones.
+  std::vector<SlogScopeLatency> scopeLatencies() const;
+};
+
+// Summarizes large logs in parallel. Files are mapped into memory and split
+// into tasks: ranges of lines of text logs, ranges of blocks of binary
+// segments. Worker threads summarize tasks independently, then partial
+// summaries are merged in file order, which also pairs scope open and close
+// records that landed in different tasks.
+//
+// Usage:
+//   SlogSummarizer summarizer(options);
+//   summarizer.addFile("/tmp/slog.00000001.slogseg");
+//   const SlogSummary summary = summarizer.run();
+class SlogSummarizer {
+ public:
+  explicit SlogSummarizer(const SlogSummaryOptions& options);
+  ~SlogSummarizer();
+
+  // Maps a file and splits it into tasks. Returns false if the file can't be
+  // read or its format is unknown. Files are merged in the order of addition.
+  bool addFile(const std::string& path);
+
+  // Summarizes all added files.
+  SlogSummary run();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace slog
+
+#endif
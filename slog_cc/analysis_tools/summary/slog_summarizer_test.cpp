@@ -0,0 +1,249 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/analysis_tools/summary/slog_summarizer.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/events/scope.h"
+#include "slog_cc/printer/printer.h"
+#include "slog_cc/sinks/binary_file_sink.h"
+
+namespace slog {
+
+namespace {
+
+constexpr int kNumScopes = 200;
+constexpr int64_t kSecondNs = 1000000000;
+
+SlogCallSite lookupCallSite(int32_t id) {
+  return SlogCallSite("func" + std::to_string(id), "dir/file.cpp", id * 10);
+}
+
+// Each scope `i` of thread 1 takes i microseconds and has a warning inside.
+// Records spread over 4 seconds.
+std::vector<SlogRecord> makeRecords() {
+  std::vector<SlogRecord> records;
+  for (int i = 1; i <= kNumScopes; ++i) {
+    const int64_t start_ns = (i - 1) * 4 * kSecondNs / kNumScopes + 1000;
+    SlogRecord open(1, 1, INFO);
+    open.set_time(SlogTimestamps{start_ns, start_ns});
+    open.addTag(kSlogTagKeyScopeName, i % 2 ? "odd" : "even");
+    open.addTag(kSlogTagKeyScopeOpen);
+    open.addTag(kSlogTagKeyScopeId, i);
+    open.addTag(kSlogTagKeyScopeDepth, 1);
+    records.emplace_back(std::move(open));
+
+    SlogRecord warning(1, 2, WARNING);
+    warning.set_time(SlogTimestamps{start_ns + 1, start_ns + 1});
+    warning.addTag("i", i);
+    records.emplace_back(std::move(warning));
+
+    SlogRecord close(1, 0, INFO);
+    close.set_time(SlogTimestamps{start_ns + i * 1000, start_ns + i * 1000});
+    close.addTag(kSlogTagKeyScopeClose);
+    close.addTag(kSlogTagKeyScopeId, i);
+    records.emplace_back(std::move(close));
+  }
+  return records;
+}
+
+}  // namespace
+
+class SlogSummarizerTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    char dir_template[] = "/tmp/slog_summarizer_test.XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir_template));
+    dir_ = dir_template;
+  }
+
+  void TearDown() override {
+    for (const auto& path : paths_) {
+      unlink(path.c_str());
+    }
+    rmdir(dir_.c_str());
+  }
+
+  std::string writeFile(const std::string& name, const std::string& data) {
+    paths_.push_back(dir_ + "/" + name);
+    std::ofstream file(paths_.back(), std::ios::binary);
+    file << data;
+    return paths_.back();
+  }
+
+  // Summarizes with tiny tasks on many threads, so that scopes cross task
+  // boundaries, and checks that the result doesn't depend on it.
+  static SlogSummary summarize(const std::string& path) {
+    SlogSummaryOptions single_task_options;
+    single_task_options.num_threads = 1;
+    SlogSummarizer single_task(single_task_options);
+    EXPECT_TRUE(single_task.addFile(path));
+    const SlogSummary expected = single_task.run();
+
+    SlogSummaryOptions options;
+    options.num_threads = 4;
+    options.task_size = 256;
+    SlogSummarizer summarizer(options);
+    EXPECT_TRUE(summarizer.addFile(path));
+    const SlogSummary summary = summarizer.run();
+
+    EXPECT_EQ(expected.num_records, summary.num_records);
+    EXPECT_EQ(expected.num_unmatched_scopes, summary.num_unmatched_scopes);
+    EXPECT_EQ(expected.severity_counts, summary.severity_counts);
+    EXPECT_EQ(expected.call_site_counts, summary.call_site_counts);
+    EXPECT_EQ(expected.rate, summary.rate);
+    const auto expected_latencies = expected.scopeLatencies();
+    const auto latencies = summary.scopeLatencies();
+    EXPECT_EQ(expected_latencies.size(), latencies.size());
+    for (size_t i = 0; i < latencies.size() && i < expected_latencies.size();
+         ++i) {
+      EXPECT_EQ(expected_latencies[i].count, latencies[i].count);
+      EXPECT_EQ(expected_latencies[i].p90_ns, latencies[i].p90_ns);
+    }
+    return summary;
+  }
+
+  static void checkScopes(const SlogSummary& summary) {
+    EXPECT_EQ(0, summary.num_unmatched_scopes);
+    const auto latencies = summary.scopeLatencies();
+    ASSERT_EQ(2, latencies.size());
+    EXPECT_EQ("even", latencies[0].name);
+    EXPECT_EQ(kNumScopes / 2, latencies[0].count);
+    EXPECT_EQ(200000, latencies[0].max_ns);
+    EXPECT_EQ("odd", latencies[1].name);
+    EXPECT_EQ(kNumScopes / 2, latencies[1].count);
+    // Within the histogram bucket width.
+    EXPECT_NEAR(99000, latencies[1].p50_ns, 99000 / 8);
+    EXPECT_EQ(199000, latencies[1].max_ns);
+  }
+
+ protected:
+  std::string dir_;
+  std::vector<std::string> paths_;
+};
+
+TEST_F(SlogSummarizerTest, detect_format) {
+  EXPECT_EQ(SlogLogFormat::kTraceJson,
+            detectLogFormat("{\"traceEvents\": [\n", 18));
+  EXPECT_EQ(SlogLogFormat::kJsonLines, detectLogFormat("{\"thread_id\"", 12));
+  EXPECT_EQ(SlogLogFormat::kUnknown, detectLogFormat("hello", 5));
+}
+
+TEST_F(SlogSummarizerTest, json_lines) {
+  std::string data;
+  for (const auto& record : makeRecords()) {
+    data += SlogPrinter().jsonString(record) + "\n";
+  }
+  data += "{\"broken\n";
+  const SlogSummary summary = summarize(writeFile("log.json", data));
+
+  EXPECT_EQ(3 * kNumScopes, summary.num_records);
+  EXPECT_EQ(1, summary.num_malformed);
+  EXPECT_EQ(2 * kNumScopes, summary.severity_counts.at(INFO));
+  EXPECT_EQ(kNumScopes, summary.severity_counts.at(WARNING));
+  const auto top = summary.topCallSites(1);
+  ASSERT_EQ(1, top.size());
+  EXPECT_EQ(kNumScopes, top[0].second);
+  // JSON lines carry no call site details.
+  EXPECT_EQ(kNumScopes, summary.call_site_counts.at("#2"));
+  ASSERT_EQ(4, summary.rate.size());
+  EXPECT_EQ(3 * kNumScopes / 4, summary.rate.at(0));
+  checkScopes(summary);
+}
+
+TEST_F(SlogSummarizerTest, binary_segments) {
+  SlogBinaryFileSinkOptions options;
+  options.directory = dir_;
+  options.file_prefix = "test";
+  {
+    SlogSegmentWriter writer(options);
+    const auto records = makeRecords();
+    // Small batches, so that segments have many blocks.
+    for (size_t i = 0; i < records.size(); i += 7) {
+      writer.write(std::vector<SlogRecord>(
+                       records.begin() + i,
+                       records.begin() + std::min(i + 7, records.size())),
+                   lookupCallSite, 3);
+    }
+  }
+  const auto segments = SlogSegmentWriter(options).listSegments();
+  ASSERT_EQ(1, segments.size());
+  paths_.push_back(segments[0]);
+
+  const SlogSummary summary = summarize(segments[0]);
+  EXPECT_EQ(3 * kNumScopes, summary.num_records);
+  EXPECT_EQ(0, summary.num_malformed);
+  EXPECT_EQ(kNumScopes, summary.call_site_counts.at("file.cpp:20"));
+  checkScopes(summary);
+}
+
+TEST_F(SlogSummarizerTest, trace_json) {
+  std::string data = "{\"traceEvents\": [\n";
+  data +=
+      R"(  {"name": "thread_name", "ph": "M", "pid": "0", "tid": "1", "args": {"name" : "main"}},)"
+      "\n";
+  for (int i = 1; i <= kNumScopes; ++i) {
+    const double start_us = i * 100.0;
+    data += "  {\"name\": \"" + std::string(i % 2 ? "odd" : "even") +
+            "\", \"ph\": \"B\", \"ts\": " + std::to_string(start_us) +
+            ", \"pid\": \"0\", \"tid\": \"1\", \"cat\": \"scope\", "
+            "\"args\": {}},\n";
+    data += "  {\"name\": \"Warning\", \"ph\": \"i\", \"ts\": " +
+            std::to_string(start_us) +
+            ", \"pid\": \"0\", \"tid\": \"1\", \"s\": \"t\", \"cat\": "
+            "\"Warning\", \"args\": {\"log_msg\": \"W0101 00:00:00.000000 1 "
+            "file.cpp:20] warning\", \"tags\": {}}},\n";
+    data += "  {\"name\": \"" + std::string(i % 2 ? "odd" : "even") +
+            "\", \"ph\": \"E\", \"ts\": " + std::to_string(start_us + i) +
+            ", \"pid\": \"0\", \"tid\": \"1\", \"cat\": \"scope\", "
+            "\"args\": {}}" + (i < kNumScopes ? ",\n" : "\n");
+  }
+  data += "]}\n";
+  const SlogSummary summary = summarize(writeFile("trace.json", data));
+
+  EXPECT_EQ(3 * kNumScopes, summary.num_records);
+  EXPECT_EQ(0, summary.num_malformed);
+  EXPECT_EQ(kNumScopes, summary.severity_counts.at(WARNING));
+  EXPECT_EQ(kNumScopes, summary.call_site_counts.at("file.cpp:20"));
+  checkScopes(summary);
+}
+
+TEST_F(SlogSummarizerTest, json_escapes) {
+  // U+00E9, U+1F600 as a surrogate pair, control escapes and a malformed \u.
+  const std::string name = R"(caf\u00e9 \ud83d\ude00\r\b\f\"\\ \uZZ)";
+  std::string data = "{\"traceEvents\": [\n";
+  data += "  {\"name\": \"" + name +
+          "\", \"ph\": \"B\", \"ts\": 1.0, \"pid\": \"0\", \"tid\": \"1\", "
+          "\"cat\": \"scope\", \"args\": {}},\n";
+  data += "  {\"name\": \"" + name +
+          "\", \"ph\": \"E\", \"ts\": 3.0, \"pid\": \"0\", \"tid\": \"1\", "
+          "\"cat\": \"scope\", \"args\": {}}\n";
+  data += "]}\n";
+  const SlogSummary summary = summarize(writeFile("escapes.json", data));
+
+  EXPECT_EQ(0, summary.num_malformed);
+  const auto latencies = summary.scopeLatencies();
+  ASSERT_EQ(1, latencies.size());
+  EXPECT_EQ("caf\xc3\xa9 \xf0\x9f\x98\x80\r\b\f\"\\ \\uZZ", latencies[0].name);
+}
+
+}  // namespace slog
@@ -0,0 +1,129 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Command line tool printing a summary of large logs, e.g.:
+//   slog_summary --top=10 /tmp/slog.*.slogseg
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "slog_cc/analysis_tools/summary/slog_summarizer.h"
+#include "slog_cc/util/string_util.h"
+
+namespace {
+
+constexpr char kUsage[] =
+    "Usage: slog_summary [options] <files>\n"
+    "Summarizes binary segments, JSON lines of SlogPrinter::jsonString() and\n"
+    "trace JSON files of SlogTraceSubscriber.\n"
+    "  --threads=<n>      worker threads, all hardware threads by default\n"
+    "  --top=<n>          number of top call sites to print, 20 by default\n"
+    "  --bucket_ms=<ms>   width of event rate buckets, 1000 by default\n"
+    "  --task_mb=<mb>     size of the parts files are split into, 8 by "
+    "default\n";
+
+const char* severityName(int severity) {
+  static const char* const kNames[] = {"UNKNOWN", "DEBUG", "INFO",
+                                       "WARNING", "ERROR", "FATAL"};
+  return severity >= 0 && severity < 6 ? kNames[severity] : "OTHER";
+}
+
+void printSummary(const slog::SlogSummary& summary, size_t top,
+                  int64_t bucket_ns) {
+  std::cout << "Records: " << summary.num_records
+            << ", malformed: " << summary.num_malformed
+            << ", unmatched scopes: " << summary.num_unmatched_scopes << "\n";
+
+  std::cout << "\nSeverity:\n";
+  for (const auto& item : summary.severity_counts) {
+    std::cout << slog::util::stringPrintf(
+        "  %-8s %12llu\n", severityName(item.first),
+        static_cast<unsigned long long>(item.second));
+  }
+
+  std::cout << "\nTop call sites:\n";
+  for (const auto& item : summary.topCallSites(top)) {
+    std::cout << slog::util::stringPrintf(
+        "  %12llu  %s\n", static_cast<unsigned long long>(item.second),
+        item.first.c_str());
+  }
+
+  std::cout << "\nRate, records per " << bucket_ns / 1000000 << " ms:\n";
+  for (const auto& item : summary.rate) {
+    std::cout << slog::util::stringPrintf(
+        "  %20lld %12llu\n", static_cast<long long>(item.first),
+        static_cast<unsigned long long>(item.second));
+  }
+
+  std::cout << "\nScope latency, us:\n";
+  std::cout << slog::util::stringPrintf("  %-32s %10s %12s %12s %12s %12s\n",
+                                        "name", "count", "p50", "p90", "p99",
+                                        "max");
+  for (const auto& latency : summary.scopeLatencies()) {
+    std::cout << slog::util::stringPrintf(
+        "  %-32s %10llu %12.1f %12.1f %12.1f %12.1f\n", latency.name.c_str(),
+        static_cast<unsigned long long>(latency.count), latency.p50_ns / 1e3,
+        latency.p90_ns / 1e3, latency.p99_ns / 1e3, latency.max_ns / 1e3);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  slog::SlogSummaryOptions options;
+  size_t top = 20;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const std::string value = arg.substr(arg.find('=') + 1);
+    if (slog::util::startsWith(arg, "--threads=")) {
+      options.num_threads = std::atoi(value.c_str());
+    } else if (slog::util::startsWith(arg, "--top=")) {
+      top = std::strtoul(value.c_str(), nullptr, 10);
+    } else if (slog::util::startsWith(arg, "--bucket_ms=")) {
+      options.rate_bucket_ns =
+          std::strtoll(value.c_str(), nullptr, 10) * 1000000;
+    } else if (slog::util::startsWith(arg, "--task_mb=")) {
+      options.task_size = std::strtoul(value.c_str(), nullptr, 10) << 20;
+    } else if (slog::util::startsWith(arg, "--")) {
+      std::cerr << "Unknown option " << arg << "\n" << kUsage;
+      return 1;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.empty() || options.rate_bucket_ns <= 0 || options.task_size == 0) {
+    std::cerr << kUsage;
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  slog::SlogSummarizer summarizer(options);
+  for (const std::string& path : paths) {
+    if (!summarizer.addFile(path)) {
+      return 1;
+    }
+  }
+  const slog::SlogSummary summary = summarizer.run();
+  printSummary(summary, top, options.rate_bucket_ns);
+  std::cerr << "Summarized " << paths.size() << " files in "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             start)
+                   .count()
+            << " s" << std::endl;
+  return 0;
+}
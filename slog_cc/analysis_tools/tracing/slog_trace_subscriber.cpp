@@ -2,6 +2,7 @@
 
 #include "slog_cc/context/subscribers.h"
 #include "slog_cc/events/scope.h"
+#include "slog_cc/primitives/gps_time.h"
 #include "slog_cc/util/string_util.h"
 
 namespace slog {
@@ -25,7 +26,7 @@ SlogTraceSubscriber CreateSlogTraceSubscriber(
         }
 
         if (state->min_ts_ns == -1) {
-          state->min_ts_ns = r.time().global_ns;
+          state->min_ts_ns = toUnixNs(r.time());
         } else {
           state->file << ",\n";
         }
@@ -44,7 +45,9 @@ SlogTraceSubscriber CreateSlogTraceSubscriber(
             // Skip tags with empty key.
             continue;
           }
-          if (util::startsWith(tag.key(), ".scope")) {
+          if (util::startsWith(tag.key(), ".scope") ||
+              tag.key() == kSlogTagKeyScopeDuration ||
+              tag.key() == kSlogTagKeyScopeParentId) {
             // Hide scope internal tags.
             continue;
           }
@@ -77,11 +80,16 @@ SlogTraceSubscriber CreateSlogTraceSubscriber(
 
         std::string json_event;
         if (scope_id_tag) {
-          const int64_t scope_id = scope_id_tag->valueInt();
           const bool is_open = r.find_tag(kSlogTagKeyScopeOpen);
-          if (is_open) {
-            state->scope_id_to_name[{r.thread_id(), scope_id}] =
-                r.find_tag(kSlogTagKeyScopeName)->valueString();
+          // Close records carry the name ID, no need to remember the opens.
+          const SlogTag* name_tag = r.find_tag(kSlogTagKeyScopeName);
+          const SlogTag* name_id_tag = r.find_tag(kSlogTagKeyScopeNameId);
+          std::string name;
+          if (name_tag != nullptr) {
+            name = name_tag->valueString();
+          } else if (name_id_tag != nullptr) {
+            name = SlogContext::getInstance()->scopeName(
+                name_id_tag->valueInt());
           }
           const std::string str_args = [&str_tags]() -> std::string {
             if (str_tags.empty()) {
@@ -93,9 +101,9 @@ SlogTraceSubscriber CreateSlogTraceSubscriber(
           }();
           json_event = util::stringPrintf(
               R"raw({"name": "%s", "ph": "%c", "ts": %lf, "pid": "0", "tid": "%d", "cat": "scope", "args": {%s}})raw",
-              state->scope_id_to_name[{r.thread_id(), scope_id}].c_str(),
+              name.c_str(),
               is_open ? 'B' : 'E',
-              (r.time().global_ns - state->min_ts_ns) / 1e3, r.thread_id(),
+              (toUnixNs(r.time()) - state->min_ts_ns) / 1e3, r.thread_id(),
               str_args.c_str());
         } else {
           const std::string severity = [&r]() -> std::string {
@@ -121,7 +129,7 @@ SlogTraceSubscriber CreateSlogTraceSubscriber(
           json_event = util::stringPrintf(
               R"raw({"name": "%s", "ph": "%c", "ts": %lf, "pid": "0", "tid": "%d", "s": "t", "cat": "%s", "args": {"log_msg": "%s", "tags": {%s}}})raw",
               severity.c_str(), 'i',
-              (r.time().global_ns - state->min_ts_ns) / 1e3, r.thread_id(),
+              (toUnixNs(r.time()) - state->min_ts_ns) / 1e3, r.thread_id(),
               severity.c_str(),
               util::escapeIvalidJsonCharacters(
                   SlogPrinter().stderrLine(r, call_site))
@@ -18,7 +18,6 @@
 #include <cstdint>
 #include <cstring>
 #include <fstream>
-#include <map>
 #include <memory>
 #include <string>
 
@@ -26,24 +25,8 @@
 
 namespace slog {
 
-struct GlobalScopeId {
-  int32_t thread_id;
-  int64_t scope_id;
-
-  bool operator<(const GlobalScopeId& other) const {
-    if (thread_id != other.thread_id) {
-      return thread_id < other.thread_id;
-    }
-    if (scope_id != other.scope_id) {
-      return scope_id < other.scope_id;
-    }
-    return false;
-  }
-};
-
 struct SlogTraceSubscriberState {
   std::ofstream file;
-  std::map<GlobalScopeId, std::string> scope_id_to_name;
   int64_t min_ts_ns = -1;
 
   ~SlogTraceSubscriberState() { file << "\n]}\n"; }
@@ -0,0 +1,82 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/analysis_tools/tracing/slog_trace_subscriber.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/slog.h"
+
+namespace slog {
+
+namespace {
+
+// "<name> <ph>" of the scope events of a trace file, in file order.
+std::vector<std::string> readScopeEvents(const std::string& path) {
+  std::vector<std::string> events;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.find(R"("cat": "scope")") == std::string::npos) {
+      continue;
+    }
+    const size_t name = line.find(R"("name": ")") + 9;
+    const size_t ph = line.find(R"("ph": ")") + 7;
+    events.push_back(line.substr(name, line.find('"', name) - name) + " " +
+                     line[ph]);
+  }
+  return events;
+}
+
+}  // namespace
+
+TEST(SlogTraceSubscriberTest, scope_budget_overrun) {
+  const std::string path =
+      "/tmp/slog_trace_test." + std::to_string(getpid()) + ".json";
+  SlogContext::getInstance()->waitAsyncSubscribers();
+  {
+    SlogTraceSubscriber trace = CreateSlogTraceSubscriber(
+        path, SlogTraceConfig::kTrackScopesAndLogs);
+    {
+      SLOG_SCOPE("outer");
+      {
+        SLOG_SCOPE_BUDGET("plan", std::chrono::milliseconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      }
+      SLOG_SCOPE("sibling");
+    }
+    SlogContext::getInstance()->waitAsyncSubscribers();
+  }
+  // The overrun warning is an instant event, not the end of a scope.
+  const std::vector<std::string> expected = {
+      "outer B", "plan B", "plan E", "sibling B", "sibling E", "outer E"};
+  EXPECT_EQ(expected, readScopeEvents(path));
+  std::ifstream file(path);
+  const std::string trace((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+  EXPECT_NE(std::string::npos, trace.find(R"("ph": "i")"));
+  EXPECT_NE(std::string::npos, trace.find("over its budget"));
+  unlink(path.c_str());
+}
+
+}  // namespace slog
@@ -0,0 +1,364 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/codec/codec.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "slog_cc/util/varint.h"
+
+namespace slog {
+
+namespace {
+
+// Upper bound on IDs accepted by the decoder. It protects from allocating huge
+// dictionaries when fed with garbage.
+constexpr uint64_t kMaxDictionaryId = 1 << 24;
+
+void appendString(const std::string& s, std::string* out) {
+  util::appendLengthPrefixed(s.data(), s.size(), out);
+}
+
+}  // namespace
+
+SlogTag SlogTagView::toTag() const {
+  return SlogTag(key_.str(), value_string_.str(), value_numeric_data_,
+                 verbosity_, value_type_);
+}
+
+const SlogTagView* SlogRecordView::find_tag(const char* key) const {
+  const SlogStringView key_view(key, strlen(key));
+  for (const SlogTagView& tag : *this) {
+    if (tag.key() == key_view) {
+      return &tag;
+    }
+  }
+  return nullptr;
+}
+
+SlogRecord SlogRecordView::toRecord() const {
+  SlogRecord record(thread_id_, call_site_id_, severity_);
+  record.set_time(time_);
+  for (const SlogTagView& tag : *this) {
+    record.addTag(tag.toTag());
+  }
+  return record;
+}
+
+uint32_t SlogRecordEncoder::keyId(const std::string& key) {
+  auto it = key_ids_.find(key);
+  if (it != key_ids_.end()) {
+    return it->second;
+  }
+  it = key_ids_.emplace(key, static_cast<uint32_t>(keys_.size())).first;
+  keys_.push_back(&it->first);
+  return it->second;
+}
+
+void SlogRecordEncoder::markCallSite(int32_t call_site_id) {
+  if (call_site_id < 0) {
+    return;
+  }
+  if (static_cast<size_t>(call_site_id) >= call_site_sent_.size()) {
+    call_site_sent_.resize(call_site_id + 1, false);
+  }
+  if (!call_site_sent_[call_site_id]) {
+    call_site_sent_[call_site_id] = true;
+    new_call_sites_.push_back(call_site_id);
+  }
+}
+
+void SlogRecordEncoder::encodeBatch(const SlogRecord* records,
+                                    size_t num_records,
+                                    const SlogCallSiteLookup& call_site_lookup,
+                                    std::string* out) {
+  records_buffer_.clear();
+  new_call_sites_.clear();
+
+  int64_t prev_elapsed_ns = 0;
+  int64_t prev_global_ns = 0;
+  for (size_t i = 0; i < num_records; ++i) {
+    const SlogRecord& r = records[i];
+    if (call_site_lookup) {
+      markCallSite(r.call_site_id());
+    }
+    util::appendVarint(util::zigzagEncode(r.thread_id()), &records_buffer_);
+    util::appendVarint(static_cast<uint32_t>(r.call_site_id()),
+                       &records_buffer_);
+    records_buffer_.push_back(static_cast<char>(r.severity()));
+    records_buffer_.push_back(
+        static_cast<char>(r.time().global_clock_type_id));
+    util::appendVarint(
+        util::zigzagEncode(r.time().elapsed_ns - prev_elapsed_ns),
+        &records_buffer_);
+    util::appendVarint(util::zigzagEncode(r.time().global_ns - prev_global_ns),
+                       &records_buffer_);
+    prev_elapsed_ns = r.time().elapsed_ns;
+    prev_global_ns = r.time().global_ns;
+
+    util::appendVarint(r.tags().size(), &records_buffer_);
+    for (const SlogTag& tag : r.tags()) {
+      util::appendVarint(keyId(tag.key()), &records_buffer_);
+      records_buffer_.push_back(static_cast<char>(
+          static_cast<uint8_t>(tag.valueType()) |
+          static_cast<uint8_t>(tag.verbosity()) << 4));
+      switch (tag.valueType()) {
+        case SlogTagValueType::kNone:
+          break;
+        case SlogTagValueType::kString:
+          appendString(tag.valueString(), &records_buffer_);
+          break;
+        case SlogTagValueType::kInt:
+          util::appendVarint(util::zigzagEncode(tag.valueInt()),
+                             &records_buffer_);
+          break;
+        case SlogTagValueType::kDouble:
+          util::appendFixed(tag.valueNumericData(), &records_buffer_);
+          break;
+      }
+    }
+  }
+
+  writeBatch(num_records, call_site_lookup, out);
+}
+
+void SlogRecordEncoder::encodeDictionary(
+    int32_t num_call_sites, const SlogCallSiteLookup& call_site_lookup,
+    std::string* out) {
+  records_buffer_.clear();
+  new_call_sites_.clear();
+  for (int32_t id = 0; id < num_call_sites; ++id) {
+    markCallSite(id);
+  }
+  writeBatch(0, call_site_lookup, out);
+}
+
+void SlogRecordEncoder::writeBatch(size_t num_records,
+                                   const SlogCallSiteLookup& call_site_lookup,
+                                   std::string* out) {
+  out->push_back(static_cast<char>(kSlogCodecVersion));
+  util::appendVarint(new_call_sites_.size(), out);
+  for (const int32_t id : new_call_sites_) {
+    const SlogCallSite call_site = call_site_lookup(id);
+    util::appendVarint(id, out);
+    util::appendVarint(static_cast<uint32_t>(call_site.line()), out);
+    appendString(call_site.function(), out);
+    appendString(call_site.file(), out);
+  }
+  util::appendVarint(num_keys_sent_, out);
+  util::appendVarint(keys_.size() - num_keys_sent_, out);
+  for (size_t i = num_keys_sent_; i < keys_.size(); ++i) {
+    appendString(*keys_[i], out);
+  }
+  num_keys_sent_ = keys_.size();
+  util::appendVarint(num_records, out);
+  out->append(records_buffer_);
+}
+
+void SlogRecordEncoder::reset() {
+  num_keys_sent_ = 0;
+  call_site_sent_.clear();
+  new_call_sites_.clear();
+}
+
+bool SlogRecordDecoder::decodeBatch(const char* data, size_t size,
+                                    SlogDecodedBatch* batch,
+                                    size_t* consumed) {
+  const char* pos = data;
+  const char* const end = data + size;
+  uint64_t value = 0;
+  const char* str = nullptr;
+  size_t str_size = 0;
+
+  uint8_t version = 0;
+  if (!util::readFixed(&pos, end, &version) || version != kSlogCodecVersion) {
+    return false;
+  }
+
+  // Dictionary updates are staged and committed only when the whole batch is
+  // valid.
+  std::vector<std::pair<int32_t, SlogCallSite>> new_call_sites;
+  uint64_t num_call_sites = 0;
+  if (!util::readVarint(&pos, end, &num_call_sites)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < num_call_sites; ++i) {
+    uint64_t id = 0;
+    uint64_t line = 0;
+    const char* function = nullptr;
+    size_t function_size = 0;
+    if (!util::readVarint(&pos, end, &id) || id >= kMaxDictionaryId ||
+        !util::readVarint(&pos, end, &line) ||
+        !util::readLengthPrefixed(&pos, end, &function, &function_size) ||
+        !util::readLengthPrefixed(&pos, end, &str, &str_size)) {
+      return false;
+    }
+    new_call_sites.emplace_back(
+        static_cast<int32_t>(id),
+        SlogCallSite(std::string(function, function_size),
+                     std::string(str, str_size), static_cast<int32_t>(line)));
+  }
+
+  uint64_t first_key_id = 0;
+  uint64_t num_new_keys = 0;
+  if (!util::readVarint(&pos, end, &first_key_id) ||
+      first_key_id > keys_.size() ||
+      !util::readVarint(&pos, end, &num_new_keys) ||
+      first_key_id + num_new_keys >= kMaxDictionaryId) {
+    return false;
+  }
+  std::vector<SlogStringView> new_keys;
+  for (uint64_t i = 0; i < num_new_keys; ++i) {
+    if (!util::readLengthPrefixed(&pos, end, &str, &str_size)) {
+      return false;
+    }
+    new_keys.emplace_back(str, str_size);
+  }
+  const uint64_t num_keys =
+      std::max<uint64_t>(keys_.size(), first_key_id + num_new_keys);
+
+  uint64_t num_records = 0;
+  if (!util::readVarint(&pos, end, &num_records) ||
+      num_records > static_cast<uint64_t>(end - pos)) {
+    return false;
+  }
+  batch->records.clear();
+  batch->tags.clear();
+  batch->records.reserve(num_records);
+  // Tag pointers and key views are resolved once batch->tags stops growing and
+  // new keys are committed to keys_.
+  std::vector<size_t> tag_offsets;
+  tag_offsets.reserve(num_records);
+  std::vector<uint32_t> tag_key_ids;
+
+  int64_t prev_elapsed_ns = 0;
+  int64_t prev_global_ns = 0;
+  for (uint64_t i = 0; i < num_records; ++i) {
+    SlogRecordView r;
+    uint64_t thread_id = 0;
+    uint64_t call_site_id = 0;
+    uint8_t severity = 0;
+    uint8_t clock_type = 0;
+    uint64_t elapsed_delta = 0;
+    uint64_t global_delta = 0;
+    uint64_t num_tags = 0;
+    if (!util::readVarint(&pos, end, &thread_id) ||
+        !util::readVarint(&pos, end, &call_site_id) ||
+        !util::readFixed(&pos, end, &severity) ||
+        !util::readFixed(&pos, end, &clock_type) ||
+        !util::readVarint(&pos, end, &elapsed_delta) ||
+        !util::readVarint(&pos, end, &global_delta) ||
+        !util::readVarint(&pos, end, &num_tags) ||
+        num_tags > static_cast<uint64_t>(end - pos)) {
+      return false;
+    }
+    r.thread_id_ = static_cast<int32_t>(util::zigzagDecode(thread_id));
+    r.call_site_id_ = static_cast<int32_t>(call_site_id);
+    r.severity_ = static_cast<int8_t>(severity);
+    r.time_.global_clock_type_id =
+        static_cast<SlogGlobalClockTypeId>(clock_type);
+    r.time_.elapsed_ns = prev_elapsed_ns + util::zigzagDecode(elapsed_delta);
+    r.time_.global_ns = prev_global_ns + util::zigzagDecode(global_delta);
+    prev_elapsed_ns = r.time_.elapsed_ns;
+    prev_global_ns = r.time_.global_ns;
+    r.num_tags_ = num_tags;
+    tag_offsets.push_back(batch->tags.size());
+
+    for (uint64_t j = 0; j < num_tags; ++j) {
+      SlogTagView tag;
+      uint64_t key_id = 0;
+      uint8_t meta = 0;
+      if (!util::readVarint(&pos, end, &key_id) || key_id >= num_keys ||
+          !util::readFixed(&pos, end, &meta)) {
+        return false;
+      }
+      tag.value_type_ = static_cast<SlogTagValueType>(meta & 0x0f);
+      tag.verbosity_ = static_cast<SlogTagVerbosity>(meta >> 4);
+      switch (tag.value_type_) {
+        case SlogTagValueType::kNone:
+          break;
+        case SlogTagValueType::kString:
+          if (!util::readLengthPrefixed(&pos, end, &str, &str_size)) {
+            return false;
+          }
+          tag.value_string_ = SlogStringView(str, str_size);
+          break;
+        case SlogTagValueType::kInt:
+          if (!util::readVarint(&pos, end, &value)) {
+            return false;
+          }
+          tag.value_numeric_data_ =
+              static_cast<uint64_t>(util::zigzagDecode(value));
+          break;
+        case SlogTagValueType::kDouble:
+          if (!util::readFixed(&pos, end, &tag.value_numeric_data_)) {
+            return false;
+          }
+          break;
+        default:
+          return false;
+      }
+      tag_key_ids.push_back(static_cast<uint32_t>(key_id));
+      batch->tags.push_back(tag);
+    }
+    batch->records.push_back(r);
+  }
+
+  // The batch is valid, commit dictionary updates.
+  for (size_t i = keys_.size() - first_key_id; i < new_keys.size(); ++i) {
+    keys_.emplace_back(new_keys[i].str());
+  }
+  for (const auto& item : new_call_sites) {
+    addCallSite(item.first, item.second);
+  }
+
+  for (size_t i = 0; i < batch->tags.size(); ++i) {
+    batch->tags[i].key_ = SlogStringView(keys_[tag_key_ids[i]]);
+  }
+  for (size_t i = 0; i < batch->records.size(); ++i) {
+    batch->records[i].tags_ = batch->tags.data() + tag_offsets[i];
+  }
+  *consumed = pos - data;
+  return true;
+}
+
+const SlogCallSite* SlogRecordDecoder::callSite(int32_t call_site_id) const {
+  if (call_site_id < 0 ||
+      static_cast<size_t>(call_site_id) >= call_sites_.size() ||
+      !has_call_site_[call_site_id]) {
+    return nullptr;
+  }
+  return &call_sites_[call_site_id];
+}
+
+void SlogRecordDecoder::addCallSite(int32_t call_site_id,
+                                    const SlogCallSite& call_site) {
+  const size_t id = call_site_id;
+  if (id >= call_sites_.size()) {
+    call_sites_.resize(id + 1, SlogCallSite("", "", 0));
+    has_call_site_.resize(id + 1, false);
+  }
+  call_sites_[id] = call_site;
+  has_call_site_[id] = true;
+}
+
+void SlogRecordDecoder::reset() {
+  keys_.clear();
+  call_sites_.clear();
+  has_call_site_.clear();
+}
+
+}  // namespace slog
@@ -0,0 +1,235 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_codec_codec
+#define slog_cc_codec_codec
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "slog_cc/primitives/call_site.h"
+#include "slog_cc/primitives/record.h"
+#include "slog_cc/primitives/tag.h"
+#include "slog_cc/primitives/timestamps.h"
+#include "slog_cc/util/inline_macro.h"
+
+namespace slog {
+
+// Compact binary encoding of Slog records. It is the common format for files,
+// IPC and exports. The unit of encoding is a batch:
+//
+//   u8      version (kSlogCodecVersion)
+//   varint  number of new call sites, then for each:
+//             varint id, varint line, string function, string file
+//   varint  id of the first new tag key, varint number of new tag keys, then
+//             for each: string key
+//   varint  number of records, then for each:
+//             zigzag  thread_id
+//             varint  call_site_id
+//             u8      severity
+//             u8      global clock type id
+//             zigzag  elapsed_ns delta to the previous record of the batch
+//             zigzag  global_ns delta to the previous record of the batch
+//             varint  number of tags, then for each:
+//                       varint key id
+//                       u8     value type | verbosity << 4
+//                       value: string, zigzag varint or 8 bytes of double
+//
+// Strings are a varint length followed by raw bytes. Call sites and tag keys
+// are sent once per encoder lifetime (or after reset()), so a decoder must see
+// all batches of a stream in order.
+constexpr uint8_t kSlogCodecVersion = 1;
+
+// Non-owning reference to a string inside of an encoded buffer. C++14 has no
+// std::string_view.
+class SlogStringView {
+ public:
+  SlogStringView() = default;
+  SLOG_INLINE SlogStringView(const char* data, size_t size)
+      : data_(data), size_(size) {}
+  SLOG_INLINE SlogStringView(const std::string& s)
+      : data_(s.data()), size_(s.size()) {}
+
+  SLOG_INLINE const char* data() const { return data_; }
+  SLOG_INLINE size_t size() const { return size_; }
+  SLOG_INLINE bool empty() const { return size_ == 0; }
+  SLOG_INLINE std::string str() const { return std::string(data_, size_); }
+
+  SLOG_INLINE bool operator==(const SlogStringView& other) const {
+    return size_ == other.size_ &&
+           (size_ == 0 || memcmp(data_, other.data_, size_) == 0);
+  }
+  SLOG_INLINE bool operator!=(const SlogStringView& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  const char* data_ = "";
+  size_t size_ = 0;
+};
+
+class SlogTagView {
+ public:
+  SLOG_INLINE SlogStringView key() const { return key_; }
+  SLOG_INLINE SlogTagVerbosity verbosity() const { return verbosity_; }
+  SLOG_INLINE SlogTagValueType valueType() const { return value_type_; }
+  SLOG_INLINE uint64_t valueNumericData() const { return value_numeric_data_; }
+  SLOG_INLINE int64_t valueInt() const {
+    return static_cast<int64_t>(value_numeric_data_);
+  }
+  SLOG_INLINE double valueDouble() const {
+    double value;
+    memcpy(&value, &value_numeric_data_, sizeof(value));
+    return value;
+  }
+  SLOG_INLINE SlogStringView valueString() const { return value_string_; }
+
+  // Materializes an owning SlogTag.
+  SlogTag toTag() const;
+
+ private:
+  friend class SlogRecordDecoder;
+
+  SlogStringView key_;
+  SlogStringView value_string_;
+  uint64_t value_numeric_data_ = 0;
+  SlogTagVerbosity verbosity_ = SlogTagVerbosity::kSilent;
+  SlogTagValueType value_type_ = SlogTagValueType::kNone;
+};
+
+class SlogRecordView {
+ public:
+  SLOG_INLINE int32_t thread_id() const { return thread_id_; }
+  SLOG_INLINE int32_t call_site_id() const { return call_site_id_; }
+  SLOG_INLINE int8_t severity() const { return severity_; }
+  SLOG_INLINE const SlogTimestamps& time() const { return time_; }
+
+  SLOG_INLINE size_t numTags() const { return num_tags_; }
+  SLOG_INLINE const SlogTagView& tag(size_t i) const { return tags_[i]; }
+  SLOG_INLINE const SlogTagView* begin() const { return tags_; }
+  SLOG_INLINE const SlogTagView* end() const { return tags_ + num_tags_; }
+  const SlogTagView* find_tag(const char* key) const;
+
+  // Materializes an owning SlogRecord, e.g. to pass it to regular subscribers.
+  SlogRecord toRecord() const;
+
+ private:
+  friend class SlogRecordDecoder;
+
+  int32_t thread_id_ = -1;
+  int32_t call_site_id_ = -1;
+  SlogTimestamps time_;
+  int8_t severity_ = -1;
+  const SlogTagView* tags_ = nullptr;
+  size_t num_tags_ = 0;
+};
+
+// Records of a decoded batch. Record views reference tags_ storage of this
+// struct, string views reference the encoded buffer and the decoder key
+// dictionary, so all three must outlive the views.
+struct SlogDecodedBatch {
+  std::vector<SlogRecordView> records;
+  std::vector<SlogTagView> tags;
+};
+
+using SlogCallSiteLookup = std::function<SlogCallSite(int32_t call_site_id)>;
+
+class SlogRecordEncoder {
+ public:
+  // Appends an encoded batch of records to `out`. Call sites referenced by the
+  // records and not sent before are looked up with `call_site_lookup` and
+  // written to the batch dictionary. An empty lookup skips call sites.
+  void encodeBatch(const SlogRecord* records, size_t num_records,
+                   const SlogCallSiteLookup& call_site_lookup,
+                   std::string* out);
+
+  SLOG_INLINE void encodeBatch(const std::vector<SlogRecord>& records,
+                               const SlogCallSiteLookup& call_site_lookup,
+                               std::string* out) {
+    encodeBatch(records.data(), records.size(), call_site_lookup, out);
+  }
+
+  // Encodes a batch without records that carries call sites
+  // [0, num_call_sites) and tag keys not sent yet. Used to write dictionary
+  // headers right after reset().
+  void encodeDictionary(int32_t num_call_sites,
+                        const SlogCallSiteLookup& call_site_lookup,
+                        std::string* out);
+
+  // Forgets call sites and keys sent so far. The next batch becomes decodable
+  // by a fresh decoder, e.g. at the start of a new file or connection.
+  void reset();
+
+ private:
+  uint32_t keyId(const std::string& key);
+  void markCallSite(int32_t call_site_id);
+  // Writes the batch header with new call sites and keys followed by
+  // records_buffer_.
+  void writeBatch(size_t num_records,
+                  const SlogCallSiteLookup& call_site_lookup,
+                  std::string* out);
+
+  std::unordered_map<std::string, uint32_t> key_ids_;
+  // Keys in order of their IDs.
+  std::vector<const std::string*> keys_;
+  // Number of keys already written to the stream.
+  size_t num_keys_sent_ = 0;
+
+  std::vector<bool> call_site_sent_;
+  std::vector<int32_t> new_call_sites_;
+
+  std::string records_buffer_;
+};
+
+class SlogRecordDecoder {
+ public:
+  // Decodes one batch starting at `data`. On success returns true, fills
+  // `batch` with views and sets `consumed` to the number of bytes read. Returns
+  // false on a truncated or malformed batch, or a batch that refers to keys of
+  // batches the decoder didn't see; the decoder state is unchanged then.
+  // Batches with keys the decoder already knows may be decoded again in any
+  // order, which allows random access once the dictionary is complete.
+  bool decodeBatch(const char* data, size_t size, SlogDecodedBatch* batch,
+                   size_t* consumed);
+
+  // Returns nullptr for call sites that were not received.
+  const SlogCallSite* callSite(int32_t call_site_id) const;
+  SLOG_INLINE size_t numCallSites() const { return call_sites_.size(); }
+  SLOG_INLINE size_t numKeys() const { return keys_.size(); }
+  SLOG_INLINE const std::string& key(size_t key_id) const {
+    return keys_[key_id];
+  }
+
+  // Seed the dictionary from an external source, e.g. a saved index. Keys must
+  // be added in order of their IDs.
+  void addCallSite(int32_t call_site_id, const SlogCallSite& call_site);
+  SLOG_INLINE void addKey(const std::string& key) { keys_.push_back(key); }
+
+  void reset();
+
+ private:
+  // std::deque keeps references valid on growth, views point into it.
+  std::deque<std::string> keys_;
+  std::vector<SlogCallSite> call_sites_;
+  std::vector<bool> has_call_site_;
+};
+
+}  // namespace slog
+
+#endif
@@ -0,0 +1,177 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/codec/codec.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/printer/printer.h"
+
+namespace slog {
+
+namespace {
+
+SlogRecord makeRecord(int32_t call_site_id, int64_t elapsed_ns) {
+  SlogRecord record(42, call_site_id, WARNING);
+  record.set_time(SlogTimestamps{elapsed_ns, 1600000000000000000 + elapsed_ns,
+                                 SlogGlobalClockTypeId::kGpsEpochClock});
+  record.addTag("just_key");
+  record.addTag("string-key", "foo");
+  record.addTag("int-key", -123);
+  record.addTag("double-key", 12.3, SlogTagVerbosity::kSilent);
+  return record;
+}
+
+SlogCallSite lookupCallSite(int32_t id) {
+  return SlogCallSite("func" + std::to_string(id), "dir/file.cpp", id * 10);
+}
+
+}  // namespace
+
+TEST(SlogCodecTest, roundtrip) {
+  std::vector<SlogRecord> records;
+  records.push_back(makeRecord(1, 1000));
+  records.push_back(makeRecord(2, 1500));
+  records.push_back(makeRecord(1, 900));
+
+  SlogRecordEncoder encoder;
+  std::string encoded;
+  encoder.encodeBatch(records, lookupCallSite, &encoded);
+
+  SlogRecordDecoder decoder;
+  SlogDecodedBatch batch;
+  size_t consumed = 0;
+  ASSERT_TRUE(
+      decoder.decodeBatch(encoded.data(), encoded.size(), &batch, &consumed));
+  EXPECT_EQ(encoded.size(), consumed);
+  ASSERT_EQ(records.size(), batch.records.size());
+  for (size_t i = 0; i < records.size(); ++i) {
+    EXPECT_EQ(SlogPrinter().jsonString(records[i]),
+              SlogPrinter().jsonString(batch.records[i].toRecord()));
+    EXPECT_EQ(records[i].time().global_clock_type_id,
+              batch.records[i].time().global_clock_type_id);
+  }
+
+  const SlogRecordView& view = batch.records[0];
+  ASSERT_EQ(4, view.numTags());
+  EXPECT_EQ("string-key", view.tag(1).key().str());
+  EXPECT_EQ("foo", view.tag(1).valueString().str());
+  // String values are views into the encoded buffer, no copies.
+  EXPECT_GE(view.tag(1).valueString().data(), encoded.data());
+  EXPECT_LT(view.tag(1).valueString().data(), encoded.data() + encoded.size());
+  EXPECT_EQ(-123, view.find_tag("int-key")->valueInt());
+  EXPECT_EQ(12.3, view.find_tag("double-key")->valueDouble());
+  EXPECT_EQ(SlogTagVerbosity::kSilent,
+            view.find_tag("double-key")->verbosity());
+  EXPECT_EQ(nullptr, view.find_tag("missing-key"));
+
+  ASSERT_NE(nullptr, decoder.callSite(2));
+  EXPECT_EQ("func2", decoder.callSite(2)->function());
+  EXPECT_EQ(20, decoder.callSite(2)->line());
+  EXPECT_EQ(nullptr, decoder.callSite(3));
+}
+
+TEST(SlogCodecTest, incremental_dictionary) {
+  SlogRecordEncoder encoder;
+  std::string batch1;
+  std::string batch2;
+  encoder.encodeBatch(std::vector<SlogRecord>{makeRecord(1, 10)},
+                      lookupCallSite, &batch1);
+  encoder.encodeBatch(std::vector<SlogRecord>{makeRecord(1, 20)},
+                      lookupCallSite, &batch2);
+  // The second batch doesn't repeat the call site and tag keys.
+  EXPECT_LT(batch2.size(), batch1.size());
+
+  SlogRecordDecoder decoder;
+  SlogDecodedBatch batch;
+  size_t consumed = 0;
+  // Decoding a continuation batch without the first one is an error.
+  EXPECT_FALSE(
+      decoder.decodeBatch(batch2.data(), batch2.size(), &batch, &consumed));
+  ASSERT_TRUE(
+      decoder.decodeBatch(batch1.data(), batch1.size(), &batch, &consumed));
+  ASSERT_TRUE(
+      decoder.decodeBatch(batch2.data(), batch2.size(), &batch, &consumed));
+  ASSERT_EQ(1, batch.records.size());
+  EXPECT_EQ(20, batch.records[0].time().elapsed_ns);
+  EXPECT_EQ("just_key", batch.records[0].tag(0).key().str());
+
+  // Once the dictionary is known, batches can be decoded again in any order.
+  ASSERT_TRUE(
+      decoder.decodeBatch(batch1.data(), batch1.size(), &batch, &consumed));
+  EXPECT_EQ(10, batch.records[0].time().elapsed_ns);
+  EXPECT_EQ(4, decoder.numKeys());
+
+  // After reset the encoder produces a batch readable by a fresh decoder.
+  encoder.reset();
+  std::string batch3;
+  encoder.encodeBatch(std::vector<SlogRecord>{makeRecord(1, 30)},
+                      lookupCallSite, &batch3);
+  SlogRecordDecoder fresh_decoder;
+  ASSERT_TRUE(fresh_decoder.decodeBatch(batch3.data(), batch3.size(), &batch,
+                                        &consumed));
+  EXPECT_EQ("func1", fresh_decoder.callSite(1)->function());
+}
+
+TEST(SlogCodecTest, dictionary_batch) {
+  SlogRecordEncoder encoder;
+  std::string encoded;
+  encoder.encodeDictionary(3, lookupCallSite, &encoded);
+  SlogRecordDecoder decoder;
+  SlogDecodedBatch batch;
+  size_t consumed = 0;
+  ASSERT_TRUE(
+      decoder.decodeBatch(encoded.data(), encoded.size(), &batch, &consumed));
+  EXPECT_EQ(0, batch.records.size());
+  EXPECT_EQ(3, decoder.numCallSites());
+  EXPECT_EQ("func0", decoder.callSite(0)->function());
+  EXPECT_EQ("func2", decoder.callSite(2)->function());
+}
+
+TEST(SlogCodecTest, truncated) {
+  SlogRecordEncoder encoder;
+  std::string encoded;
+  encoder.encodeBatch(std::vector<SlogRecord>{makeRecord(1, 10)},
+                      lookupCallSite, &encoded);
+  SlogRecordDecoder decoder;
+  SlogDecodedBatch batch;
+  size_t consumed = 0;
+  for (size_t size = 0; size < encoded.size(); ++size) {
+    EXPECT_FALSE(decoder.decodeBatch(encoded.data(), size, &batch, &consumed));
+  }
+  // Failed attempts leave the decoder state unchanged.
+  EXPECT_EQ(0, decoder.numKeys());
+  EXPECT_TRUE(
+      decoder.decodeBatch(encoded.data(), encoded.size(), &batch, &consumed));
+}
+
+TEST(SlogCodecTest, compact) {
+  std::vector<SlogRecord> records;
+  for (int i = 0; i < 100; ++i) {
+    records.push_back(makeRecord(1 + i % 5, 1000 * i));
+  }
+  SlogRecordEncoder encoder;
+  std::string encoded;
+  encoder.encodeBatch(records, lookupCallSite, &encoded);
+  size_t json_size = 0;
+  for (const auto& record : records) {
+    json_size += SlogPrinter().jsonString(record).size();
+  }
+  EXPECT_LT(encoded.size() * 10, json_size);
+}
+
+}  // namespace slog
@@ -0,0 +1,106 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/codec/segment.h"
+
+#include <cstring>
+
+#include "slog_cc/util/crc32c.h"
+#include "slog_cc/util/varint.h"
+
+namespace slog {
+
+void appendSegmentHeader(const SlogSegmentHeader& header, std::string* out) {
+  out->append(kSlogSegmentMagic, sizeof(kSlogSegmentMagic));
+  util::appendFixed<uint32_t>(header.version, out);
+  util::appendFixed<uint32_t>(0, out);
+  util::appendFixed<int64_t>(header.created_unix_ns, out);
+  util::appendFixed<int64_t>(header.sequence, out);
+}
+
+bool parseSegmentHeader(const char* data, size_t size,
+                        SlogSegmentHeader* header) {
+  if (size < kSlogSegmentHeaderSize ||
+      memcmp(data, kSlogSegmentMagic, sizeof(kSlogSegmentMagic)) != 0) {
+    return false;
+  }
+  const char* pos = data + sizeof(kSlogSegmentMagic);
+  const char* end = data + kSlogSegmentHeaderSize;
+  uint32_t reserved = 0;
+  return util::readFixed(&pos, end, &header->version) &&
+         header->version == kSlogSegmentVersion &&
+         util::readFixed(&pos, end, &reserved) &&
+         util::readFixed(&pos, end, &header->created_unix_ns) &&
+         util::readFixed(&pos, end, &header->sequence);
+}
+
+void appendBlock(const char* payload, size_t size, std::string* out) {
+  util::appendFixed<uint32_t>(kSlogBlockMagic, out);
+  util::appendFixed<uint32_t>(static_cast<uint32_t>(size), out);
+  util::appendFixed<uint32_t>(util::crc32c(payload, size), out);
+  out->append(payload, size);
+}
+
+void appendPadding(size_t alignment, std::string* out) {
+  const size_t remainder = out->size() % alignment;
+  if (remainder == 0) {
+    return;
+  }
+  size_t padding = alignment - remainder;
+  while (padding < kSlogBlockHeaderSize) {
+    padding += alignment;
+  }
+  util::appendFixed<uint32_t>(kSlogPaddingMagic, out);
+  util::appendFixed<uint32_t>(
+      static_cast<uint32_t>(padding - kSlogBlockHeaderSize), out);
+  util::appendFixed<uint32_t>(0, out);
+  out->append(padding - kSlogBlockHeaderSize, '\0');
+}
+
+SlogBlockStatus readBlock(const char** pos, const char* end,
+                          const char** payload, size_t* payload_size) {
+  const char* p = *pos;
+  uint32_t magic = 0;
+  uint32_t size = 0;
+  uint32_t crc = 0;
+  while (true) {
+    if (p == end) {
+      *pos = p;
+      return SlogBlockStatus::kEnd;
+    }
+    if (!util::readFixed(&p, end, &magic) ||
+        !util::readFixed(&p, end, &size) || !util::readFixed(&p, end, &crc)) {
+      return SlogBlockStatus::kTruncated;
+    }
+    if (magic != kSlogBlockMagic && magic != kSlogPaddingMagic) {
+      return SlogBlockStatus::kCorrupted;
+    }
+    if (static_cast<size_t>(end - p) < size) {
+      return SlogBlockStatus::kTruncated;
+    }
+    if (magic == kSlogBlockMagic) {
+      break;
+    }
+    p += size;
+  }
+  if (util::crc32c(p, size) != crc) {
+    return SlogBlockStatus::kCorrupted;
+  }
+  *payload = p;
+  *payload_size = size;
+  *pos = p + size;
+  return SlogBlockStatus::kOk;
+}
+
+}  // namespace slog
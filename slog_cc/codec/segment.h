@@ -0,0 +1,97 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_codec_segment
+#define slog_cc_codec_segment
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace slog {
+
+// Layout of a binary log segment file:
+//
+//   segment header, kSlogSegmentHeaderSize bytes:
+//     char[8] kSlogSegmentMagic
+//     u32     format version (kSlogSegmentVersion)
+//     u32     reserved, 0
+//     i64     creation time, unix ns
+//     i64     segment sequence number
+//   blocks, each:
+//     u32     kSlogBlockMagic
+//     u32     payload size
+//     u32     CRC-32C of the payload
+//     payload: one batch encoded with SlogRecordEncoder
+//   or padding blocks between them, each:
+//     u32     kSlogPaddingMagic
+//     u32     payload size
+//     u32     0
+//     payload: zeros
+//
+// Padding lets writers flush data early and still start the next write at an
+// aligned offset; readers skip it.
+//
+// The first block of a segment is a dictionary batch with all call sites and
+// tag keys known at the moment of opening the segment, and the encoder is
+// reset on every segment, so each segment is decodable on its own. The block
+// checksum lets readers detect a torn tail of a segment written by a crashed
+// process and keep all blocks before it.
+constexpr char kSlogSegmentMagic[8] = {'S', 'L', 'O', 'G', 'S', 'E', 'G', 0};
+constexpr uint32_t kSlogSegmentVersion = 1;
+constexpr size_t kSlogSegmentHeaderSize = 32;
+// "SLBK" in little endian.
+constexpr uint32_t kSlogBlockMagic = 0x4b424c53;
+// "SLPD" in little endian.
+constexpr uint32_t kSlogPaddingMagic = 0x44504c53;
+constexpr size_t kSlogBlockHeaderSize = 12;
+
+struct SlogSegmentHeader {
+  uint32_t version = kSlogSegmentVersion;
+  int64_t created_unix_ns = 0;
+  int64_t sequence = 0;
+};
+
+void appendSegmentHeader(const SlogSegmentHeader& header, std::string* out);
+
+// Returns false if data doesn't start with a valid segment header.
+bool parseSegmentHeader(const char* data, size_t size,
+                        SlogSegmentHeader* header);
+
+// Appends a framed block with a given payload.
+void appendBlock(const char* payload, size_t size, std::string* out);
+
+// Appends a padding block, if needed, so that the size of `out` becomes a
+// multiple of `alignment`.
+void appendPadding(size_t alignment, std::string* out);
+
+enum class SlogBlockStatus {
+  kOk,
+  // No more data.
+  kEnd,
+  // The block is cut, e.g. the writer crashed in the middle of a write.
+  kTruncated,
+  // Wrong magic or checksum mismatch.
+  kCorrupted,
+};
+
+// Reads a block at *pos, skipping padding blocks. On kOk sets the payload and
+// advances *pos to the next block. On kEnd advances *pos past trailing padding,
+// otherwise leaves *pos unchanged.
+SlogBlockStatus readBlock(const char** pos, const char* end,
+                          const char** payload, size_t* payload_size);
+
+}  // namespace slog
+
+#endif
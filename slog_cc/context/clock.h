@@ -0,0 +1,134 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_context_clock
+#define slog_cc_context_clock
+
+#include <time.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "slog_cc/primitives/timestamps.h"
+#include "slog_cc/util/inline_macro.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace slog {
+
+// Clocks of SlogContext::getTimestamps(). Built-in clocks are read inline in
+// the emitting thread.
+enum class SlogClock {
+  // CLOCK_MONOTONIC and CLOCK_REALTIME, the default.
+  kMonotonic,
+  // CLOCK_MONOTONIC_COARSE and CLOCK_REALTIME_COARSE: a few ns per read with
+  // the resolution of the kernel tick (1-4 ms).
+  kCoarse,
+  // One TSC read converted by SlogTscConversion, calibrated by a SlogTscClock.
+  kTsc,
+  // A user function set with SlogContext::setGetTimestampsFunc(), e.g. a GPS
+  // clock.
+  kCustom,
+};
+
+SLOG_INLINE int64_t clockGettimeNs(clockid_t clock_id) {
+  struct timespec ts;
+  clock_gettime(clock_id, &ts);
+  return ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+SLOG_INLINE SlogTimestamps clockGettimeTimestamps(clockid_t elapsed_clock_id,
+                                                  clockid_t global_clock_id) {
+  const int64_t elapsed_ns = clockGettimeNs(elapsed_clock_id);
+  const int64_t global_ns = clockGettimeNs(global_clock_id);
+  return SlogTimestamps{elapsed_ns, global_ns,
+                        SlogGlobalClockTypeId::kWallTimeClock};
+}
+
+// Conversion of TSC ticks to CLOCK_MONOTONIC and CLOCK_REALTIME nanoseconds:
+//   elapsed_ns = base_ns + (ticks - base_ticks) * mult >> kMultShift
+//   global_ns = elapsed_ns + realtime_offset_ns
+// Published by one writer with a seqlock, readers never block. Owned by the
+// context, so it outlives any reader.
+class SlogTscConversion {
+ public:
+  static constexpr int kMultShift = 32;
+
+  SLOG_INLINE SlogTimestamps now() const noexcept {
+    int64_t realtime_offset_ns;
+    const int64_t elapsed_ns = elapsedNs(&realtime_offset_ns);
+    return SlogTimestamps{elapsed_ns, elapsed_ns + realtime_offset_ns,
+                          SlogGlobalClockTypeId::kWallTimeClock};
+  }
+
+  // CLOCK_MONOTONIC nanoseconds, and the offset to CLOCK_REALTIME if asked.
+  SLOG_INLINE int64_t elapsedNs(
+      int64_t* realtime_offset_ns = nullptr) const noexcept {
+    uint32_t seq;
+    uint64_t base_ticks, mult;
+    int64_t base_ns, offset_ns;
+    do {
+      seq = seq_.load(std::memory_order_acquire);
+      base_ticks = base_ticks_.load(std::memory_order_relaxed);
+      base_ns = base_ns_.load(std::memory_order_relaxed);
+      mult = mult_.load(std::memory_order_relaxed);
+      offset_ns = realtime_offset_ns_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) != 0 || seq != seq_.load(std::memory_order_relaxed));
+    if (realtime_offset_ns != nullptr) {
+      *realtime_offset_ns = offset_ns;
+    }
+    return base_ns +
+           toNs(static_cast<int64_t>(readTicks() - base_ticks), mult);
+  }
+
+  void publish(uint64_t base_ticks, int64_t base_ns, uint64_t mult,
+               int64_t realtime_offset_ns) {
+    const uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    base_ticks_.store(base_ticks, std::memory_order_relaxed);
+    base_ns_.store(base_ns, std::memory_order_relaxed);
+    mult_.store(mult, std::memory_order_relaxed);
+    realtime_offset_ns_.store(realtime_offset_ns, std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  static SLOG_INLINE uint64_t readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+  }
+
+  static SLOG_INLINE int64_t toNs(int64_t ticks, uint64_t mult) {
+    return static_cast<int64_t>((static_cast<__int128>(ticks) * mult) >>
+                                kMultShift);
+  }
+
+ private:
+  // Even when stable.
+  std::atomic<uint32_t> seq_{0};
+  std::atomic<uint64_t> base_ticks_{0};
+  std::atomic<int64_t> base_ns_{0};
+  std::atomic<uint64_t> mult_{0};
+  std::atomic<int64_t> realtime_offset_ns_{0};
+};
+
+}  // namespace slog
+
+#endif
@@ -0,0 +1,105 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/context/clock.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/context/context.h"
+
+namespace slog {
+
+namespace {
+
+int64_t clockNs(clockid_t clock_id) {
+  struct timespec ts;
+  clock_gettime(clock_id, &ts);
+  return ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+}  // namespace
+
+TEST(SlogClock, monotonic) {
+  auto context = SlogContext::getInstance();
+  EXPECT_EQ(SlogClock::kMonotonic, context->clock());
+  const int64_t before_ns = clockNs(CLOCK_MONOTONIC);
+  const SlogTimestamps timestamps = context->getTimestamps();
+  const int64_t elapsed_ns = context->getElapsedNs();
+  const int64_t after_ns = clockNs(CLOCK_MONOTONIC);
+  EXPECT_LE(before_ns, timestamps.elapsed_ns);
+  EXPECT_LE(timestamps.elapsed_ns, elapsed_ns);
+  EXPECT_LE(elapsed_ns, after_ns);
+}
+
+TEST(SlogClock, coarse) {
+  auto context = SlogContext::getInstance();
+  context->setClock(SlogClock::kCoarse);
+  const int64_t before_ns = clockNs(CLOCK_MONOTONIC_COARSE);
+  const SlogTimestamps timestamps = context->getTimestamps();
+  const int64_t after_ns = clockNs(CLOCK_MONOTONIC_COARSE);
+  context->setClock(SlogClock::kMonotonic);
+  EXPECT_LE(before_ns, timestamps.elapsed_ns);
+  EXPECT_LE(timestamps.elapsed_ns, after_ns);
+}
+
+TEST(SlogClock, custom) {
+  auto context = SlogContext::getInstance();
+  context->setGetTimestampsFunc([] {
+    return SlogTimestamps{1, 2, SlogGlobalClockTypeId::kGpsEpochClock};
+  });
+  EXPECT_EQ(SlogClock::kCustom, context->clock());
+  const SlogTimestamps timestamps = context->getTimestamps();
+  const int64_t elapsed_ns = context->getElapsedNs();
+  context->setClock(SlogClock::kMonotonic);
+  EXPECT_EQ(1, timestamps.elapsed_ns);
+  EXPECT_EQ(1, elapsed_ns);
+  EXPECT_EQ(2, timestamps.global_ns);
+  EXPECT_EQ(SlogGlobalClockTypeId::kGpsEpochClock,
+            timestamps.global_clock_type_id);
+}
+
+TEST(SlogClock, switch_while_logging) {
+  auto context = SlogContext::getInstance();
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      while (!stop) {
+        EXPECT_GT(context->getTimestamps().elapsed_ns, 0);
+      }
+    });
+  }
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 2 == 0) {
+      context->setGetTimestampsFunc([i] {
+        return SlogTimestamps{i + 1, i + 1,
+                              SlogGlobalClockTypeId::kWallTimeClock};
+      });
+    } else {
+      context->setClock(i % 3 == 0 ? SlogClock::kCoarse
+                                   : SlogClock::kMonotonic);
+    }
+  }
+  stop = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  context->setClock(SlogClock::kMonotonic);
+}
+
+}  // namespace slog
@@ -14,6 +14,11 @@
 
 #include "slog_cc/context/context.h"
 
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
 namespace slog {
 
 std::shared_ptr<SlogContext> SlogContext::getInstance() noexcept {
@@ -25,20 +30,19 @@ std::shared_ptr<SlogContext> SlogContext::getInstance() noexcept {
   }
 }
 
-SlogContext::SlogContext() : get_timestamps_func_(kDefaultGetTimestampsFunc) {
+SlogContext::SlogContext() : get_timestamps_func_(&kDefaultGetTimestampsFunc) {
   resetAsyncNotificationQueue();
   resetCallSites();
-  echo_to_glog_ = createSyncSubscriber(
-      [this](const SlogRecord& record) { emitStderrLine(record); });
-}
-
-SlogTimestamps SlogContext::getTimestamps() const noexcept {
-  return get_timestamps_func_();
 }
 
 void SlogContext::setGetTimestampsFunc(
     const std::function<SlogTimestamps()>& func) {
-  get_timestamps_func_ = func;
+  std::lock_guard<std::mutex> lock(get_timestamps_funcs_mutex_);
+  get_timestamps_funcs_.emplace_back(
+      std::make_unique<std::function<SlogTimestamps()>>(func));
+  get_timestamps_func_.store(get_timestamps_funcs_.back().get(),
+                             std::memory_order_release);
+  setClock(SlogClock::kCustom);
 }
 
 const std::function<SlogTimestamps()> SlogContext::kDefaultGetTimestampsFunc =
@@ -47,27 +51,150 @@ const std::function<SlogTimestamps()> SlogContext::kDefaultGetTimestampsFunc =
       // CLOCK_MONOTONIC_RAW takes ~66ns to get time with X ns precision,
       // CLOCK_MONOTONIC takes ~12ns with Y ns precision, and
       // CLOCK_MONOTONIC_COARSE ~2ns with 1 ms precision.
-      // Consider overloading with proper implementation to match your
-      // performance and precision expectations. Overloading could be done in a
-      // following way: SlogContext::getInstance()->setGetTimestampsFunc([] {
+      // Consider selecting another clock with setClock() or a user-defined one
+      // to match your performance and precision expectations:
+      // SlogContext::getInstance()->setGetTimestampsFunc([] {
       //   const int64_t elapsed_ns = myElapsedNs();
       //   const int64_t global_ns = myGloabalNs();
       //   SlogTimestamps{elapsed_ns, global_ns,
-      //   SlogGlobalClockTypeId::kWallTimeClock};
+      //   SlogGlobalClockTypeId::kGpsEpochClock};
       // });
       // The defauls implementation is using CLOCK_MONOTONIC as an option
       // providing average precisions with average cost.
-      thread_local struct timespec ts;
+      return clockGettimeTimestamps(CLOCK_MONOTONIC, CLOCK_REALTIME);
+    };
 
-      SLOG_ASSERT(-1 != clock_gettime(CLOCK_MONOTONIC, &ts));
-      const int64_t elapsed_ns = ts.tv_sec * 1000000000 + ts.tv_nsec;
+namespace {
 
-      SLOG_ASSERT(-1 != clock_gettime(CLOCK_REALTIME, &ts));
-      const int64_t global_ns = ts.tv_sec * 1000000000 + ts.tv_nsec;
+// One in round(1 / fraction), 0 for none.
+uint32_t samplingPeriod(double fraction) {
+  if (fraction >= 1) {
+    return 1;
+  }
+  if (fraction > 0) {
+    return static_cast<uint32_t>(std::min(std::round(1 / fraction), 1e9));
+  }
+  return 0;
+}
 
-      return SlogTimestamps{elapsed_ns, global_ns,
-                            SlogGlobalClockTypeId::kWallTimeClock};
-    };
+}  // namespace
+
+void SlogContext::setScopeUsageSampling(double fraction) {
+  scope_usage_sampling_period_.store(samplingPeriod(fraction),
+                                     std::memory_order_relaxed);
+}
+
+void SlogContext::setScopePerfSampling(double fraction) {
+  scope_perf_sampling_period_.store(samplingPeriod(fraction),
+                                    std::memory_order_relaxed);
+}
+
+void SlogContext::setScopeAllocSampling(double fraction) {
+  scope_alloc_sampling_period_.store(samplingPeriod(fraction),
+                                     std::memory_order_relaxed);
+}
+
+int32_t SlogContext::addScopeName(const std::string& name) {
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(call_sites_mutex_);
+    const auto it = scope_name_ids_.find(name);
+    if (it != scope_name_ids_.end()) {
+      return it->second;
+    }
+  }
+  std::unique_lock<std::shared_timed_mutex> lock(call_sites_mutex_);
+  const auto inserted = scope_name_ids_.emplace(
+      name, static_cast<int32_t>(scope_names_.size()));
+  if (inserted.second) {
+    scope_names_.push_back(name);
+  }
+  return inserted.first->second;
+}
+
+std::string SlogContext::scopeName(int32_t name_id) {
+  std::shared_lock<std::shared_timed_mutex> lock(call_sites_mutex_);
+  return name_id >= 0 && static_cast<size_t>(name_id) < scope_names_.size()
+             ? scope_names_[name_id]
+             : std::string();
+}
+
+SlogStats SlogContext::stats() {
+  SlogStats stats;
+  stats.elapsed_ns = getElapsedNs();
+  stats.records_emitted = records_emitted_.total();
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(
+        async_notification_queue_mutex_);
+    async_notification_queue_->addStats(&stats);
+  }
+  stats.scope_entries_collected =
+      num_collected_scope_entries_.load(std::memory_order_relaxed);
+  stats.scope_entries_dropped = numDroppedScopeEntries();
+  sync_subscribers_.addStats("sync", &stats.subscribers);
+  async_subscribers_.addStats("async", &stats.subscribers);
+  async_batch_subscribers_.addStats("async_batch", &stats.subscribers);
+  async_scope_subscribers_.addStats("async_scope", &stats.subscribers);
+  return stats;
+}
+
+void SlogContext::collectScopeEntries(std::vector<SlogRecord>* batch) {
+  std::vector<SlogScopeEntry> entries;
+  scope_rings_.drain(&entries);
+  if (entries.empty()) {
+    return;
+  }
+  // One clock read per drain instead of a global one per entry.
+  const SlogTimestamps now = getTimestamps();
+  for (SlogScopeEntry& entry : entries) {
+    entry.time.global_ns =
+        entry.time.elapsed_ns + (now.global_ns - now.elapsed_ns);
+    entry.time.global_clock_type_id = now.global_clock_type_id;
+  }
+  async_scope_subscribers_.notifyTimed(entries);
+  num_collected_scope_entries_.store(
+      num_collected_scope_entries_.load(std::memory_order_relaxed) +
+          entries.size(),
+      std::memory_order_relaxed);
+
+  // The same records as of SLOG_SCOPE: an open record at the scope call site
+  // and a close record at call site 0. They are appended after the queued
+  // records, which keep their FIFO order, in the order of each thread's ring.
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(call_sites_mutex_);
+    for (const SlogScopeEntry& entry : entries) {
+      if (entry.open) {
+        batch->emplace_back(entry.thread_id, entry.call_site_id, INFO);
+        SlogRecord& record = batch->back();
+        record.addTag(kSlogTagKeyScopeName,
+                      static_cast<size_t>(entry.name_id) < scope_names_.size()
+                          ? scope_names_[entry.name_id]
+                          : std::string(),
+                      SlogTagVerbosity::kSilent);
+        record.addTag(kSlogTagKeyScopeOpen, SlogTagVerbosity::kSilent);
+        record.addTag(kSlogTagKeyScopeId, entry.scope_id,
+                      SlogTagVerbosity::kSilent);
+        record.addTag(kSlogTagKeyScopeDepth, entry.depth,
+                      SlogTagVerbosity::kSilent);
+        record.addTag(kSlogTagKeyScopeNameId, entry.name_id,
+                      SlogTagVerbosity::kSilent);
+        record.set_time(entry.time);
+      } else {
+        batch->emplace_back(entry.thread_id, 0, INFO);
+        SlogRecord& record = batch->back();
+        record.addTag(kSlogTagKeyScopeClose, SlogTagVerbosity::kSilent);
+        record.addTag(kSlogTagKeyScopeId, entry.scope_id,
+                      SlogTagVerbosity::kSilent);
+        record.addTag(kSlogTagKeyScopeNameId, entry.name_id,
+                      SlogTagVerbosity::kSilent);
+        record.addTag(kSlogTagKeyScopeParentId, entry.parent_scope_id,
+                      SlogTagVerbosity::kSilent);
+        record.addTag(kSlogTagKeyScopeDuration, entry.duration_ns,
+                      SlogTagVerbosity::kSilent);
+        record.set_time(entry.time);
+      }
+    }
+  }
+}
 
 int SlogContext::addOrReuseCallSiteVerySlow(const std::string& function,
                                             const std::string& file,
@@ -15,14 +15,24 @@
 #ifndef slog_cc_context_context
 #define slog_cc_context_context
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "slog_cc/context/clock.h"
 #include "slog_cc/context/notification_queue.h"
+#include "slog_cc/context/scope_ring.h"
+#include "slog_cc/context/scope_stack.h"
+#include "slog_cc/context/scope_stats.h"
+#include "slog_cc/context/stats.h"
 #include "slog_cc/context/subscribers.h"
 #include "slog_cc/primitives/call_site.h"
 #include "slog_cc/primitives/record.h"
@@ -33,32 +43,125 @@ namespace slog {
 
 class SlogContext {
  public:
+  // The one context of the process. Its SlogScopeRings and
+  // SlogScopeStatsRegistry keep per-thread state in function-local
+  // thread_locals, shared by all objects of their class, so they rely on
+  // this being their only owner.
   static std::shared_ptr<SlogContext> getInstance() noexcept;
 
   SlogSubscriber createAsyncSubscriber(const SlogCallback& callback) {
     return async_subscribers_.create(callback);
   }
 
+  // Batch subscribers are run in the async queue background thread with all
+  // records handled in one queue iteration, after per-record async
+  // subscribers. They are also run with an empty batch when the queue is idle
+  // so they can flush buffered data periodically.
+  SlogSubscriber createAsyncBatchSubscriber(const SlogBatchCallback& callback) {
+    return async_batch_subscribers_.create(callback);
+  }
+
+  // Scope subscribers are run in the async queue background thread with the
+  // entries of SLOG_FAST_SCOPE scopes collected in one queue iteration, before
+  // record subscribers. Record subscribers get the entries converted to the
+  // records SLOG_SCOPE would emit; sync subscribers don't see them.
+  SlogSubscriber createAsyncScopeSubscriber(
+      const SlogScopeBatchCallback& callback) {
+    return async_scope_subscribers_.create(callback);
+  }
+
   SlogSubscriber createSyncSubscriber(const SlogCallback& callback) {
     return sync_subscribers_.create(callback);
   }
 
-  SLOG_INLINE void notifySyncSubscribers(const SlogRecord& record) noexcept {
+  SLOG_INLINE void notifySyncSubscribers(SlogRecord& record) noexcept {
+    records_emitted_.increment();
+    emitStderrLine(&record);
     sync_subscribers_.notify(record);
+    if (record.severity() == FATAL) {
+      abort();
+    }
   }
 
   SLOG_INLINE void notifyAsyncSubscribers(SlogRecord&& record) noexcept {
     std::shared_lock<std::shared_timed_mutex> lock(
         async_notification_queue_mutex_);
     SLOG_ASSERT(async_notification_queue_.get());
+    // The async echo was removed since the record was emitted.
+    if (record.async_stderr_echo() &&
+        !async_stderr_echo_.load(std::memory_order_relaxed)) {
+      record.set_async_stderr_echo(false);
+      slog_printer_.emitStderrLine(record, getCallSite(record.call_site_id()));
+    }
     async_notification_queue_.get()->add(std::move(record));
   }
 
+  // Records a scope opening or closing in the ring of the calling thread.
+  SLOG_INLINE void addScopeEntry(const SlogScopeEntry& entry) noexcept {
+    const uint64_t size = scope_rings_.threadRing()->push(entry);
+    // Wakes the queue thread to drain the ring before it fills up.
+    if (size == SlogScopeRing::kCapacity / 2) {
+      std::shared_lock<std::shared_timed_mutex> lock(
+          async_notification_queue_mutex_);
+      async_notification_queue_->wake();
+    }
+  }
+
+  // Scope entries dropped because a ring was full.
+  uint64_t numDroppedScopeEntries() { return scope_rings_.numDropped(); }
+
+  // Samples the thread CPU time, context switches and page faults within
+  // SLOG_SCOPE scopes, attached to their close records. `fraction` of scopes
+  // of each thread are sampled, one in round(1 / fraction): 0 (the default)
+  // for none, 1 for all. A sample costs four syscalls.
+  void setScopeUsageSampling(double fraction);
+  // One in how many scopes is sampled, 0 for none.
+  SLOG_INLINE uint32_t scopeUsageSamplingPeriod() const {
+    return scope_usage_sampling_period_.load(std::memory_order_relaxed);
+  }
+  // Samples perf counters of the thread within SLOG_SCOPE scopes like
+  // setScopeUsageSampling(): cycles, instructions, cache and branch misses,
+  // or software counters where there is no PMU, or nothing where perf events
+  // are unavailable, see util::os::ThreadPerfCounters. The counters of a
+  // thread are opened on its first sample; a sample costs two rdpmc reads
+  // per counter, or two read() syscalls.
+  void setScopePerfSampling(double fraction);
+  SLOG_INLINE uint32_t scopePerfSamplingPeriod() const {
+    return scope_perf_sampling_period_.load(std::memory_order_relaxed);
+  }
+  // Samples heap allocations of the thread within SLOG_SCOPE scopes like
+  // setScopeUsageSampling(): allocations, frees and their bytes, counted by
+  // the //slog_cc/util/os:alloc_hooks malloc interposition. Nothing is
+  // attached when it isn't linked into the binary. A sample costs two reads
+  // of thread-local counters; allocations made to emit the open record are
+  // counted within the scope.
+  void setScopeAllocSampling(double fraction);
+  SLOG_INLINE uint32_t scopeAllocSamplingPeriod() const {
+    return scope_alloc_sampling_period_.load(std::memory_order_relaxed);
+  }
+
+  // Snapshot of the pipeline counters: records emitted, queued and delivered,
+  // queue depth, batch sizes, flush waits and time spent in each subscriber.
+  // The counters are always on: a thread-local increment per record and a
+  // few adds under the queue lock, and two clock reads per async subscriber
+  // callback in the async queue thread. See SlogStatsReporter to emit them
+  // periodically.
+  SlogStats stats();
+
+  // Scopes currently open on each thread.
+  SLOG_INLINE SlogScopeStacks& scopeStacks() { return scope_stacks_; }
+
+  // Duration statistics of SLOG_SCOPE_STATS scopes.
+  SLOG_INLINE SlogScopeStatsRegistry& scopeStats() { return scope_stats_; }
+
+  // Waits until records emitted so far, SLOG_FAST_SCOPE ones included, are
+  // handled by async subscribers. Aborts if called from an async subscriber
+  // with records to wait for.
   SLOG_INLINE void waitAsyncSubscribers() {
     std::shared_lock<std::shared_timed_mutex> lock(
         async_notification_queue_mutex_);
     SLOG_ASSERT(async_notification_queue_.get());
-    async_notification_queue_.get()->waitRecordsFlush();
+    async_notification_queue_.get()->waitRecordsFlush(!scope_rings_.empty());
   }
 
   void resetAsyncNotificationQueue(
@@ -67,8 +170,35 @@ class SlogContext {
     std::unique_lock<std::shared_timed_mutex> lock(
         async_notification_queue_mutex_);
     async_notification_queue_.reset(new SlogAsyncNotificationQueue(
-        [this](const SlogRecord& record) { async_subscribers_.notify(record); },
-        thread_init, buffer_size));
+        [this](const SlogRecord& record) {
+          async_subscribers_.notifyTimed(record);
+        },
+        [this](const std::vector<SlogRecord>& batch) {
+          async_batch_subscribers_.notifyTimed(batch);
+        },
+        thread_init, buffer_size, [this](std::vector<SlogRecord>* batch) {
+          collectScopeEntries(batch);
+        }));
+  }
+
+  // Noisy records are echoed to stderr synchronously in the emitting thread
+  // unless an async echo is registered, e.g. by SlogStderrSink, which formats
+  // and writes them in the async queue thread instead. FATAL records are always
+  // echoed synchronously, right before abort().
+  //
+  // Records left to the async echo are marked with async_stderr_echo(), and
+  // the async echo echoes those only, so each record is echoed once. It must
+  // subscribe before it is added. A marked record queued after it is removed
+  // is echoed synchronously instead, so the async echo unsubscribes once it
+  // is removed and the queue is drained. There is one at a time at most.
+  SLOG_INLINE void addAsyncStderrEcho() {
+    const bool added = !async_stderr_echo_.exchange(true);
+    SLOG_ASSERT(added && "Only one async stderr echo may exist at a time.");
+  }
+  SLOG_INLINE void removeAsyncStderrEcho() {
+    std::unique_lock<std::shared_timed_mutex> lock(
+        async_notification_queue_mutex_);
+    async_stderr_echo_ = false;
   }
 
   SLOG_INLINE size_t numCallSites() {
@@ -99,27 +229,87 @@ class SlogContext {
   int addOrReuseCallSiteVerySlow(const std::string& function,
                                  const std::string& file, int32_t line);
 
+  // Returns the ID of a scope name, the same for equal names. Scope records
+  // carry it so that a close record can be named without its open record.
+  // Names are never released: the table grows with every distinct name.
+  int32_t addScopeName(const std::string& name);
+  std::string scopeName(int32_t name_id);
+
   // Use resetCallSites() ONLY for testing. It invalidates CallSite references
-  // returned by getCallSite().
+  // returned by getCallSite(). Scope names are kept, their IDs are cached by
+  // scope call sites.
   SLOG_INLINE void resetCallSites() {
     std::unique_lock<std::shared_timed_mutex> lock(call_sites_mutex_);
     call_sites_.clear();
     call_sites_.emplace_back(std::make_unique<SlogCallSite>("", "", 0));
   }
 
-  // NOTE: time methods are not thread-safe.
-  /// Captures current timestamps using default of user-defined implementation.
-  SlogTimestamps getTimestamps() const noexcept;
-  /// Overrides implementation of getTimestamps().
+  /// Captures current timestamps with the selected clock. Built with
+  /// -DSLOG_FIXED_CLOCK=kMonotonic or kCoarse, the clock is chosen at compile
+  /// time and setClock() has no effect. The define must be the same for the
+  /// whole build, Slog libraries included, as it changes inline functions.
+  /// kTsc and kCustom can't be fixed: they need a SlogTscClock or a function
+  /// set at runtime, and kTsc falls back to kMonotonic when the TSC fails.
+  SLOG_INLINE SlogTimestamps getTimestamps() const noexcept {
+    switch (selectedClock()) {
+      case SlogClock::kCoarse:
+        return clockGettimeTimestamps(CLOCK_MONOTONIC_COARSE,
+                                      CLOCK_REALTIME_COARSE);
+      case SlogClock::kTsc:
+        return tsc_conversion_.now();
+      case SlogClock::kCustom:
+        return (*get_timestamps_func_.load(std::memory_order_acquire))();
+      default:
+        return clockGettimeTimestamps(CLOCK_MONOTONIC, CLOCK_REALTIME);
+    }
+  }
+  /// getTimestamps().elapsed_ns alone, one clock read for durations.
+  SLOG_INLINE int64_t getElapsedNs() const noexcept {
+    switch (selectedClock()) {
+      case SlogClock::kCoarse:
+        return clockGettimeNs(CLOCK_MONOTONIC_COARSE);
+      case SlogClock::kTsc:
+        return tsc_conversion_.elapsedNs();
+      case SlogClock::kCustom:
+        return (*get_timestamps_func_.load(std::memory_order_acquire))()
+            .elapsed_ns;
+      default:
+        return clockGettimeNs(CLOCK_MONOTONIC);
+    }
+  }
+  /// Selects the clock of getTimestamps(), safe to call while logging. kTsc is
+  /// selected by SlogTscClock once it has calibrated tscConversion(), kCustom
+  /// by setGetTimestampsFunc().
+  SLOG_INLINE void setClock(SlogClock clock) {
+    clock_.store(clock, std::memory_order_relaxed);
+  }
+  SLOG_INLINE SlogClock clock() const {
+    return clock_.load(std::memory_order_relaxed);
+  }
+  /// Selects a user-defined clock, safe to call while logging. Replaced
+  /// functions are kept until the context is destroyed as other threads may
+  /// still be running them.
   void setGetTimestampsFunc(const std::function<SlogTimestamps()>& func);
-  /// A default implementation of getTimestamps().
+  /// The kMonotonic clock as a function.
   static const std::function<SlogTimestamps()> kDefaultGetTimestampsFunc;
+  SLOG_INLINE SlogTscConversion* tscConversion() { return &tsc_conversion_; }
 
  private:
   static constexpr size_t kDefaultAsyncBufferSize = 8192;
 
   SlogContext();
 
+  SLOG_INLINE SlogClock selectedClock() const noexcept {
+#ifdef SLOG_FIXED_CLOCK
+    static_assert(SlogClock::SLOG_FIXED_CLOCK == SlogClock::kMonotonic ||
+                      SlogClock::SLOG_FIXED_CLOCK == SlogClock::kCoarse,
+                  "SLOG_FIXED_CLOCK must be kMonotonic or kCoarse");
+    return SlogClock::SLOG_FIXED_CLOCK;
+#else
+    return clock_.load(std::memory_order_relaxed);
+#endif
+  }
+
   // Thread unsafe implementation of add-call-site logic as a private method as
   // all public methods must be thread safe.
   SLOG_INLINE int addCallSiteUnsafe(const std::string& function,
@@ -131,23 +321,54 @@ class SlogContext {
     return call_sites_.size() - 1;
   }
 
-  SLOG_INLINE void emitStderrLine(const SlogRecord& record) {
-    if (record.severity() == FATAL || record.isNoisy()) {
-      slog_printer_.emitStderrLine(record, getCallSite(record.call_site_id()));
+  // Drains scope rings for scope subscribers and adds the entries to `batch`
+  // as records, in time order with the records already there.
+  void collectScopeEntries(std::vector<SlogRecord>* batch);
+
+  SLOG_INLINE void emitStderrLine(SlogRecord* record) {
+    if (record->severity() != FATAL && !record->isNoisy()) {
+      return;
     }
+    // Pairs with addAsyncStderrEcho(), so the async echo is subscribed.
+    if (record->severity() != FATAL &&
+        async_stderr_echo_.load(std::memory_order_acquire)) {
+      record->set_async_stderr_echo(true);
+      return;
+    }
+    slog_printer_.emitStderrLine(*record, getCallSite(record->call_site_id()));
   }
 
   SlogContextSubscribers async_subscribers_;
+  SlogContextBatchSubscribers async_batch_subscribers_;
+  SlogContextScopeSubscribers async_scope_subscribers_;
   SlogContextSubscribers sync_subscribers_;
-  SlogSubscriber echo_to_glog_;
+  std::atomic<bool> async_stderr_echo_{false};
 
   std::unique_ptr<SlogAsyncNotificationQueue> async_notification_queue_;
   std::shared_timed_mutex async_notification_queue_mutex_;
 
   std::vector<std::unique_ptr<SlogCallSite>> call_sites_;
   std::shared_timed_mutex call_sites_mutex_;
+  // Indexed by name ID, guarded by call_sites_mutex_.
+  std::vector<std::string> scope_names_;
+  std::unordered_map<std::string, int32_t> scope_name_ids_;
+
+  SlogScopeRings scope_rings_;
+  SlogScopeStacks scope_stacks_;
+  SlogThreadCounters records_emitted_;
+  // Written by the async queue thread only.
+  std::atomic<uint64_t> num_collected_scope_entries_{0};
+  SlogScopeStatsRegistry scope_stats_;
+  std::atomic<uint32_t> scope_usage_sampling_period_{0};
+  std::atomic<uint32_t> scope_perf_sampling_period_{0};
+  std::atomic<uint32_t> scope_alloc_sampling_period_{0};
 
-  std::function<SlogTimestamps()> get_timestamps_func_;
+  std::atomic<SlogClock> clock_{SlogClock::kMonotonic};
+  SlogTscConversion tsc_conversion_;
+  std::atomic<const std::function<SlogTimestamps()>*> get_timestamps_func_;
+  std::vector<std::unique_ptr<std::function<SlogTimestamps()>>>
+      get_timestamps_funcs_;
+  std::mutex get_timestamps_funcs_mutex_;
   SlogPrinter slog_printer_;
 };
 
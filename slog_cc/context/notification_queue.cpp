@@ -23,14 +23,16 @@ const std::chrono::milliseconds kSleepBetweenFlushes(1000);
 
 SlogAsyncNotificationQueue::SlogAsyncNotificationQueue(
     const std::function<void(const SlogRecord&)>& notify,
-    const std::function<void()>& thread_init, size_t buffer_size)
-    : buffer_size_(buffer_size) {
+    const std::function<void(const std::vector<SlogRecord>&)>& notify_batch,
+    const std::function<void()>& thread_init, size_t buffer_size,
+    const std::function<void(std::vector<SlogRecord>*)>& collect)
+    : buffer_size_(buffer_size), collect_(collect) {
   // Reserve buffer_ before initializing the thread.
   // Still in single threaded mode, no lock is required.
   buffer_.reserve(buffer_size);
 
   // The worker thread.
-  process_loop_ = std::thread([this, notify, thread_init] {
+  process_loop_ = std::thread([this, notify, notify_batch, thread_init] {
     thread_init();
 
     std::vector<SlogRecord> batch;
@@ -42,14 +44,23 @@ SlogAsyncNotificationQueue::SlogAsyncNotificationQueue(
         if (done_) {
           return;
         }
-        batch.swap(buffer_);
-        if (batch.empty()) {
+        if (buffer_.empty() && !flush_requested_) {
           cv_batch_ready_.wait_for(lock, kSleepBetweenFlushes);
+          if (done_) {
+            return;
+          }
         }
+        flush_requested_ = false;
+        ++num_iterations_started_;
+        batch.swap(buffer_);
+      }
+      const size_t num_queued = batch.size();
+      collect_(&batch);
+      if (!batch.empty()) {
+        batch_sizes_.record(batch.size());
       }
-      // TODO(vsbus): This leads to big inefficiencies in the implementation of
-      // the callbacks. (mutex locking...). We should change the callback to
-      // accept a complete batch instead of individual events.
+      // Per-record callbacks are inefficient (mutex locking...). Subscribers
+      // with heavy per-record work should prefer batch callbacks.
       for (const SlogRecord& record : batch) {
         const auto now = std::chrono::steady_clock::now();
         // If batch has many tasks that take too long time to handle we
@@ -65,9 +76,12 @@ SlogAsyncNotificationQueue::SlogAsyncNotificationQueue(
         }
         notify(record);
       }
+      notify_batch(batch);
       {
         std::unique_lock<std::mutex> lock(mu_);
-        num_records_flushed_ += batch.size();
+        num_records_flushed_ += num_queued;
+        num_records_delivered_ += batch.size();
+        ++num_iterations_finished_;
       }
       batch.clear();
       cv_batch_flushed_.notify_all();
@@ -75,6 +89,23 @@ SlogAsyncNotificationQueue::SlogAsyncNotificationQueue(
   });
 }
 
+void SlogAsyncNotificationQueue::addStats(SlogStats* stats) {
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    stats->records_enqueued = num_records_added_;
+    stats->records_delivered = num_records_delivered_;
+    stats->queue_depth = buffer_.size();
+    stats->queue_depth_high_water = queue_depth_high_water_;
+    stats->flush_waits = num_flush_waits_;
+    stats->flush_wait_total_ns = flush_wait_total_ns_;
+    stats->flush_wait_max_ns = flush_wait_max_ns_;
+  }
+  stats->batches = batch_sizes_.count();
+  stats->batch_size_p50 = batch_sizes_.valueAtPercentile(50);
+  stats->batch_size_p99 = batch_sizes_.valueAtPercentile(99);
+  stats->batch_size_max = batch_sizes_.max();
+}
+
 SlogAsyncNotificationQueue::~SlogAsyncNotificationQueue() {
   {
     std::unique_lock<std::mutex> lock(mu_);
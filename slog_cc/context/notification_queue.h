@@ -15,14 +15,18 @@
 #ifndef slog_cc_context_notification_queue
 #define slog_cc_context_notification_queue
 
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#include "slog_cc/context/stats.h"
 #include "slog_cc/primitives/record.h"
 #include "slog_cc/printer/printer.h"
+#include "slog_cc/util/assert_macro.h"
+#include "slog_cc/util/histogram.h"
 
 namespace slog {
 
@@ -30,15 +34,25 @@ namespace slog {
 // from multiple threads and eventually handles them in a single background
 // thread. Ordering is FIFO. When handling next event from the queue calls
 // notify(record) on it. notify() is a lambda passed to constructor that is
-// supposed to trigger callbacks according to user choice.
+// supposed to trigger callbacks according to user choice. After all records of
+// a batch are handled it calls notify_batch(batch) once.
 class SlogAsyncNotificationQueue {
  public:
   // notify -- a lambda that is being run in a background thread to send the
-  // notification. thread_init -- a lambda that is run in the beginning of
-  // background thread, e.g. it could set the thread name.
+  // notification. notify_batch -- a lambda run in the background thread with
+  // all records handled in one iteration; it is also run with an empty batch
+  // when the queue is idle, at least once per kSleepBetweenFlushes, so batch
+  // consumers can flush buffered data. thread_init -- a lambda that is run in
+  // the beginning of background thread, e.g. it could set the thread name.
+  // collect -- a lambda run in the background thread in each iteration before
+  // notifications, it may append records from other sources (scope rings) to
+  // the batch, after the queued records.
   SlogAsyncNotificationQueue(
       const std::function<void(const SlogRecord&)>& notify,
-      const std::function<void()>& thread_init, size_t buffer_size);
+      const std::function<void(const std::vector<SlogRecord>&)>& notify_batch,
+      const std::function<void()>& thread_init, size_t buffer_size,
+      const std::function<void(std::vector<SlogRecord>*)>& collect =
+          [](std::vector<SlogRecord>*) {});
 
   ~SlogAsyncNotificationQueue();
 
@@ -46,6 +60,9 @@ class SlogAsyncNotificationQueue {
     std::unique_lock<std::mutex> lock(mu_);
     buffer_.emplace_back(std::move(record));
     num_records_added_ += 1;
+    if (buffer_.size() > queue_depth_high_water_) {
+      queue_depth_high_water_ = buffer_.size();
+    }
     // buffer_ was pre-allocated for buffer_size_ elements. When buffer size is
     // approaching buffer_size_ it is a good time to notify flush thread to
     // process the buffer. Benchmarks showed that we need to do it before we
@@ -58,17 +75,44 @@ class SlogAsyncNotificationQueue {
     }
   }
 
-  SLOG_INLINE void waitRecordsFlush() {
-    cv_batch_ready_.notify_all();
+  // Waits until records added so far are handled. With `collect`, also waits
+  // for an iteration started after the call, so that records collected by
+  // then (scope ring entries) are handled too. Deadlocks if called from the
+  // background thread with something to wait for.
+  SLOG_INLINE void waitRecordsFlush(bool collect) {
+    const auto start = std::chrono::steady_clock::now();
     std::unique_lock<std::mutex> lock(mu_);
     const size_t num_added = num_records_added_;
-    while (num_added > num_records_flushed_) {
-      cv_batch_flushed_.wait(lock);
+    const size_t num_started = num_iterations_started_;
+    if (num_added > num_records_flushed_ || collect) {
+      SLOG_ASSERT(std::this_thread::get_id() != process_loop_.get_id());
+      flush_requested_ = true;
+      cv_batch_ready_.notify_all();
+      while (num_added > num_records_flushed_ ||
+             (collect && num_started >= num_iterations_finished_)) {
+        cv_batch_flushed_.wait(lock);
+      }
+    }
+    const uint64_t wait_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    num_flush_waits_ += 1;
+    flush_wait_total_ns_ += wait_ns;
+    if (wait_ns > flush_wait_max_ns_) {
+      flush_wait_max_ns_ = wait_ns;
     }
   }
 
+  // Fills the queue counters of `stats`.
+  void addStats(SlogStats* stats);
+
+  // Wakes the background thread up to collect records.
+  SLOG_INLINE void wake() { cv_batch_ready_.notify_all(); }
+
  private:
   const size_t buffer_size_;
+  const std::function<void(std::vector<SlogRecord>*)> collect_;
 
   std::mutex mu_;
 
@@ -91,6 +135,18 @@ class SlogAsyncNotificationQueue {
   // 2**64 / 1e9 ~= 580+ years.
   size_t num_records_added_ = 0;
   size_t num_records_flushed_ = 0;
+  size_t num_iterations_started_ = 0;
+  size_t num_iterations_finished_ = 0;
+  bool flush_requested_ = false;
+
+  // Stats, guarded by mu_ except batch_sizes_, which the background thread
+  // records and any thread reads.
+  size_t num_records_delivered_ = 0;
+  size_t queue_depth_high_water_ = 0;
+  size_t num_flush_waits_ = 0;
+  uint64_t flush_wait_total_ns_ = 0;
+  uint64_t flush_wait_max_ns_ = 0;
+  util::LogLinearHistogram batch_sizes_;
 
   bool done_ = false;
   std::thread process_loop_;
@@ -0,0 +1,73 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/context/scope_ring.h"
+
+#include "slog_cc/util/os/thread_id.h"
+
+namespace slog {
+
+void SlogScopeRing::drain(std::vector<SlogScopeEntry>* out) {
+  const uint64_t tail = tail_.load(std::memory_order_relaxed);
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  for (uint64_t i = tail; i < head; ++i) {
+    out->push_back(entries_[i & (kCapacity - 1)]);
+    out->back().thread_id = thread_id_;
+  }
+  tail_.store(head, std::memory_order_release);
+}
+
+void SlogScopeRings::drain(std::vector<SlogScopeEntry>* out) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < rings_.size();) {
+    // Entries pushed before the thread exited are visible once closed is.
+    const bool closed = rings_[i]->closed.load(std::memory_order_acquire);
+    rings_[i]->drain(out);
+    if (closed) {
+      num_dropped_by_released_rings_ += rings_[i]->numDropped();
+      rings_[i] = rings_.back();
+      rings_.pop_back();
+    } else {
+      ++i;
+    }
+  }
+}
+
+bool SlogScopeRings::empty() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const auto& ring : rings_) {
+    if (!ring->empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t SlogScopeRings::numDropped() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t num_dropped = num_dropped_by_released_rings_;
+  for (const auto& ring : rings_) {
+    num_dropped += ring->numDropped();
+  }
+  return num_dropped;
+}
+
+std::shared_ptr<SlogScopeRing> SlogScopeRings::create() {
+  auto ring = std::make_shared<SlogScopeRing>(util::os::get_thread_id());
+  std::unique_lock<std::mutex> lock(mutex_);
+  rings_.push_back(ring);
+  return ring;
+}
+
+}  // namespace slog
@@ -0,0 +1,121 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_context_scope_ring
+#define slog_cc_context_scope_ring
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "slog_cc/primitives/scope_entry.h"
+#include "slog_cc/util/inline_macro.h"
+
+namespace slog {
+
+// Single producer single consumer ring of scope entries of one thread. The
+// owning thread pushes without locks, the async queue thread drains.
+class SlogScopeRing {
+ public:
+  static constexpr uint64_t kCapacity = 4096;
+
+  explicit SlogScopeRing(int32_t thread_id)
+      : thread_id_(thread_id), entries_(new SlogScopeEntry[kCapacity]) {}
+
+  // Returns the number of entries in the ring including this one, possibly
+  // overestimated, or 0 if the ring is full and the entry is dropped.
+  SLOG_INLINE uint64_t push(const SlogScopeEntry& entry) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - cached_tail_ >= kCapacity) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head - cached_tail_ >= kCapacity) {
+        num_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+      }
+    }
+    entries_[head & (kCapacity - 1)] = entry;
+    head_.store(head + 1, std::memory_order_release);
+    return head + 1 - cached_tail_;
+  }
+
+  // Appends entries pushed so far to `out` with the thread ID filled in.
+  void drain(std::vector<SlogScopeEntry>* out);
+
+  // Whether all entries pushed so far are drained.
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+  int32_t threadId() const { return thread_id_; }
+  uint64_t numDropped() const {
+    return num_dropped_.load(std::memory_order_relaxed);
+  }
+  // Set when the owning thread exits.
+  std::atomic<bool> closed{false};
+
+ private:
+  const int32_t thread_id_;
+  std::unique_ptr<SlogScopeEntry[]> entries_;
+  alignas(64) std::atomic<uint64_t> head_{0};
+  // Producer's copy of tail_, refreshed when the ring looks full.
+  uint64_t cached_tail_ = 0;
+  std::atomic<uint64_t> num_dropped_{0};
+  alignas(64) std::atomic<uint64_t> tail_{0};
+};
+
+// Scope rings of all threads.
+class SlogScopeRings {
+ public:
+  // The ring of the calling thread, created on first use. Assumes a single
+  // SlogScopeRings, see SlogContext::getInstance().
+  SLOG_INLINE SlogScopeRing* threadRing() {
+    thread_local ThreadRing thread_ring;
+    if (thread_ring.ring == nullptr) {
+      thread_ring.ring = create();
+    }
+    return thread_ring.ring.get();
+  }
+
+  // Appends entries of all rings to `out` and releases rings of exited
+  // threads once drained.
+  void drain(std::vector<SlogScopeEntry>* out);
+
+  // Whether all rings are drained.
+  bool empty();
+
+  // Entries dropped on full rings, including rings already released.
+  uint64_t numDropped();
+
+ private:
+  struct ThreadRing {
+    ~ThreadRing() {
+      if (ring != nullptr) {
+        ring->closed = true;
+      }
+    }
+    std::shared_ptr<SlogScopeRing> ring;
+  };
+
+  std::shared_ptr<SlogScopeRing> create();
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<SlogScopeRing>> rings_;
+  uint64_t num_dropped_by_released_rings_ = 0;
+};
+
+}  // namespace slog
+
+#endif
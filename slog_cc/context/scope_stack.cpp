@@ -0,0 +1,72 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/context/scope_stack.h"
+
+#include <algorithm>
+
+#include "slog_cc/util/os/thread_id.h"
+
+namespace slog {
+
+constexpr int32_t SlogScopeStack::kMaxDepth;
+
+void SlogScopeStack::read(std::vector<SlogOpenScope>* out) const {
+  const int32_t depth =
+      std::min(depth_.load(std::memory_order_acquire), kMaxDepth);
+  for (int32_t i = 0; i < depth; ++i) {
+    const Slot& slot = slots_[i];
+    const int32_t scope_id = slot.scope_id.load(std::memory_order_acquire);
+    if (scope_id == 0) {
+      continue;
+    }
+    const int32_t name_id = slot.name_id.load(std::memory_order_relaxed);
+    const int64_t open_elapsed_ns =
+        slot.open_elapsed_ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Rewritten meanwhile.
+    if (slot.scope_id.load(std::memory_order_relaxed) != scope_id) {
+      continue;
+    }
+    out->push_back(SlogOpenScope{scope_id, name_id, i + 1, open_elapsed_ns});
+  }
+}
+
+std::vector<SlogThreadScopeStack> SlogScopeStacks::snapshot() {
+  std::vector<SlogThreadScopeStack> stacks;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < stacks_.size();) {
+    if (stacks_[i]->closed.load(std::memory_order_acquire)) {
+      stacks_[i] = stacks_.back();
+      stacks_.pop_back();
+      continue;
+    }
+    SlogThreadScopeStack stack{stacks_[i]->threadId(), {}};
+    stacks_[i]->read(&stack.scopes);
+    if (!stack.scopes.empty()) {
+      stacks.push_back(std::move(stack));
+    }
+    ++i;
+  }
+  return stacks;
+}
+
+std::shared_ptr<SlogScopeStack> SlogScopeStacks::create() {
+  auto stack = std::make_shared<SlogScopeStack>(util::os::get_thread_id());
+  std::unique_lock<std::mutex> lock(mutex_);
+  stacks_.push_back(stack);
+  return stack;
+}
+
+}  // namespace slog
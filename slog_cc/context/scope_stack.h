@@ -0,0 +1,129 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_context_scope_stack
+#define slog_cc_context_scope_stack
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "slog_cc/util/inline_macro.h"
+
+namespace slog {
+
+// A scope open on a thread, see SlogScopeStack.
+struct SlogOpenScope {
+  int32_t scope_id;
+  // Name of the scope is SlogContext::scopeName(name_id), -1 for none.
+  int32_t name_id;
+  // 1 for an outermost scope.
+  int32_t depth;
+  // SlogTimestamps::elapsed_ns of the opening.
+  int64_t open_elapsed_ns;
+};
+
+// Scopes currently open on one thread, SLOG_SCOPE and SLOG_FAST_SCOPE ones.
+// The owning thread writes a slot per depth without locks, any thread may
+// read them meanwhile.
+class SlogScopeStack {
+ public:
+  // Deeper scopes are counted in the depth but not recorded.
+  static constexpr int32_t kMaxDepth = 64;
+
+  explicit SlogScopeStack(int32_t thread_id) : thread_id_(thread_id) {}
+
+  // Records a scope opening at `depth`. The slot is written as a seqlock with
+  // the scope ID as the sequence, 0 while it is being written.
+  SLOG_INLINE void push(int32_t depth, int32_t scope_id, int32_t name_id,
+                        int64_t open_elapsed_ns) {
+    if (depth <= kMaxDepth) {
+      Slot& slot = slots_[depth - 1];
+      slot.scope_id.store(0, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      slot.name_id.store(name_id, std::memory_order_relaxed);
+      slot.open_elapsed_ns.store(open_elapsed_ns, std::memory_order_relaxed);
+      slot.scope_id.store(scope_id, std::memory_order_release);
+    }
+    depth_.store(depth, std::memory_order_release);
+  }
+  // Records the scope at `depth` closing.
+  SLOG_INLINE void pop(int32_t depth) {
+    depth_.store(depth - 1, std::memory_order_release);
+  }
+
+  // Appends the open scopes, outermost first. A scope opening or closing
+  // meanwhile may be missed.
+  void read(std::vector<SlogOpenScope>* out) const;
+
+  int32_t threadId() const { return thread_id_; }
+  // Set when the owning thread exits.
+  std::atomic<bool> closed{false};
+
+ private:
+  struct Slot {
+    std::atomic<int32_t> scope_id{0};
+    std::atomic<int32_t> name_id{-1};
+    std::atomic<int64_t> open_elapsed_ns{0};
+  };
+
+  const int32_t thread_id_;
+  std::atomic<int32_t> depth_{0};
+  Slot slots_[kMaxDepth];
+};
+
+// Open scopes of a thread at the time of SlogScopeStacks::snapshot().
+struct SlogThreadScopeStack {
+  int32_t thread_id;
+  std::vector<SlogOpenScope> scopes;
+};
+
+// Scope stacks of all threads.
+class SlogScopeStacks {
+ public:
+  // The stack of the calling thread, created on first use. There is one per
+  // thread, like SlogScopeRings::threadRing().
+  SLOG_INLINE SlogScopeStack* threadStack() {
+    thread_local ThreadStack thread_stack;
+    if (thread_stack.stack == nullptr) {
+      thread_stack.stack = create();
+    }
+    return thread_stack.stack.get();
+  }
+
+  // Open scopes of threads with at least one, and releases stacks of exited
+  // threads.
+  std::vector<SlogThreadScopeStack> snapshot();
+
+ private:
+  struct ThreadStack {
+    ~ThreadStack() {
+      if (stack != nullptr) {
+        stack->closed = true;
+      }
+    }
+    std::shared_ptr<SlogScopeStack> stack;
+  };
+
+  std::shared_ptr<SlogScopeStack> create();
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<SlogScopeStack>> stacks_;
+};
+
+}  // namespace slog
+
+#endif
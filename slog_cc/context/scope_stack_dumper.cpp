@@ -0,0 +1,162 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/context/scope_stack_dumper.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+
+#include "slog_cc/context/context.h"
+
+namespace slog {
+
+namespace {
+
+constexpr char kDump = 'd';
+constexpr char kStop = 's';
+
+// Write end of the pipe of the active dumper, -1 for none.
+std::atomic<int> signal_pipe_fd{-1};
+
+bool writeAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t n =
+        write(fd, data.data() + written, data.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += n;
+  }
+  return true;
+}
+
+}  // namespace
+
+SlogScopeStackDumper::SlogScopeStackDumper(
+    const SlogScopeStackDumperOptions& options,
+    std::shared_ptr<SlogContext> slog_context)
+    : options_(options), slog_context_(std::move(slog_context)) {
+  if (pipe(pipe_fds_) != 0) {
+    std::cerr << "slog: failed to create a pipe for scope stack dumps"
+              << std::endl;
+    return;
+  }
+  // The signal handler must not block on a full pipe.
+  fcntl(pipe_fds_[1], F_SETFL, fcntl(pipe_fds_[1], F_GETFL) | O_NONBLOCK);
+  int expected = -1;
+  if (!signal_pipe_fd.compare_exchange_strong(expected, pipe_fds_[1])) {
+    std::cerr << "slog: another scope stack dumper is active" << std::endl;
+    return;
+  }
+  struct sigaction action = {};
+  action.sa_handler = &SlogScopeStackDumper::handleSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(options_.signal, &action, &previous_action_) != 0) {
+    std::cerr << "slog: failed to handle signal " << options_.signal
+              << " for scope stack dumps" << std::endl;
+    signal_pipe_fd = -1;
+    return;
+  }
+  active_ = true;
+  thread_ = std::thread([this] {
+    char command;
+    while (true) {
+      const ssize_t n = read(pipe_fds_[0], &command, 1);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n != 1 || command == kStop) {
+        return;
+      }
+      dump();
+    }
+  });
+}
+
+SlogScopeStackDumper::~SlogScopeStackDumper() {
+  if (active_) {
+    sigaction(options_.signal, &previous_action_, nullptr);
+    signal_pipe_fd = -1;
+    const char command = kStop;
+    while (write(pipe_fds_[1], &command, 1) < 0 &&
+           (errno == EINTR || errno == EAGAIN)) {
+    }
+    thread_.join();
+  }
+  for (int fd : pipe_fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+void SlogScopeStackDumper::handleSignal(int) {
+  const int saved_errno = errno;
+  const int fd = signal_pipe_fd.load();
+  if (fd >= 0) {
+    const char command = kDump;
+    (void)!write(fd, &command, 1);
+  }
+  errno = saved_errno;
+}
+
+void SlogScopeStackDumper::dump() {
+  const std::string text =
+      format(slog_context_->scopeStacks().snapshot(), slog_context_.get(),
+             slog_context_->getElapsedNs());
+  if (options_.path.empty()) {
+    writeAll(STDERR_FILENO, text);
+    return;
+  }
+  const int fd =
+      open(options_.path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0 || !writeAll(fd, text)) {
+    std::cerr << "slog: failed to write scope stacks to " << options_.path
+              << std::endl;
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+std::string SlogScopeStackDumper::format(
+    const std::vector<SlogThreadScopeStack>& stacks, SlogContext* slog_context,
+    int64_t now_ns) {
+  std::string text = "slog: scope stacks of " +
+                     std::to_string(stacks.size()) + " threads\n";
+  char line[64];
+  for (const SlogThreadScopeStack& stack : stacks) {
+    text += "thread " + std::to_string(stack.thread_id) + "\n";
+    for (const SlogOpenScope& scope : stack.scopes) {
+      snprintf(line, sizeof(line), ") open for %.3f ms\n",
+               (now_ns - scope.open_elapsed_ns) / 1e6);
+      text += "  #" + std::to_string(scope.depth) + " " +
+              slog_context->scopeName(scope.name_id) + " (scope " +
+              std::to_string(scope.scope_id) + line;
+    }
+  }
+  return text;
+}
+
+}  // namespace slog
@@ -0,0 +1,82 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_context_scope_stack_dumper
+#define slog_cc_context_scope_stack_dumper
+
+#include <signal.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "slog_cc/context/scope_stack.h"
+
+namespace slog {
+
+class SlogContext;
+
+struct SlogScopeStackDumperOptions {
+  // Signal triggering a dump, e.g. `kill -USR2 <pid>`.
+  int signal = SIGUSR2;
+  // Dumps are appended to this file, or written to stderr if empty.
+  std::string path;
+};
+
+// Dumps the scopes open on every thread (SlogContext::scopeStacks()) when the
+// process receives a signal, to see where threads are in a stalled process
+// right away, without waiting for records to be flushed. The signal handler
+// only writes to a pipe; the stacks are read and written by a thread of the
+// dumper, so a dump works with the async queue thread stuck too.
+//
+// Usage, one per process, handles the signal for its lifetime:
+//   SlogScopeStackDumper dumper(options, SlogContext::getInstance());
+class SlogScopeStackDumper {
+ public:
+  SlogScopeStackDumper(const SlogScopeStackDumperOptions& options,
+                       std::shared_ptr<SlogContext> slog_context);
+  // Restores the previous handler of the signal.
+  ~SlogScopeStackDumper();
+  SlogScopeStackDumper(const SlogScopeStackDumper&) = delete;
+  SlogScopeStackDumper& operator=(const SlogScopeStackDumper&) = delete;
+
+  // False if the signal handler or the thread could not be set up.
+  bool active() const { return active_; }
+
+  // Writes the stacks now.
+  void dump();
+
+  // One line per open scope, e.g.
+  //   thread 1234
+  //     #1 plan (scope 7) open for 12.345 ms
+  static std::string format(const std::vector<SlogThreadScopeStack>& stacks,
+                            SlogContext* slog_context, int64_t now_ns);
+
+ private:
+  static void handleSignal(int signal);
+
+  const SlogScopeStackDumperOptions options_;
+  std::shared_ptr<SlogContext> slog_context_;
+  bool active_ = false;
+  // Written by the signal handler, read by thread_.
+  int pipe_fds_[2] = {-1, -1};
+  struct sigaction previous_action_;
+  std::thread thread_;
+};
+
+}  // namespace slog
+
+#endif
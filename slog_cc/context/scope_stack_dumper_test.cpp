@@ -0,0 +1,83 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/context/scope_stack_dumper.h"
+
+#include <signal.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/context/context.h"
+
+namespace slog {
+
+TEST(SlogScopeStackDumper, format) {
+  auto context = SlogContext::getInstance();
+  const int32_t plan = context->addScopeName("plan");
+  const int32_t load = context->addScopeName("load");
+  const std::vector<SlogThreadScopeStack> stacks = {
+      {12, {{3, plan, 1, 1000000}, {4, load, 2, 3500000}}},
+      {13, {{1, plan, 1, 4000000}}}};
+  EXPECT_EQ(
+      "slog: scope stacks of 2 threads\n"
+      "thread 12\n"
+      "  #1 plan (scope 3) open for 4.000 ms\n"
+      "  #2 load (scope 4) open for 1.500 ms\n"
+      "thread 13\n"
+      "  #1 plan (scope 1) open for 1.000 ms\n",
+      SlogScopeStackDumper::format(stacks, context.get(), 5000000));
+}
+
+TEST(SlogScopeStackDumper, dump_on_signal) {
+  auto context = SlogContext::getInstance();
+  SlogScopeStackDumperOptions options;
+  options.path = testing::TempDir() + "/scope_stacks.txt";
+  std::remove(options.path.c_str());
+  SlogScopeStackDumper dumper(options, context);
+  ASSERT_TRUE(dumper.active());
+
+  SlogScopeStack* stack = context->scopeStacks().threadStack();
+  stack->push(1, 5, context->addScopeName("stalled"),
+              context->getElapsedNs());
+  ASSERT_EQ(0, raise(SIGUSR2));
+  std::string text;
+  for (int i = 0; i < 500 && text.find("\n  #1") == std::string::npos;
+       ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::ifstream file(options.path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    text = buffer.str();
+  }
+  stack->pop(1);
+  EXPECT_NE(std::string::npos, text.find("  #1 stalled (scope 5) open for"))
+      << text;
+}
+
+TEST(SlogScopeStackDumper, one_per_process) {
+  SlogScopeStackDumper dumper(SlogScopeStackDumperOptions(),
+                              SlogContext::getInstance());
+  EXPECT_TRUE(dumper.active());
+  SlogScopeStackDumper second(SlogScopeStackDumperOptions(),
+                              SlogContext::getInstance());
+  EXPECT_FALSE(second.active());
+}
+
+}  // namespace slog
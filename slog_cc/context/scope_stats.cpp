@@ -0,0 +1,72 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/context/scope_stats.h"
+
+#include <algorithm>
+
+namespace slog {
+
+int32_t SlogScopeStatsRegistry::addSite(int32_t call_site_id,
+                                        const std::string& name) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  sites_.emplace_back(new Site{call_site_id, name, {}});
+  return static_cast<int32_t>(sites_.size() - 1);
+}
+
+std::vector<SlogScopeStats> SlogScopeStatsRegistry::snapshot() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<SlogScopeStats> stats;
+  stats.reserve(sites_.size());
+  for (size_t i = 0; i < sites_.size(); ++i) {
+    stats.push_back(SlogScopeStats{sites_[i]->call_site_id, sites_[i]->name,
+                                   sites_[i]->exited_threads});
+    for (const ThreadHistograms* thread : threads_) {
+      if (i < thread->histograms.size() && thread->histograms[i] != nullptr) {
+        stats.back().durations_ns.merge(*thread->histograms[i]);
+      }
+    }
+  }
+  return stats;
+}
+
+util::LogLinearHistogram* SlogScopeStatsRegistry::addThreadHistogram(
+    ThreadHistograms* thread, int32_t site) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (thread->registry == nullptr) {
+    thread->registry = this;
+    threads_.push_back(thread);
+  }
+  if (thread->histograms.size() <= static_cast<size_t>(site)) {
+    thread->histograms.resize(sites_.size());
+  }
+  thread->histograms[site].reset(new util::LogLinearHistogram());
+  return thread->histograms[site].get();
+}
+
+SlogScopeStatsRegistry::ThreadHistograms::~ThreadHistograms() {
+  if (registry == nullptr) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(registry->mutex_);
+  for (size_t i = 0; i < histograms.size(); ++i) {
+    if (histograms[i] != nullptr) {
+      registry->sites_[i]->exited_threads.merge(*histograms[i]);
+    }
+  }
+  auto& threads = registry->threads_;
+  threads.erase(std::find(threads.begin(), threads.end(), this));
+}
+
+}  // namespace slog
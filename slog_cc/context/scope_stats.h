@@ -0,0 +1,85 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_context_scope_stats
+#define slog_cc_context_scope_stats
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "slog_cc/util/histogram.h"
+#include "slog_cc/util/inline_macro.h"
+
+namespace slog {
+
+// Durations of one SLOG_SCOPE_STATS call site.
+struct SlogScopeStats {
+  int32_t call_site_id;
+  std::string name;
+  // Count, sum, min, max and percentiles in nanoseconds.
+  util::LogLinearHistogram durations_ns;
+};
+
+// Duration histograms of SLOG_SCOPE_STATS call sites. Each thread records into
+// histograms of its own, so recording takes no lock and shares no cache line
+// with other threads; snapshot() merges them on demand.
+class SlogScopeStatsRegistry {
+ public:
+  // Registers a call site, returns its index for threadHistogram().
+  int32_t addSite(int32_t call_site_id, const std::string& name);
+
+  // The histogram of the site for the calling thread, created on first use.
+  // Assumes a single registry, see SlogContext::getInstance().
+  SLOG_INLINE util::LogLinearHistogram* threadHistogram(int32_t site) {
+    thread_local ThreadHistograms thread_histograms;
+    if (static_cast<size_t>(site) < thread_histograms.histograms.size() &&
+        thread_histograms.histograms[site] != nullptr) {
+      return thread_histograms.histograms[site].get();
+    }
+    return addThreadHistogram(&thread_histograms, site);
+  }
+
+  // Statistics of all sites since start, merged across live and exited
+  // threads. Statistics are cumulative, diff two snapshots for an interval.
+  std::vector<SlogScopeStats> snapshot();
+
+ private:
+  struct Site {
+    int32_t call_site_id;
+    std::string name;
+    // Merged histograms of exited threads.
+    util::LogLinearHistogram exited_threads;
+  };
+
+  struct ThreadHistograms {
+    ~ThreadHistograms();
+    SlogScopeStatsRegistry* registry = nullptr;
+    // Indexed by site, only resized and assigned under the registry mutex.
+    std::vector<std::unique_ptr<util::LogLinearHistogram>> histograms;
+  };
+
+  util::LogLinearHistogram* addThreadHistogram(ThreadHistograms* thread,
+                                               int32_t site);
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Site>> sites_;
+  std::vector<ThreadHistograms*> threads_;
+};
+
+}  // namespace slog
+
+#endif
@@ -0,0 +1,47 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/context/stats.h"
+
+namespace slog {
+
+std::atomic<size_t> SlogThreadCounters::next_slot_{0};
+
+uint64_t SlogThreadCounters::total() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t total = exited_total_;
+  for (size_t i = 0; i < counters_.size();) {
+    // Increments before the thread exited are visible once closed is.
+    const bool closed = counters_[i]->closed.load(std::memory_order_acquire);
+    const uint64_t value = counters_[i]->value.load(std::memory_order_relaxed);
+    total += value;
+    if (closed) {
+      exited_total_ += value;
+      counters_[i] = counters_.back();
+      counters_.pop_back();
+    } else {
+      ++i;
+    }
+  }
+  return total;
+}
+
+std::shared_ptr<SlogThreadCounters::Counter> SlogThreadCounters::create() {
+  auto counter = std::make_shared<Counter>();
+  std::unique_lock<std::mutex> lock(mutex_);
+  counters_.push_back(counter);
+  return counter;
+}
+
+}  // namespace slog
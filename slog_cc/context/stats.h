@@ -0,0 +1,126 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_context_stats
+#define slog_cc_context_stats
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "slog_cc/util/inline_macro.h"
+
+namespace slog {
+
+// Callbacks of one subscriber, see SlogStats::subscribers.
+struct SlogSubscriberStats {
+  // "sync", "async", "async_batch" or "async_scope", see SlogContext.
+  std::string kind;
+  uint64_t calls = 0;
+  // Time spent in the callback, measured for async subscribers only so that
+  // emitting threads don't read the clock twice more per sync subscriber.
+  uint64_t total_ns = 0;
+  uint64_t max_ns = 0;
+};
+
+// Health of the logging pipeline, see SlogContext::stats(). Counters are
+// totals, queue ones since the async queue was created; rates are differences
+// of two snapshots over the difference of their elapsed_ns.
+struct SlogStats {
+  // SlogContext::getElapsedNs() when taken.
+  int64_t elapsed_ns = 0;
+  // Records of SLOG, SLOG_SCOPE... handed to sync subscribers and queued.
+  uint64_t records_emitted = 0;
+  // Records added to the async queue.
+  uint64_t records_enqueued = 0;
+  // Records handed to async subscribers, SLOG_FAST_SCOPE ones included.
+  uint64_t records_delivered = 0;
+  uint64_t scope_entries_collected = 0;
+  uint64_t scope_entries_dropped = 0;
+  // Records waiting in the async queue, now and at most.
+  uint64_t queue_depth = 0;
+  uint64_t queue_depth_high_water = 0;
+  // Non-empty async queue iterations and their number of records.
+  uint64_t batches = 0;
+  uint64_t batch_size_p50 = 0;
+  uint64_t batch_size_p99 = 0;
+  uint64_t batch_size_max = 0;
+  // SlogContext::waitAsyncSubscribers() calls and their wait.
+  uint64_t flush_waits = 0;
+  uint64_t flush_wait_total_ns = 0;
+  uint64_t flush_wait_max_ns = 0;
+  std::vector<SlogSubscriberStats> subscribers;
+};
+
+// A counter incremented by many threads: each thread has its own, summed on
+// demand, so an increment is a relaxed load and store of a thread-local
+// counter instead of a contended atomic add. Each object takes its own slot
+// of the thread-local counters on construction; slots aren't reused.
+class SlogThreadCounters {
+ public:
+  SlogThreadCounters() : slot_(next_slot_++) {}
+  SlogThreadCounters(const SlogThreadCounters&) = delete;
+  SlogThreadCounters& operator=(const SlogThreadCounters&) = delete;
+
+  SLOG_INLINE void increment() {
+    thread_local ThreadCounters thread_counters;
+    auto& counters = thread_counters.counters;
+    if (slot_ >= counters.size() || counters[slot_] == nullptr) {
+      if (slot_ >= counters.size()) {
+        counters.resize(slot_ + 1);
+      }
+      counters[slot_] = create();
+    }
+    std::atomic<uint64_t>& value = counters[slot_]->value;
+    value.store(value.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+  }
+
+  // Sum of all threads, including exited ones.
+  uint64_t total();
+
+ private:
+  struct Counter {
+    std::atomic<uint64_t> value{0};
+    // Set when the owning thread exits.
+    std::atomic<bool> closed{false};
+  };
+  // Counters of a thread by slot, shared with the object that created them,
+  // so either may go first.
+  struct ThreadCounters {
+    ~ThreadCounters() {
+      for (const auto& counter : counters) {
+        if (counter != nullptr) {
+          counter->closed = true;
+        }
+      }
+    }
+    std::vector<std::shared_ptr<Counter>> counters;
+  };
+
+  std::shared_ptr<Counter> create();
+
+  static std::atomic<size_t> next_slot_;
+  const size_t slot_;
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Counter>> counters_;
+  uint64_t exited_total_ = 0;
+};
+
+}  // namespace slog
+
+#endif
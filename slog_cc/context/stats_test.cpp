@@ -0,0 +1,53 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/context/stats.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace slog {
+
+TEST(SlogThreadCounters, independent_objects) {
+  SlogThreadCounters first;
+  auto second = std::make_unique<SlogThreadCounters>();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 1000; ++j) {
+        first.increment();
+      }
+      second->increment();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // Exited threads are counted.
+  EXPECT_EQ(4000, first.total());
+  EXPECT_EQ(4, second->total());
+
+  // A later object doesn't see counts of an earlier one in the same thread.
+  first.increment();
+  second.reset();
+  SlogThreadCounters third;
+  third.increment();
+  EXPECT_EQ(4001, first.total());
+  EXPECT_EQ(1, third.total());
+}
+
+}  // namespace slog
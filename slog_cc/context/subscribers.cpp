@@ -18,7 +18,9 @@
 
 namespace slog {
 
-SlogSubscriber SlogContextSubscribers::create(const SlogCallback& callback) {
+template <class Callback>
+SlogSubscriber SlogContextSubscribersT<Callback>::create(
+    const Callback& callback) {
   return SlogSubscriber(new SlogCallbackId(addCallback(callback)),
                         [this](SlogCallbackId* p) {
                           removeCallback(*p);
@@ -26,32 +28,56 @@ SlogSubscriber SlogContextSubscribers::create(const SlogCallback& callback) {
                         });
 }
 
-SlogCallbackId SlogContextSubscribers::addCallback(
-    const SlogCallback& callback) {
+template <class Callback>
+SlogCallbackId SlogContextSubscribersT<Callback>::addCallback(
+    const Callback& callback) {
   std::unique_lock<std::mutex> next_access_lock(next_access_mutex_);
   std::unique_lock<std::mutex> data_lock(data_mutex_);
   next_access_lock.unlock();
 
   auto new_callbacks =
-      std::make_shared<std::vector<std::shared_ptr<SlogCallback>>>(*callbacks_);
-  new_callbacks->emplace_back(new SlogCallback(callback));
-  callbacks_ = new_callbacks;
+      std::make_shared<std::vector<std::shared_ptr<Subscription>>>(
+          *callbacks_);
+  new_callbacks->emplace_back(new Subscription(callback));
+  std::atomic_store(&callbacks_, new_callbacks);
   return callbacks_->back().get();
 }
 
-void SlogContextSubscribers::removeCallback(SlogCallbackId callback_id) {
+template <class Callback>
+void SlogContextSubscribersT<Callback>::removeCallback(
+    SlogCallbackId callback_id) {
   std::unique_lock<std::mutex> next_access_lock(next_access_mutex_);
   std::unique_lock<std::mutex> data_lock(data_mutex_);
   next_access_lock.unlock();
 
   auto new_callbacks =
-      std::make_shared<std::vector<std::shared_ptr<SlogCallback>>>();
-  for (const std::shared_ptr<SlogCallback>& item : *callbacks_) {
+      std::make_shared<std::vector<std::shared_ptr<Subscription>>>();
+  for (const std::shared_ptr<Subscription>& item : *callbacks_) {
     if (item.get() != callback_id) {
       new_callbacks->push_back(item);
     }
   }
-  callbacks_ = new_callbacks;
+  std::atomic_store(&callbacks_, new_callbacks);
 }
 
+template <class Callback>
+void SlogContextSubscribersT<Callback>::addStats(
+    const char* kind, std::vector<SlogSubscriberStats>* stats) {
+  // Without the locks, so that a callback may call it.
+  const auto callbacks = std::atomic_load(&callbacks_);
+  for (const std::shared_ptr<Subscription>& subscription : *callbacks) {
+    SlogSubscriberStats subscriber;
+    subscriber.kind = kind;
+    subscriber.calls = subscription->calls.load(std::memory_order_relaxed);
+    subscriber.total_ns =
+        subscription->total_ns.load(std::memory_order_relaxed);
+    subscriber.max_ns = subscription->max_ns.load(std::memory_order_relaxed);
+    stats->push_back(subscriber);
+  }
+}
+
+template class SlogContextSubscribersT<SlogCallback>;
+template class SlogContextSubscribersT<SlogBatchCallback>;
+template class SlogContextSubscribersT<SlogScopeBatchCallback>;
+
 }  // namespace slog
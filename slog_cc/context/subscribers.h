@@ -15,50 +15,149 @@
 #ifndef slog_cc_context_subscribers
 #define slog_cc_context_subscribers
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
+#include "slog_cc/context/stats.h"
 #include "slog_cc/primitives/record.h"
+#include "slog_cc/primitives/scope_entry.h"
 #include "slog_cc/util/inline_macro.h"
 
 namespace slog {
 
 using SlogCallback = std::function<void(const SlogRecord&)>;
-using SlogCallbackId = SlogCallback*;
+using SlogBatchCallback = std::function<void(const std::vector<SlogRecord>&)>;
+using SlogScopeBatchCallback =
+    std::function<void(const std::vector<SlogScopeEntry>&)>;
+using SlogCallbackId = const void*;
 using SlogSubscriber = std::shared_ptr<SlogCallbackId>;
 
-class SlogContextSubscribers {
+// Transforms batches in front of a sink, in the async queue thread, e.g. a
+// SlogDedupFilter.
+class SlogBatchFilter {
  public:
-  SlogSubscriber create(const SlogCallback& callback);
+  virtual ~SlogBatchFilter() = default;
 
-  SLOG_INLINE void notify(const SlogRecord& record) {
+  // Appends the records to pass on to `out`.
+  virtual void process(const std::vector<SlogRecord>& records,
+                       std::vector<SlogRecord>* out) = 0;
+  // Appends the records held back so far. Called when the sink no longer
+  // receives records.
+  virtual void flush(std::vector<SlogRecord>* out) = 0;
+};
+
+// Runs an optional SlogBatchFilter in front of a sink. Sinks taking a
+// `filter` hand it what they receive and deliver what it passes on; on
+// destruction they deliver what it flush()es, as the last records and as
+// far as they still can, e.g. a socket sink only to a connected reader.
+class SlogBatchFilterStage {
+ public:
+  explicit SlogBatchFilterStage(std::unique_ptr<SlogBatchFilter> filter)
+      : filter_(std::move(filter)) {}
+
+  // `records` without a filter, what the filter passes on otherwise.
+  const std::vector<SlogRecord>& process(
+      const std::vector<SlogRecord>& records) {
+    if (!filter_) {
+      return records;
+    }
+    filtered_.clear();
+    filter_->process(records, &filtered_);
+    return filtered_;
+  }
+  // The records the filter held back, empty without a filter.
+  const std::vector<SlogRecord>& flush() {
+    filtered_.clear();
+    if (filter_) {
+      filter_->flush(&filtered_);
+    }
+    return filtered_;
+  }
+
+ private:
+  std::unique_ptr<SlogBatchFilter> filter_;
+  std::vector<SlogRecord> filtered_;
+};
+
+template <class Callback>
+class SlogContextSubscribersT {
+ public:
+  SlogSubscriber create(const Callback& callback);
+
+  // Callbacks are run one notify() at a time, so their counters are updated
+  // with plain loads and stores.
+  template <class Arg>
+  SLOG_INLINE void notify(const Arg& arg) {
     std::unique_lock<std::mutex> low_priority_access_lock(
         low_priority_access_mutex_);
     std::unique_lock<std::mutex> next_access_lock(next_access_mutex_);
     std::unique_lock<std::mutex> data_lock(data_mutex_);
     next_access_lock.unlock();
 
-    for (const auto& callback : *callbacks_) {
-      (*callback)(record);
+    for (const auto& subscription : *callbacks_) {
+      subscription->callback(arg);
+      add(&subscription->calls, 1);
     }
-    if (record.severity() == FATAL) {
-      abort();
+  }
+
+  // notify() measuring the time spent in each callback.
+  template <class Arg>
+  SLOG_INLINE void notifyTimed(const Arg& arg) {
+    std::unique_lock<std::mutex> low_priority_access_lock(
+        low_priority_access_mutex_);
+    std::unique_lock<std::mutex> next_access_lock(next_access_mutex_);
+    std::unique_lock<std::mutex> data_lock(data_mutex_);
+    next_access_lock.unlock();
+
+    for (const auto& subscription : *callbacks_) {
+      const auto start = std::chrono::steady_clock::now();
+      subscription->callback(arg);
+      const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+      add(&subscription->calls, 1);
+      add(&subscription->total_ns, ns);
+      if (ns > subscription->max_ns.load(std::memory_order_relaxed)) {
+        subscription->max_ns.store(ns, std::memory_order_relaxed);
+      }
     }
   }
 
+  // Appends the stats of each subscriber, labeled `kind`. May be called from
+  // a callback.
+  void addStats(const char* kind, std::vector<SlogSubscriberStats>* stats);
+
  private:
-  SlogCallbackId addCallback(const SlogCallback& callback);
+  struct Subscription {
+    explicit Subscription(const Callback& callback) : callback(callback) {}
+
+    const Callback callback;
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+  };
+
+  static SLOG_INLINE void add(std::atomic<uint64_t>* counter, uint64_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n,
+                   std::memory_order_relaxed);
+  }
+
+  SlogCallbackId addCallback(const Callback& callback);
   void removeCallback(SlogCallbackId callback_id);
 
   // SlogContextSubscribers class manages SlogSubscriber resources. Only
   // SlogSubscriber shared pointer can be exposed to the external users via
   // create() interface. Internal details or their copies like callbacks_ should
   // never be exposed. This is required to guarantee the thread-safety of
-  // ContextSubscribers.
-  std::shared_ptr<std::vector<std::shared_ptr<SlogCallback>>> callbacks_{
-      new std::vector<std::shared_ptr<SlogCallback>>()};
+  // ContextSubscribers. It is replaced with std::atomic_store() under
+  // data_mutex_, so that addStats() may read it without the mutexes.
+  std::shared_ptr<std::vector<std::shared_ptr<Subscription>>> callbacks_{
+      new std::vector<std::shared_ptr<Subscription>>()};
 
   // Using "triple mutex" pattern from
   // https://stackoverflow.com/questions/11666610/how-to-give-priority-to-privileged-thread-in-mutex-locking
@@ -69,6 +168,15 @@ class SlogContextSubscribers {
   std::mutex low_priority_access_mutex_;
 };
 
+extern template class SlogContextSubscribersT<SlogCallback>;
+extern template class SlogContextSubscribersT<SlogBatchCallback>;
+extern template class SlogContextSubscribersT<SlogScopeBatchCallback>;
+
+using SlogContextSubscribers = SlogContextSubscribersT<SlogCallback>;
+using SlogContextBatchSubscribers = SlogContextSubscribersT<SlogBatchCallback>;
+using SlogContextScopeSubscribers =
+    SlogContextSubscribersT<SlogScopeBatchCallback>;
+
 }  // namespace slog
 
 #endif
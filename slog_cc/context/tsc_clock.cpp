@@ -0,0 +1,216 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/context/tsc_clock.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "slog_cc/context/context.h"
+
+namespace slog {
+
+namespace {
+
+// Max rate correction applied to catch up with CLOCK_MONOTONIC, NTP slews
+// clocks by at most 500 ppm as well.
+constexpr double kMaxSlew = 500e-6;
+constexpr int kNumSampleTries = 5;
+// Shortest interval the TSC rate is measured over: samples are accurate to
+// tens of ns, a few ppm of it.
+constexpr int64_t kMinRateIntervalNs = 10000000;
+
+SLOG_INLINE int64_t clockNs(clockid_t clock_id) {
+  struct timespec ts;
+  clock_gettime(clock_id, &ts);
+  return ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+}  // namespace
+
+SlogTscClock::SlogTscClock(const SlogTscClockOptions& options,
+                           std::shared_ptr<SlogContext> slog_context)
+    : options_(options),
+      slog_context_(slog_context),
+      conversion_(slog_context->tscConversion()),
+      previous_clock_(slog_context->clock()) {
+  if (!isSupported()) {
+    return;
+  }
+  reference_ = sample();
+  const int64_t end_ns =
+      reference_.elapsed_ns +
+      std::chrono::nanoseconds(options_.initial_calibration).count();
+  while (clockNs(CLOCK_MONOTONIC) < end_ns) {
+  }
+  const Sample current = sample();
+  if (current.ticks <= reference_.ticks) {
+    std::cerr << "slog: TSC did not advance, using clock_gettime()"
+              << std::endl;
+    return;
+  }
+  const double ns_per_tick =
+      static_cast<double>(current.elapsed_ns - reference_.elapsed_ns) /
+      (current.ticks - reference_.ticks);
+  ticks_per_second_ = 1e9 / ns_per_tick;
+  publish(current.ticks, current.elapsed_ns,
+          static_cast<uint64_t>(
+              std::ldexp(ns_per_tick, SlogTscConversion::kMultShift)),
+          current.global_ns - current.elapsed_ns);
+  reference_ = current;
+  last_calibration_ns_ = current.elapsed_ns;
+  active_ = true;
+
+  slog_context_->setClock(SlogClock::kTsc);
+  slog_subscriber_ = slog_context_->createAsyncBatchSubscriber(
+      [this](const std::vector<SlogRecord>&) {
+        const int64_t interval_ns =
+            std::chrono::nanoseconds(options_.calibration_interval).count();
+        if (clockNs(CLOCK_MONOTONIC) - last_calibration_ns_ >= interval_ns) {
+          calibrate();
+        }
+      });
+}
+
+SlogTscClock::~SlogTscClock() {
+  slog_subscriber_.reset();
+  if (active_) {
+    deactivate();
+  }
+}
+
+SlogTimestamps SlogTscClock::now() const noexcept {
+  if (active_.load(std::memory_order_relaxed)) {
+    return conversion_->now();
+  }
+  return clockGettimeTimestamps(CLOCK_MONOTONIC, CLOCK_REALTIME);
+}
+
+void SlogTscClock::deactivate() {
+  active_ = false;
+  slog_context_->setClock(previous_clock_);
+}
+
+void SlogTscClock::calibrate() {
+  if (!active_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  const Sample current = sample();
+  last_calibration_ns_ = current.elapsed_ns;
+  if (current.ticks <= reference_.ticks) {
+    std::cerr << "slog: TSC went back, using clock_gettime()" << std::endl;
+    deactivate();
+    return;
+  }
+  // The rate over the last interval only, a rate change would be diluted by
+  // the uptime in the rate since the start.
+  const int64_t rate_interval_ns = current.elapsed_ns - reference_.elapsed_ns;
+  if (rate_interval_ns >= kMinRateIntervalNs) {
+    const double ticks_per_second =
+        1e9 * (current.ticks - reference_.ticks) / rate_interval_ns;
+    const double drift_ppm =
+        std::abs(ticks_per_second / ticks_per_second_ - 1.0) * 1e6;
+    if (drift_ppm > options_.max_rate_drift_ppm) {
+      std::cerr << "slog: TSC rate drifted by " << drift_ppm
+                << " ppm, using clock_gettime()" << std::endl;
+      deactivate();
+      return;
+    }
+    ticks_per_second_ = ticks_per_second;
+    reference_ = current;
+  }
+  const double ns_per_tick = 1e9 / ticks_per_second_;
+
+  // Continues from the current conversion and absorbs its error against
+  // CLOCK_MONOTONIC over the next interval. Falling far behind, e.g. after the
+  // process was stopped, steps forward instead.
+  const int64_t converted_ns =
+      base_ns_ + SlogTscConversion::toNs(
+                     static_cast<int64_t>(current.ticks - base_ticks_), mult_);
+  const double interval_ns = static_cast<double>(
+      std::chrono::nanoseconds(options_.calibration_interval).count());
+  double slew =
+      (current.elapsed_ns - converted_ns) / std::max(interval_ns, 1.0);
+  int64_t base_ns = converted_ns;
+  if (slew > kMaxSlew) {
+    base_ns = current.elapsed_ns;
+    slew = 0;
+  }
+  slew = std::max(slew, -kMaxSlew);
+  publish(current.ticks, base_ns,
+          static_cast<uint64_t>(std::ldexp(ns_per_tick * (1 + slew),
+                                           SlogTscConversion::kMultShift)),
+          current.global_ns - current.elapsed_ns);
+}
+
+bool SlogTscClock::isSupported() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+  // Invariant TSC: CPUID.80000007H:EDX[8], constant rate in all ACPI P-, C-
+  // and T-states.
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) ||
+      (edx & (1U << 8)) == 0) {
+    return false;
+  }
+  // The kernel switches away from the TSC when it finds it unstable, e.g.
+  // unsynchronized between sockets.
+  std::ifstream clocksource(
+      "/sys/devices/system/clocksource/clocksource0/current_clocksource");
+  std::string name;
+  if (clocksource >> name) {
+    return name == "tsc";
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+SlogTscClock::Sample SlogTscClock::sample() {
+  // Keeps the try with the fewest ticks around the clock reads, the least
+  // disturbed by interrupts.
+  Sample best{};
+  uint64_t best_span = UINT64_MAX;
+  for (int i = 0; i < kNumSampleTries; ++i) {
+    const uint64_t before = SlogTscConversion::readTicks();
+    const int64_t elapsed_ns = clockNs(CLOCK_MONOTONIC);
+    const int64_t global_ns = clockNs(CLOCK_REALTIME);
+    const uint64_t after = SlogTscConversion::readTicks();
+    if (after - before < best_span) {
+      best_span = after - before;
+      best = Sample{before + best_span / 2, elapsed_ns, global_ns};
+    }
+  }
+  return best;
+}
+
+void SlogTscClock::publish(uint64_t base_ticks, int64_t base_ns, uint64_t mult,
+                           int64_t realtime_offset_ns) {
+  base_ticks_ = base_ticks;
+  base_ns_ = base_ns;
+  mult_ = mult;
+  conversion_->publish(base_ticks, base_ns, mult, realtime_offset_ns);
+}
+
+}  // namespace slog
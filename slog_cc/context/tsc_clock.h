@@ -0,0 +1,112 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_context_tsc_clock
+#define slog_cc_context_tsc_clock
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "slog_cc/context/clock.h"
+#include "slog_cc/context/subscribers.h"
+#include "slog_cc/primitives/timestamps.h"
+
+namespace slog {
+
+class SlogContext;
+
+struct SlogTscClockOptions {
+  // Calibration is refreshed in the async queue thread this often.
+  std::chrono::milliseconds calibration_interval{1000};
+  // Busy wait of the initial calibration in the constructor.
+  std::chrono::milliseconds initial_calibration{10};
+  // The clock falls back to clock_gettime() for good when the TSC rate
+  // measured over a calibration interval differs more than this from the one
+  // of the previous interval.
+  double max_rate_drift_ppm = 1000;
+};
+
+// Timestamps from one read of the invariant TSC instead of two
+// clock_gettime() calls per event. Calibrates SlogTscConversion of the context
+// against clock_gettime() and selects SlogClock::kTsc. Each calibration slews
+// the conversion towards CLOCK_MONOTONIC over the next interval, so
+// elapsed_ns never goes back, and picks up wall clock steps within an
+// interval.
+//
+// Usage, one per context, selects the TSC clock for its lifetime:
+//   SlogTscClock clock(SlogTscClockOptions(), SlogContext::getInstance());
+// On machines without a reliable TSC (no invariant TSC, the kernel not using
+// it as its clocksource, or a rate drift seen on calibration) the previous
+// clock of the context stays or is selected back.
+class SlogTscClock {
+ public:
+  SlogTscClock(const SlogTscClockOptions& options,
+               std::shared_ptr<SlogContext> slog_context);
+  // Selects the clock used before.
+  ~SlogTscClock();
+  SlogTscClock(const SlogTscClock&) = delete;
+  SlogTscClock& operator=(const SlogTscClock&) = delete;
+
+  // Same as SlogContext::getTimestamps() while active.
+  SlogTimestamps now() const noexcept;
+
+  // Samples the TSC against clock_gettime() and publishes a new conversion.
+  // Called periodically in the async queue thread, one caller at a time.
+  void calibrate();
+
+  // False when the TSC is not used.
+  bool active() const { return active_.load(std::memory_order_relaxed); }
+  // Measured by the last calibration, 0 if not active.
+  double ticksPerSecond() const { return ticks_per_second_; }
+
+  // Invariant TSC reported by CPUID and used by the kernel as its clocksource.
+  static bool isSupported();
+
+ private:
+  struct Sample {
+    uint64_t ticks;
+    int64_t elapsed_ns;
+    int64_t global_ns;
+  };
+
+  static Sample sample();
+  void publish(uint64_t base_ticks, int64_t base_ns, uint64_t mult,
+               int64_t realtime_offset_ns);
+  void deactivate();
+
+  const SlogTscClockOptions options_;
+  std::shared_ptr<SlogContext> slog_context_;
+  SlogTscConversion* const conversion_;
+  SlogClock previous_clock_;
+
+  std::atomic<bool> active_{false};
+  std::atomic<double> ticks_per_second_{0};
+
+  // Calibration state, accessed by the calibrating thread only. The sample
+  // the rate was last measured at.
+  Sample reference_{};
+  int64_t last_calibration_ns_ = 0;
+  // Last published conversion.
+  uint64_t base_ticks_ = 0;
+  int64_t base_ns_ = 0;
+  uint64_t mult_ = 0;
+
+  SlogSubscriber slog_subscriber_;
+};
+
+}  // namespace slog
+
+#endif
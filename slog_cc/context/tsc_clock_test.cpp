@@ -0,0 +1,113 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/context/tsc_clock.h"
+
+#include <time.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/context/context.h"
+
+namespace slog {
+
+namespace {
+
+int64_t clockNs(clockid_t clock_id) {
+  struct timespec ts;
+  clock_gettime(clock_id, &ts);
+  return ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Calibration is only run by the tests.
+SlogTscClockOptions testOptions() {
+  SlogTscClockOptions options;
+  options.calibration_interval = std::chrono::hours(1);
+  return options;
+}
+
+}  // namespace
+
+TEST(SlogTscClock, close_to_clock_gettime) {
+  SlogTscClock clock(testOptions(), SlogContext::getInstance());
+  EXPECT_EQ(SlogTscClock::isSupported(), clock.active());
+  for (int i = 0; i < 10; ++i) {
+    const int64_t before_ns = clockNs(CLOCK_MONOTONIC);
+    const SlogTimestamps timestamps = clock.now();
+    const int64_t after_ns = clockNs(CLOCK_MONOTONIC);
+    const int64_t global_ns = clockNs(CLOCK_REALTIME);
+    // The initial calibration is accurate to a few ppm, 20ms apart are fine.
+    EXPECT_LT(std::abs(timestamps.elapsed_ns - (before_ns + after_ns) / 2),
+              100000);
+    EXPECT_LT(std::abs(timestamps.global_ns - global_ns), 100000);
+    EXPECT_EQ(SlogGlobalClockTypeId::kWallTimeClock,
+              timestamps.global_clock_type_id);
+    clock.calibrate();
+  }
+}
+
+TEST(SlogTscClock, monotonic) {
+  SlogTscClock clock(testOptions(), SlogContext::getInstance());
+  int64_t last_ns = clock.now().elapsed_ns;
+  for (int i = 0; i < 100000; ++i) {
+    if (i % 1000 == 0) {
+      clock.calibrate();
+    }
+    const int64_t ns = clock.now().elapsed_ns;
+    ASSERT_GE(ns, last_ns);
+    last_ns = ns;
+  }
+}
+
+TEST(SlogTscClock, installed_in_context) {
+  auto context = SlogContext::getInstance();
+  {
+    SlogTscClock clock(testOptions(), context);
+    if (!clock.active()) {
+      GTEST_SKIP() << "No reliable TSC";
+    }
+    EXPECT_EQ(SlogClock::kTsc, context->clock());
+    EXPECT_GT(clock.ticksPerSecond(), 1e6);
+    const int64_t before_ns = clockNs(CLOCK_MONOTONIC);
+    const int64_t elapsed_ns = context->getTimestamps().elapsed_ns;
+    EXPECT_LT(std::abs(elapsed_ns - before_ns), 100000);
+  }
+  // The default clock is back.
+  EXPECT_EQ(SlogClock::kMonotonic, context->clock());
+  const int64_t before_ns = clockNs(CLOCK_MONOTONIC);
+  const int64_t elapsed_ns = context->getTimestamps().elapsed_ns;
+  const int64_t after_ns = clockNs(CLOCK_MONOTONIC);
+  EXPECT_LE(before_ns, elapsed_ns);
+  EXPECT_LE(elapsed_ns, after_ns);
+}
+
+TEST(SlogTscClock, falls_back_on_drift) {
+  SlogTscClockOptions options = testOptions();
+  options.max_rate_drift_ppm = -1;
+  SlogTscClock clock(options, SlogContext::getInstance());
+  // Past the shortest interval the rate is measured over.
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  clock.calibrate();
+  EXPECT_FALSE(clock.active());
+  EXPECT_EQ(SlogClock::kMonotonic, SlogContext::getInstance()->clock());
+  const int64_t before_ns = clockNs(CLOCK_MONOTONIC);
+  const int64_t elapsed_ns = clock.now().elapsed_ns;
+  EXPECT_LE(before_ns, elapsed_ns);
+}
+
+}  // namespace slog
@@ -23,6 +23,7 @@
 #include "slog_cc/util/inline_macro.h"
 #include "slog_cc/util/os/thread_id.h"
 #include "slog_cc/util/string_util.h"
+#include "slog_cc/util/usdt.h"
 
 namespace slog {
 
@@ -42,8 +43,12 @@ class SlogEvent {
             }(),
             call_site_id, severity) {}
 
+  // Fires the slog:event USDT probe (call site ID, severity), see usdt.h.
   SLOG_INLINE ~SlogEvent() {
-    record_.set_time(SlogContext::getInstance()->getTimestamps());
+    SLOG_USDT2(event, record_.call_site_id(), record_.severity());
+    if (!time_set_) {
+      record_.set_time(SlogContext::getInstance()->getTimestamps());
+    }
     SlogContext::getInstance()->notifySyncSubscribers(this->record_);
     SlogContext::getInstance()->notifyAsyncSubscribers(
         std::move(this->record_));
@@ -51,6 +56,13 @@ class SlogEvent {
 
   SLOG_INLINE const SlogRecord& record() const { return record_; }
 
+  // Stamps the record with `time` instead of reading the clock on emission.
+  SLOG_INLINE SlogEvent& setTime(const SlogTimestamps& time) {
+    record_.set_time(time);
+    time_set_ = true;
+    return *this;
+  }
+
   template <class... Args>
   SLOG_INLINE SlogEvent& addTag(Args&&... args) {
     record_.addTag(std::forward<Args>(args)..., SlogTagVerbosity::kSilent);
@@ -92,6 +104,7 @@ class SlogEvent {
  private:
   SlogRecord record_;
   int16_t stream_term_tag_id_ = 0;
+  bool time_set_ = false;
 };
 
 }  // namespace slog
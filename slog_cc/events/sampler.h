@@ -0,0 +1,116 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_events_sampler
+#define slog_cc_events_sampler
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+#include "slog_cc/events/event.h"
+#include "slog_cc/util/inline_macro.h"
+
+namespace slog {
+
+// Number of events of the call site suppressed by sampling since the previous
+// emitted event. Added to an emitted event only when non-zero.
+constexpr char kSlogTagKeySuppressedCount[] = ".suppressed_count";
+
+struct SlogSample {
+  bool emit;
+  int32_t call_site_id;
+  int64_t num_suppressed;
+};
+
+// Sampling state of one call site, kept in the static storage of the
+// SLOG_EVERY_N/SLOG_FIRST_N/SLOG_EVERY_T/SLOG_RATE_LIMITED macros next to the
+// call site ID. Thread-safe; a suppressed event costs one or two atomic
+// operations and never builds a record.
+class SlogCallSiteSampler {
+ public:
+  explicit SlogCallSiteSampler(int32_t call_site_id)
+      : call_site_id_(call_site_id) {}
+
+  // Emits events 1, n + 1, 2n + 1, ...
+  SLOG_INLINE SlogSample everyN(int64_t n) {
+    const int64_t count = count_.fetch_add(1, std::memory_order_relaxed);
+    if (n <= 1) {
+      return {true, call_site_id_, 0};
+    }
+    if (count % n != 0) {
+      return {false, call_site_id_, 0};
+    }
+    return {true, call_site_id_, count == 0 ? 0 : n - 1};
+  }
+
+  // Emits the first n events only.
+  SLOG_INLINE SlogSample firstN(int64_t n) {
+    return {count_.load(std::memory_order_relaxed) < n &&
+                count_.fetch_add(1, std::memory_order_relaxed) < n,
+            call_site_id_, 0};
+  }
+
+  // Emits at most one event per period.
+  SLOG_INLINE SlogSample everyT(double period_sec) {
+    return tokenBucket(1.0 / period_sec, 1.0);
+  }
+
+  // Emits at most `rate` events per second on average and at most `burst`
+  // events at once. Implemented as GCRA, the token bucket with its state in
+  // a single atomic: the time at which the bucket is full again.
+  SLOG_INLINE SlogSample tokenBucket(double rate, double burst) {
+    const int64_t now_ns = nowNs();
+    const int64_t interval_ns = static_cast<int64_t>(1e9 / rate);
+    const int64_t max_delay_ns = static_cast<int64_t>(burst * interval_ns);
+    int64_t full_ns = full_ns_.load(std::memory_order_relaxed);
+    int64_t new_full_ns;
+    do {
+      new_full_ns = std::max(full_ns, now_ns) + interval_ns;
+      if (new_full_ns - now_ns > max_delay_ns) {
+        num_suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return {false, call_site_id_, 0};
+      }
+    } while (!full_ns_.compare_exchange_weak(full_ns, new_full_ns,
+                                             std::memory_order_relaxed));
+    return {true, call_site_id_,
+            num_suppressed_.exchange(0, std::memory_order_relaxed)};
+  }
+
+ private:
+  static SLOG_INLINE int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  const int32_t call_site_id_;
+  std::atomic<int64_t> count_{0};
+  std::atomic<int64_t> full_ns_{std::numeric_limits<int64_t>::min() / 2};
+  std::atomic<int64_t> num_suppressed_{0};
+};
+
+SLOG_INLINE SlogEvent& addSuppressedCount(SlogEvent&& event,
+                                          int64_t num_suppressed) {
+  if (num_suppressed > 0) {
+    event.addTag(kSlogTagKeySuppressedCount, num_suppressed);
+  }
+  return event;
+}
+
+}  // namespace slog
+
+#endif
@@ -16,7 +16,99 @@
 
 namespace slog {
 
-thread_local int SlogScope::thread_local_scopes_counter_ = 0;
-thread_local int SlogScope::thread_local_scopes_depth_ = 0;
+thread_local int SlogThreadScopes::counter = 0;
+thread_local int SlogThreadScopes::depth = 0;
+thread_local int SlogThreadScopes::current_scope_id = 0;
+thread_local uint32_t SlogThreadScopes::scopes_since_usage_sample = 0;
+thread_local uint32_t SlogThreadScopes::scopes_since_perf_sample = 0;
+thread_local uint32_t SlogThreadScopes::scopes_since_alloc_sample = 0;
+thread_local SlogScopeBudget* SlogThreadScopes::budget = nullptr;
+
+constexpr int SlogScopeBudget::kMaxChildren;
+
+int32_t SlogScope::nameId(const SlogEvent& log_event) {
+  const SlogTag* name = log_event.record().find_tag(kSlogTagKeyScopeName);
+  return name != nullptr
+             ? SlogContext::getInstance()->addScopeName(name->valueString())
+             : -1;
+}
+
+void SlogScope::addUsageTags(const util::os::ThreadUsage& open_usage,
+                             const util::os::ThreadUsage& close_usage,
+                             SlogEvent* event) {
+  event->addTag(kSlogTagKeyScopeCpuNs, close_usage.cpu_ns - open_usage.cpu_ns)
+      .addTag(kSlogTagKeyScopeVoluntarySwitches,
+              close_usage.voluntary_switches - open_usage.voluntary_switches)
+      .addTag(kSlogTagKeyScopeInvoluntarySwitches,
+              close_usage.involuntary_switches -
+                  open_usage.involuntary_switches)
+      .addTag(kSlogTagKeyScopeMinorFaults,
+              close_usage.minor_faults - open_usage.minor_faults)
+      .addTag(kSlogTagKeyScopeMajorFaults,
+              close_usage.major_faults - open_usage.major_faults);
+}
+
+void SlogScope::addAllocTags(const util::os::AllocCounters& open_allocs,
+                             const util::os::AllocCounters& close_allocs,
+                             SlogEvent* event) {
+  event
+      ->addTag(kSlogTagKeyScopeAllocs,
+               static_cast<int64_t>(close_allocs.allocs - open_allocs.allocs))
+      .addTag(kSlogTagKeyScopeFrees,
+              static_cast<int64_t>(close_allocs.frees - open_allocs.frees))
+      .addTag(kSlogTagKeyScopeAllocBytes,
+              static_cast<int64_t>(close_allocs.allocated_bytes -
+                                   open_allocs.allocated_bytes))
+      .addTag(kSlogTagKeyScopeFreeBytes,
+              static_cast<int64_t>(close_allocs.freed_bytes -
+                                   open_allocs.freed_bytes));
+}
+
+void SlogScope::addPerfTags(const uint64_t* open_counters,
+                            const uint64_t* close_counters, SlogEvent* event) {
+  using util::os::ThreadPerfCounters;
+  static constexpr const char* kHardwareKeys[] = {
+      kSlogTagKeyScopeCycles, kSlogTagKeyScopeInstructions,
+      kSlogTagKeyScopeCacheMisses, kSlogTagKeyScopeBranchMisses};
+  static constexpr const char* kSoftwareKeys[] = {
+      kSlogTagKeyScopeTaskClockNs, kSlogTagKeyScopeContextSwitches,
+      kSlogTagKeyScopeCpuMigrations, kSlogTagKeyScopePageFaults};
+  const char* const* keys = util::os::thread_perf_counters()->kind() ==
+                                    ThreadPerfCounters::Kind::kHardware
+                                ? kHardwareKeys
+                                : kSoftwareKeys;
+  for (int i = 0; i < ThreadPerfCounters::kNumCounters; ++i) {
+    event->addTag(keys[i],
+                  static_cast<int64_t>(close_counters[i] - open_counters[i]));
+  }
+}
+
+void SlogScope::reportOverrun(int64_t duration_ns) const {
+  SlogEvent warning(WARNING, budget_->call_site_id);
+  warning.addTag(kSlogTagKeyOverrunScopeId, scope_id_)
+      .addTag(kSlogTagKeyScopeNameId, name_id_)
+      .addTag(kSlogTagKeyScopeBudget, budget_->budget_ns)
+      .addTag(kSlogTagKeyScopeOverrun, duration_ns - budget_->budget_ns)
+      << "Scope " << context_->scopeName(name_id_) << " took "
+      << duration_ns / 1000 << " us, over its budget of "
+      << budget_->budget_ns / 1000 << " us";
+  const auto add_child = [&](const std::string& name,
+                             const SlogScopeBudget::Child& child) {
+    warning.addTag(kSlogTagKeyScopeChildNsPrefix + name, child.duration_ns)
+        .addTag(kSlogTagKeyScopeChildCountPrefix + name, child.count);
+    warning << (&child == budget_->children ? ": " : ", ") << name << " "
+            << child.duration_ns / 1000 << " us";
+    if (child.count > 1) {
+      warning << " (" << child.count << ")";
+    }
+  };
+  for (int i = 0; i < budget_->num_children; ++i) {
+    add_child(context_->scopeName(budget_->children[i].name_id),
+              budget_->children[i]);
+  }
+  if (budget_->others.count > 0) {
+    add_child(kSlogScopeOtherChildren, budget_->others);
+  }
+}
 
 }  // namespace slog
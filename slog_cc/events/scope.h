@@ -15,52 +15,389 @@
 #ifndef slog_cc_events_scope
 #define slog_cc_events_scope
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <string>
+#include <utility>
 
+#include "slog_cc/context/context.h"
 #include "slog_cc/events/event.h"
+#include "slog_cc/primitives/scope_entry.h"
 #include "slog_cc/util/inline_macro.h"
+#include "slog_cc/util/os/alloc_counters.h"
+#include "slog_cc/util/os/perf_counters.h"
+#include "slog_cc/util/os/thread_usage.h"
+#include "slog_cc/util/usdt.h"
 
 namespace slog {
 
-constexpr char kSlogTagKeyFuncBlockStart[] = ".func_block_b";
-constexpr char kSlogTagKeyScopeClose[] = ".scope_close";
-constexpr char kSlogTagKeyScopeId[] = ".scope_id";
-constexpr char kSlogTagKeyScopeDepth[] = ".scope_depth";
-constexpr char kSlogTagKeyScopeName[] = ".scope_name";
-constexpr char kSlogTagKeyScopeOpen[] = ".scope_open";
+// Latency budget of a SLOG_SCOPE_BUDGET scope, and durations of its child
+// scopes by name for the breakdown of an overrun.
+struct SlogScopeBudget {
+  // Children with more distinct names than this are summed up as others.
+  static constexpr int kMaxChildren = 8;
 
-}  // namespace slog
+  struct Child {
+    int32_t name_id;
+    int32_t count;
+    int64_t duration_ns;
+  };
 
-#define _SLOG_SCOPE_CLOSE(scope_id)        \
-  slog::SlogEvent(slog::INFO)              \
-      .addTag(slog::kSlogTagKeyScopeClose) \
-      .addTag(slog::kSlogTagKeyScopeId, scope_id)
+  explicit SlogScopeBudget(std::chrono::nanoseconds budget)
+      : budget_ns(budget.count()) {}
+  SlogScopeBudget(const SlogScopeBudget&) = delete;
+  SlogScopeBudget& operator=(const SlogScopeBudget&) = delete;
 
-namespace slog {
+  SLOG_INLINE void addChild(int32_t name_id, int64_t duration_ns) {
+    for (int i = 0; i < num_children; ++i) {
+      if (children[i].name_id == name_id) {
+        ++children[i].count;
+        children[i].duration_ns += duration_ns;
+        return;
+      }
+    }
+    if (num_children < kMaxChildren) {
+      children[num_children++] = Child{name_id, 1, duration_ns};
+    } else {
+      ++others.count;
+      others.duration_ns += duration_ns;
+    }
+  }
 
-class SlogScope {
+  const int64_t budget_ns;
+  int32_t scope_id = 0;
+  int32_t call_site_id = 0;
+  // Budget of the enclosing budgeted scope of the thread.
+  SlogScopeBudget* parent = nullptr;
+  int num_children = 0;
+  Child children[kMaxChildren];
+  Child others{-1, 0, 0};
+};
+
+// Scope IDs, depths and the innermost scope of the thread, shared by SlogScope
+// and SlogFastScope so that they nest. Both fire the USDT probes (see usdt.h)
+//   slog:scope_open(scope ID, depth, call site ID, name ID)
+//   slog:scope_close(scope ID, depth, name ID, duration ns)
+struct SlogThreadScopes {
+  thread_local static int counter;
+  thread_local static int depth;
+  thread_local static int current_scope_id;
+  // SlogScope scopes opened since the last usage sample.
+  thread_local static uint32_t scopes_since_usage_sample;
+  thread_local static uint32_t scopes_since_perf_sample;
+  thread_local static uint32_t scopes_since_alloc_sample;
+  // Budget of the innermost SLOG_SCOPE_BUDGET scope, nullptr for none.
+  thread_local static SlogScopeBudget* budget;
+
+  // Adds a closing scope to the breakdown of its parent if it is budgeted.
+  static SLOG_INLINE void closeChild(int32_t parent_scope_id, int32_t name_id,
+                                     int64_t duration_ns) {
+    SlogScopeBudget* const parent_budget = budget;
+    if (parent_budget != nullptr &&
+        parent_budget->scope_id == parent_scope_id) {
+      parent_budget->addChild(name_id, duration_ns);
+    }
+  }
+};
+
+// Name of a SLOG_SCOPE and its ID, see SlogContext::addScopeName().
+struct SlogScopeName {
+  const char* name;
+  int32_t id;
+};
+
+// Static state of a SLOG_SCOPE call site. The ID of a literal name is taken
+// once per call site; other names, e.g. std::string or char buffers, are
+// looked up on every open.
+class SlogScopeNameSite {
  public:
-  // Passing a SlogEvent by reference here because we don't want to make any
-  // copies (this would trigger event logging). See SLOG_SCOPE macro in slog.h
-  SlogScope(SlogEvent& log_event) {
-    scope_id_ = ++thread_local_scopes_counter_;
-    ++thread_local_scopes_depth_;
-    log_event.addTag(kSlogTagKeyScopeOpen)
-        .addTag(kSlogTagKeyScopeId, scope_id_)
-        .addTag(kSlogTagKeyScopeDepth, thread_local_scopes_depth_);
+  SlogScopeNameSite() : context_(SlogContext::getInstance().get()) {}
+
+  template <size_t N>
+  SLOG_INLINE SlogScopeName name(const char (&name)[N]) {
+    int32_t id = name_id_.load(std::memory_order_relaxed);
+    if (id < 0) {
+      id = context_->addScopeName(name);
+      name_id_.store(id, std::memory_order_relaxed);
+    }
+    return SlogScopeName{name, id};
+  }
+  template <size_t N>
+  SLOG_INLINE SlogScopeName name(char (&name)[N]) {
+    return SlogScopeName{name, context_->addScopeName(name)};
+  }
+  SLOG_INLINE SlogScopeName name(const std::string& name) {
+    return SlogScopeName{name.c_str(), context_->addScopeName(name)};
   }
 
+ private:
+  SlogContext* const context_;
+  std::atomic<int32_t> name_id_{-1};
+};
+
+// The open event of a SLOG_SCOPE with the ID of its name. Tags added to it go
+// to the open record, e.g. SLOG_SCOPE("load").addTag("file", path).
+class SlogScopeEvent {
+ public:
+  SLOG_INLINE SlogScopeEvent(SlogEvent&& log_event, const SlogScopeName& name)
+      : log_event_(log_event), name_id_(name.id) {
+    log_event_.addTag(kSlogTagKeyScopeName, name.name);
+  }
+
+  template <class... Args>
+  SLOG_INLINE SlogScopeEvent& addTag(Args&&... args) {
+    log_event_.addTag(std::forward<Args>(args)...);
+    return *this;
+  }
+  template <class T>
+  SLOG_INLINE SlogScopeEvent& operator<<(T&& value) {
+    log_event_ << std::forward<T>(value);
+    return *this;
+  }
+
+  SLOG_INLINE SlogEvent& logEvent() { return log_event_; }
+  SLOG_INLINE int32_t nameId() const { return name_id_; }
+
+ private:
+  SlogEvent& log_event_;
+  const int32_t name_id_;
+};
+
+class SlogScope {
+ public:
+  // A scope opened by `log_event`, which has a kSlogTagKeyScopeName tag, e.g.
+  // from the Python bindings. Passing a SlogEvent by reference here because we
+  // don't want to make any copies (this would trigger event logging). The name
+  // ID is looked up on every open.
+  SlogScope(SlogEvent& log_event)
+      : SlogScope(log_event, nameId(log_event), nullptr) {}
+  // A scope checked against `budget` on close if not null. See SLOG_SCOPE and
+  // SLOG_SCOPE_BUDGET macros in slog.h.
+  SlogScope(SlogScopeEvent& scope_event, SlogScopeBudget* budget = nullptr)
+      : SlogScope(scope_event.logEvent(), scope_event.nameId(), budget) {}
+  SlogScope(SlogScopeEvent&& scope_event, SlogScopeBudget* budget = nullptr)
+      : SlogScope(scope_event, budget) {}
+
+  // The close record carries the duration, the parent scope and the name ID,
+  // so it can be processed without the open record, and usage, counter and
+  // allocation deltas of a sampled scope. A budgeted scope over its budget
+  // emits a WARNING record next.
   SLOG_INLINE ~SlogScope() {
-    _SLOG_SCOPE_CLOSE(scope_id_);
-    --thread_local_scopes_depth_;
+    util::os::AllocCounters close_allocs;
+    if (alloc_sampled_) {
+      close_allocs = *util::os::thread_alloc_counters();
+    }
+    uint64_t close_counters[util::os::ThreadPerfCounters::kNumCounters];
+    const bool perf_sampled =
+        perf_sampled_ && util::os::thread_perf_counters()->read(close_counters);
+    util::os::ThreadUsage close_usage;
+    const bool usage_sampled =
+        usage_sampled_ && util::os::get_thread_usage(&close_usage);
+    const SlogTimestamps close_time = context_->getTimestamps();
+    const int64_t duration_ns = close_time.elapsed_ns - open_time_.elapsed_ns;
+    {
+      SlogEvent close(INFO);
+      close.setTime(close_time)
+          .addTag(kSlogTagKeyScopeClose)
+          .addTag(kSlogTagKeyScopeId, scope_id_)
+          .addTag(kSlogTagKeyScopeNameId, name_id_)
+          .addTag(kSlogTagKeyScopeParentId, parent_scope_id_)
+          .addTag(kSlogTagKeyScopeDuration, duration_ns);
+      if (usage_sampled) {
+        addUsageTags(open_usage_, close_usage, &close);
+      }
+      if (perf_sampled) {
+        addPerfTags(open_counters_, close_counters, &close);
+      }
+      if (alloc_sampled_) {
+        addAllocTags(open_allocs_, close_allocs, &close);
+      }
+    }
+    if (budget_ != nullptr) {
+      SlogThreadScopes::budget = budget_->parent;
+      if (duration_ns > budget_->budget_ns) {
+        reportOverrun(duration_ns);
+      }
+    }
+    SlogThreadScopes::closeChild(parent_scope_id_, name_id_, duration_ns);
+    SLOG_USDT4(scope_close, scope_id_, SlogThreadScopes::depth, name_id_,
+               duration_ns);
+    context_->scopeStacks().threadStack()->pop(SlogThreadScopes::depth);
+    --SlogThreadScopes::depth;
+    SlogThreadScopes::current_scope_id = parent_scope_id_;
   }
-  static int currentScopeDepth() { return thread_local_scopes_depth_; }
+  static int currentScopeDepth() { return SlogThreadScopes::depth; }
 
  private:
   SlogScope() = delete;
-  thread_local static int thread_local_scopes_counter_;
-  thread_local static int thread_local_scopes_depth_;
-  int scope_id_ = -1;
+  SLOG_INLINE SlogScope(SlogEvent& log_event, int32_t name_id,
+                        SlogScopeBudget* budget)
+      : context_(SlogContext::getInstance().get()),
+        budget_(budget),
+        scope_id_(++SlogThreadScopes::counter),
+        parent_scope_id_(SlogThreadScopes::current_scope_id),
+        name_id_(name_id),
+        open_time_(context_->getTimestamps()) {
+    SlogThreadScopes::current_scope_id = scope_id_;
+    ++SlogThreadScopes::depth;
+    log_event.setTime(open_time_)
+        .addTag(kSlogTagKeyScopeOpen)
+        .addTag(kSlogTagKeyScopeId, scope_id_)
+        .addTag(kSlogTagKeyScopeDepth, SlogThreadScopes::depth)
+        .addTag(kSlogTagKeyScopeNameId, name_id_);
+    context_->scopeStacks().threadStack()->push(
+        SlogThreadScopes::depth, scope_id_, name_id_, open_time_.elapsed_ns);
+    SLOG_USDT4(scope_open, scope_id_, SlogThreadScopes::depth,
+               log_event.record().call_site_id(), name_id_);
+    if (budget_ != nullptr) {
+      budget_->scope_id = scope_id_;
+      budget_->call_site_id = log_event.record().call_site_id();
+      budget_->parent = SlogThreadScopes::budget;
+      SlogThreadScopes::budget = budget_;
+    }
+    if (sample(context_->scopeUsageSamplingPeriod(),
+               &SlogThreadScopes::scopes_since_usage_sample)) {
+      usage_sampled_ = util::os::get_thread_usage(&open_usage_);
+    }
+    if (sample(context_->scopePerfSamplingPeriod(),
+               &SlogThreadScopes::scopes_since_perf_sample)) {
+      perf_sampled_ = util::os::thread_perf_counters()->read(open_counters_);
+    }
+    if (sample(context_->scopeAllocSamplingPeriod(),
+               &SlogThreadScopes::scopes_since_alloc_sample)) {
+      alloc_sampled_ = util::os::alloc_hooks_installed();
+      open_allocs_ = *util::os::thread_alloc_counters();
+    }
+  }
+  // ID of the kSlogTagKeyScopeName tag of `log_event`, -1 for none.
+  static int32_t nameId(const SlogEvent& log_event);
+  // Whether to sample this scope, one in `period` of the thread.
+  static SLOG_INLINE bool sample(uint32_t period, uint32_t* num_scopes) {
+    if (period == 0 || ++*num_scopes < period) {
+      return false;
+    }
+    *num_scopes = 0;
+    return true;
+  }
+  static void addUsageTags(const util::os::ThreadUsage& open_usage,
+                           const util::os::ThreadUsage& close_usage,
+                           SlogEvent* event);
+  static void addPerfTags(const uint64_t* open_counters,
+                          const uint64_t* close_counters, SlogEvent* event);
+  static void addAllocTags(const util::os::AllocCounters& open_allocs,
+                           const util::os::AllocCounters& close_allocs,
+                           SlogEvent* event);
+  void reportOverrun(int64_t duration_ns) const;
+
+  SlogContext* const context_;
+  SlogScopeBudget* const budget_;
+  const int scope_id_;
+  const int parent_scope_id_;
+  const int32_t name_id_;
+  const SlogTimestamps open_time_;
+  bool usage_sampled_ = false;
+  util::os::ThreadUsage open_usage_;
+  bool perf_sampled_ = false;
+  uint64_t open_counters_[util::os::ThreadPerfCounters::kNumCounters];
+  bool alloc_sampled_ = false;
+  util::os::AllocCounters open_allocs_;
+};
+
+// Static state of a SLOG_FAST_SCOPE call site.
+struct SlogFastScopeSite {
+  SlogFastScopeSite(const char* function, const char* file, int32_t line,
+                    const std::string& name)
+      : context(SlogContext::getInstance().get()),
+        call_site_id(context->addCallSite(function, file, line)),
+        name_id(context->addScopeName(name)) {}
+
+  SlogContext* const context;
+  const int32_t call_site_id;
+  const int32_t name_id;
+};
+
+// A scope like SlogScope recorded as two compact SlogScopeEntry in a
+// thread-local ring instead of two records, see SLOG_FAST_SCOPE in slog.h.
+class SlogFastScope {
+ public:
+  SLOG_INLINE explicit SlogFastScope(const SlogFastScopeSite& site)
+      : site_(site),
+        scope_id_(++SlogThreadScopes::counter),
+        parent_scope_id_(SlogThreadScopes::current_scope_id),
+        depth_(++SlogThreadScopes::depth) {
+    SlogThreadScopes::current_scope_id = scope_id_;
+    open_elapsed_ns_ = site_.context->getElapsedNs();
+    site_.context->scopeStacks().threadStack()->push(
+        depth_, scope_id_, site_.name_id, open_elapsed_ns_);
+    SLOG_USDT4(scope_open, scope_id_, depth_, site_.call_site_id,
+               site_.name_id);
+    addEntry(open_elapsed_ns_, 0, true);
+  }
+
+  SLOG_INLINE ~SlogFastScope() {
+    const int64_t close_elapsed_ns = site_.context->getElapsedNs();
+    const int64_t duration_ns = close_elapsed_ns - open_elapsed_ns_;
+    addEntry(close_elapsed_ns, duration_ns, false);
+    SlogThreadScopes::closeChild(parent_scope_id_, site_.name_id, duration_ns);
+    SLOG_USDT4(scope_close, scope_id_, depth_, site_.name_id, duration_ns);
+    site_.context->scopeStacks().threadStack()->pop(depth_);
+    --SlogThreadScopes::depth;
+    SlogThreadScopes::current_scope_id = parent_scope_id_;
+  }
+
+  SlogFastScope(const SlogFastScope&) = delete;
+  SlogFastScope& operator=(const SlogFastScope&) = delete;
+
+ private:
+  // Only the elapsed time is read, the global time is derived when the entry
+  // is drained.
+  SLOG_INLINE void addEntry(int64_t elapsed_ns, int64_t duration_ns,
+                            bool open) {
+    site_.context->addScopeEntry(SlogScopeEntry{
+        SlogTimestamps{elapsed_ns}, duration_ns, /*thread_id=*/0,
+        site_.call_site_id, site_.name_id, scope_id_, parent_scope_id_, depth_,
+        open});
+  }
+
+  const SlogFastScopeSite& site_;
+  const int scope_id_;
+  const int parent_scope_id_;
+  const int depth_;
+  int64_t open_elapsed_ns_;
+};
+
+// Static state of a SLOG_SCOPE_STATS call site.
+struct SlogStatsScopeSite {
+  SlogStatsScopeSite(const char* function, const char* file, int32_t line,
+                     const std::string& name)
+      : context(SlogContext::getInstance().get()),
+        site(context->scopeStats().addSite(
+            context->addCallSite(function, file, line), name)) {}
+
+  SlogContext* const context;
+  const int32_t site;
+};
+
+// A scope adding its duration to the histogram of its call site for the
+// thread instead of emitting records, see SLOG_SCOPE_STATS in slog.h.
+class SlogStatsScope {
+ public:
+  SLOG_INLINE explicit SlogStatsScope(const SlogStatsScopeSite& site)
+      : site_(site), open_ns_(site_.context->getElapsedNs()) {}
+
+  SLOG_INLINE ~SlogStatsScope() {
+    const int64_t duration_ns = site_.context->getElapsedNs() - open_ns_;
+    site_.context->scopeStats().threadHistogram(site_.site)->record(
+        duration_ns > 0 ? duration_ns : 0);
+  }
+
+  SlogStatsScope(const SlogStatsScope&) = delete;
+  SlogStatsScope& operator=(const SlogStatsScope&) = delete;
+
+ private:
+  const SlogStatsScopeSite& site_;
+  const int64_t open_ns_;
 };
 
 }  // namespace slog
@@ -0,0 +1,89 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/events/scope_watchdog.h"
+
+#include <vector>
+
+#include "slog_cc/context/context.h"
+#include "slog_cc/events/event.h"
+
+namespace slog {
+
+SlogScopeWatchdog::SlogScopeWatchdog(const SlogScopeWatchdogOptions& options,
+                                     std::shared_ptr<SlogContext> slog_context)
+    : options_(options),
+      slog_context_(std::move(slog_context)),
+      call_site_id_(
+          slog_context_->addCallSite(__FUNCTION__, __FILE__, __LINE__)),
+      last_check_time_(std::chrono::steady_clock::now()) {
+  slog_subscriber_ = slog_context_->createAsyncBatchSubscriber(
+      [this](const std::vector<SlogRecord>&) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_check_time_ >= options_.check_interval) {
+          last_check_time_ = now;
+          check();
+        }
+      });
+}
+
+SlogScopeWatchdog::~SlogScopeWatchdog() { slog_subscriber_.reset(); }
+
+void SlogScopeWatchdog::check() {
+  const int64_t now_ns = slog_context_->getElapsedNs();
+  std::set<std::pair<int32_t, int32_t>> reported;
+  for (const SlogThreadScopeStack& stack :
+       slog_context_->scopeStacks().snapshot()) {
+    for (const SlogOpenScope& scope : stack.scopes) {
+      const int64_t budget_ns = budgetNs(scope.name_id);
+      const int64_t open_ns = now_ns - scope.open_elapsed_ns;
+      if (budget_ns == 0 || open_ns <= budget_ns) {
+        continue;
+      }
+      const auto key = std::make_pair(stack.thread_id, scope.scope_id);
+      reported.insert(key);
+      if (reported_.count(key) != 0) {
+        continue;
+      }
+      SlogEvent(WARNING, call_site_id_)
+              .addTag(kSlogTagKeyScopeThreadId, stack.thread_id)
+              .addTag(kSlogTagKeyLateScopeId, scope.scope_id)
+              .addTag(kSlogTagKeyScopeNameId, scope.name_id)
+              .addTag(kSlogTagKeyScopeDepth, scope.depth)
+              .addTag(kSlogTagKeyScopeOpenNs, open_ns)
+              .addTag(kSlogTagKeyScopeBudget, budget_ns)
+          << "Scope " << slog_context_->scopeName(scope.name_id)
+          << " of thread " << stack.thread_id << " is open for "
+          << open_ns / 1000000 << " ms, over its budget of "
+          << budget_ns / 1000000 << " ms";
+    }
+  }
+  reported_.swap(reported);
+}
+
+int64_t SlogScopeWatchdog::budgetNs(int32_t name_id) {
+  const auto it = budgets_by_name_id_.find(name_id);
+  if (it != budgets_by_name_id_.end()) {
+    return it->second;
+  }
+  int64_t budget_ns = options_.default_budget.count();
+  const auto budget = options_.budgets.find(slog_context_->scopeName(name_id));
+  if (budget != options_.budgets.end()) {
+    budget_ns = budget->second.count();
+  }
+  budgets_by_name_id_[name_id] = budget_ns;
+  return budget_ns;
+}
+
+}  // namespace slog
@@ -0,0 +1,83 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_events_scope_watchdog
+#define slog_cc_events_scope_watchdog
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "slog_cc/context/subscribers.h"
+
+namespace slog {
+
+class SlogContext;
+
+struct SlogScopeWatchdogOptions {
+  // Open scopes are checked in the async queue thread this often, and at
+  // least once per second as the queue wakes up when idle.
+  std::chrono::milliseconds check_interval{100};
+  // A scope still open after this long is reported, 0 for no limit.
+  std::chrono::nanoseconds default_budget{std::chrono::seconds(1)};
+  // Budgets of scopes by name, overriding default_budget.
+  std::unordered_map<std::string, std::chrono::nanoseconds> budgets;
+};
+
+// Reports SLOG_SCOPE and SLOG_FAST_SCOPE scopes still open past their budget,
+// e.g. of a thread deadlocked or spinning within a scope, which emits no close
+// record. The scope stacks of all threads (SlogContext::scopeStacks()) are
+// checked in the async queue thread, so a scope costs nothing more than its
+// stack slot writes. A WARNING record is emitted once per late scope with
+// kSlogTagKeyLateScopeId, kSlogTagKeyScopeThreadId, kSlogTagKeyScopeOpenNs and
+// kSlogTagKeyScopeBudget tags besides the name ID and depth.
+//
+// Usage, checks while it lives:
+//   SlogScopeWatchdog watchdog(options, SlogContext::getInstance());
+class SlogScopeWatchdog {
+ public:
+  SlogScopeWatchdog(const SlogScopeWatchdogOptions& options,
+                    std::shared_ptr<SlogContext> slog_context);
+  ~SlogScopeWatchdog();
+  SlogScopeWatchdog(const SlogScopeWatchdog&) = delete;
+  SlogScopeWatchdog& operator=(const SlogScopeWatchdog&) = delete;
+
+  // Reports scopes late by now that are not reported yet. Called periodically
+  // in the async queue thread, one caller at a time.
+  void check();
+
+ private:
+  // Budget of scopes named SlogContext::scopeName(name_id), 0 for none.
+  int64_t budgetNs(int32_t name_id);
+
+  const SlogScopeWatchdogOptions options_;
+  std::shared_ptr<SlogContext> slog_context_;
+  const int32_t call_site_id_;
+
+  // Check state, accessed by the checking thread only.
+  std::chrono::steady_clock::time_point last_check_time_;
+  std::unordered_map<int32_t, int64_t> budgets_by_name_id_;
+  // Thread and scope IDs of reported scopes still open.
+  std::set<std::pair<int32_t, int32_t>> reported_;
+
+  SlogSubscriber slog_subscriber_;
+};
+
+}  // namespace slog
+
+#endif
@@ -0,0 +1,84 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/events/stats_reporter.h"
+
+#include <string>
+#include <vector>
+
+#include "slog_cc/context/context.h"
+#include "slog_cc/events/event.h"
+
+namespace slog {
+
+SlogStatsReporter::SlogStatsReporter(const SlogStatsReporterOptions& options,
+                                     std::shared_ptr<SlogContext> slog_context)
+    : options_(options),
+      slog_context_(std::move(slog_context)),
+      call_site_id_(
+          slog_context_->addCallSite(__FUNCTION__, __FILE__, __LINE__)),
+      last_report_time_(std::chrono::steady_clock::now()),
+      last_stats_(slog_context_->stats()) {
+  slog_subscriber_ = slog_context_->createAsyncBatchSubscriber(
+      [this](const std::vector<SlogRecord>&) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_report_time_ >= options_.interval) {
+          last_report_time_ = now;
+          report();
+        }
+      });
+}
+
+SlogStatsReporter::~SlogStatsReporter() { slog_subscriber_.reset(); }
+
+void SlogStatsReporter::report() {
+  const SlogStats stats = slog_context_->stats();
+  const std::string prefix = kSlogTagKeyStatsPrefix;
+  const double seconds = (stats.elapsed_ns - last_stats_.elapsed_ns) / 1e9;
+  const auto per_second = [seconds](uint64_t count, uint64_t last_count) {
+    return seconds > 0 ? (count - last_count) / seconds : 0.0;
+  };
+  SlogEvent event(INFO, call_site_id_);
+  event.addTag(prefix + "records_emitted", stats.records_emitted)
+      .addTag(prefix + "records_enqueued", stats.records_enqueued)
+      .addTag(prefix + "records_delivered", stats.records_delivered)
+      .addTag(prefix + "records_enqueued_per_s",
+              per_second(stats.records_enqueued, last_stats_.records_enqueued))
+      .addTag(prefix + "records_delivered_per_s",
+              per_second(stats.records_delivered,
+                         last_stats_.records_delivered))
+      .addTag(prefix + "scope_entries_collected",
+              stats.scope_entries_collected)
+      .addTag(prefix + "scope_entries_dropped", stats.scope_entries_dropped)
+      .addTag(prefix + "queue_depth", stats.queue_depth)
+      .addTag(prefix + "queue_depth_high_water", stats.queue_depth_high_water)
+      .addTag(prefix + "batches", stats.batches)
+      .addTag(prefix + "batch_size_p50", stats.batch_size_p50)
+      .addTag(prefix + "batch_size_p99", stats.batch_size_p99)
+      .addTag(prefix + "batch_size_max", stats.batch_size_max)
+      .addTag(prefix + "flush_waits", stats.flush_waits)
+      .addTag(prefix + "flush_wait_total_ns", stats.flush_wait_total_ns)
+      .addTag(prefix + "flush_wait_max_ns", stats.flush_wait_max_ns);
+  for (size_t i = 0; i < stats.subscribers.size(); ++i) {
+    const SlogSubscriberStats& subscriber = stats.subscribers[i];
+    const std::string key = prefix + "subscriber." + std::to_string(i) + "." +
+                            subscriber.kind + ".";
+    event.addTag(key + "calls", subscriber.calls)
+        .addTag(key + "total_ns", subscriber.total_ns)
+        .addTag(key + "max_ns", subscriber.max_ns);
+  }
+  last_stats_ = stats;
+}
+
+}  // namespace slog
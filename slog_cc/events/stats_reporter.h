@@ -0,0 +1,72 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_events_stats_reporter
+#define slog_cc_events_stats_reporter
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "slog_cc/context/stats.h"
+#include "slog_cc/context/subscribers.h"
+
+namespace slog {
+
+class SlogContext;
+
+// Tags of SlogStatsReporter records: SlogStats fields prefixed with
+// kSlogTagKeyStatsPrefix, e.g. ".stats.records_enqueued", the rates over the
+// interval (".stats.records_enqueued_per_s", ".stats.records_delivered_per_s")
+// and per subscriber ".stats.subscriber.<index>.<kind>.calls", ".total_ns"
+// and ".max_ns".
+constexpr char kSlogTagKeyStatsPrefix[] = ".stats.";
+
+struct SlogStatsReporterOptions {
+  // A record is emitted from the async queue thread this often.
+  std::chrono::milliseconds interval{10000};
+};
+
+// Emits SlogContext::stats() periodically as an INFO record with silent tags
+// only, so that it is stored with the other records but not echoed.
+//
+// Usage, reports while it lives:
+//   SlogStatsReporter reporter(options, SlogContext::getInstance());
+class SlogStatsReporter {
+ public:
+  SlogStatsReporter(const SlogStatsReporterOptions& options,
+                    std::shared_ptr<SlogContext> slog_context);
+  ~SlogStatsReporter();
+  SlogStatsReporter(const SlogStatsReporter&) = delete;
+  SlogStatsReporter& operator=(const SlogStatsReporter&) = delete;
+
+  // Emits the stats now. Called periodically in the async queue thread, one
+  // caller at a time.
+  void report();
+
+ private:
+  const SlogStatsReporterOptions options_;
+  std::shared_ptr<SlogContext> slog_context_;
+  const int32_t call_site_id_;
+
+  // Report state, accessed by the reporting thread only.
+  std::chrono::steady_clock::time_point last_report_time_;
+  SlogStats last_stats_;
+
+  SlogSubscriber slog_subscriber_;
+};
+
+}  // namespace slog
+
+#endif
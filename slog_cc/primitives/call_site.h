@@ -25,16 +25,24 @@ class SlogCallSite {
  public:
   SLOG_INLINE SlogCallSite(const std::string& function, const std::string& file,
                            int32_t line)
-      : function_(function), file_(file), line_(line) {}
+      : function_(function),
+        file_(file),
+        line_(line),
+        basename_offset_(file_.rfind('/') + 1) {}
 
   SLOG_INLINE const std::string& function() const { return function_; }
   SLOG_INLINE const std::string& file() const { return file_; }
   SLOG_INLINE int32_t line() const { return line_; }
+  // File name without directories, computed once per call site for printing.
+  SLOG_INLINE const char* basename() const {
+    return file_.c_str() + basename_offset_;
+  }
 
  private:
   std::string function_;
   std::string file_;
   int32_t line_;
+  size_t basename_offset_;
 };
 
 }  // namespace slog
@@ -0,0 +1,78 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/primitives/gps_time.h"
+
+#include <limits>
+
+namespace slog {
+
+namespace {
+
+constexpr int64_t kNsPerSecond = 1000000000;
+
+// GPS nanoseconds [begin_ns, end_ns) sharing one offset to Unix time.
+struct GpsPeriod {
+  int64_t begin_ns;
+  int64_t end_ns;
+  int64_t unix_minus_gps_ns;
+};
+
+// In GPS time the leap second of kSlogLeapSeconds[i] ends at its UTC second
+// plus the new offset.
+int64_t gpsNsOfLeapSecond(const SlogLeapSecond& leap_second) {
+  return (leap_second.unix_second + leap_second.gps_minus_utc -
+          kGpsEpochUnixSecond) *
+         kNsPerSecond;
+}
+
+GpsPeriod findGpsPeriod(int64_t gps_ns) {
+  GpsPeriod period{std::numeric_limits<int64_t>::min(),
+                   std::numeric_limits<int64_t>::max(),
+                   kGpsEpochUnixSecond * kNsPerSecond};
+  for (const SlogLeapSecond& leap_second : kSlogLeapSeconds) {
+    const int64_t leap_second_gps_ns = gpsNsOfLeapSecond(leap_second);
+    if (gps_ns < leap_second_gps_ns) {
+      period.end_ns = leap_second_gps_ns;
+      break;
+    }
+    period.begin_ns = leap_second_gps_ns;
+    period.unix_minus_gps_ns =
+        (kGpsEpochUnixSecond - leap_second.gps_minus_utc) * kNsPerSecond;
+  }
+  return period;
+}
+
+}  // namespace
+
+int64_t gpsToUnixNs(int64_t gps_ns) {
+  thread_local GpsPeriod period{0, 0, 0};
+  if (gps_ns < period.begin_ns || gps_ns >= period.end_ns) {
+    period = findGpsPeriod(gps_ns);
+  }
+  return gps_ns + period.unix_minus_gps_ns;
+}
+
+int64_t unixToGpsNs(int64_t unix_ns) {
+  int32_t gps_minus_utc = 0;
+  for (const SlogLeapSecond& leap_second : kSlogLeapSeconds) {
+    if (unix_ns < leap_second.unix_second * kNsPerSecond) {
+      break;
+    }
+    gps_minus_utc = leap_second.gps_minus_utc;
+  }
+  return unix_ns + (gps_minus_utc - kGpsEpochUnixSecond) * kNsPerSecond;
+}
+
+}  // namespace slog
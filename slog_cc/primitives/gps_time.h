@@ -0,0 +1,77 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_primitives_gps_time
+#define slog_cc_primitives_gps_time
+
+#include <cstdint>
+
+#include "slog_cc/primitives/timestamps.h"
+#include "slog_cc/util/inline_macro.h"
+
+namespace slog {
+
+// GPS time counts SI seconds since 1980-01-06T00:00:00Z without leap seconds,
+// so it runs ahead of UTC by the number of leap seconds inserted since then.
+constexpr int64_t kGpsEpochUnixSecond = 315964800;
+
+struct SlogLeapSecond {
+  // UTC (Unix) second at which the new offset starts.
+  int64_t unix_second;
+  // GPS - UTC in seconds from then on.
+  int32_t gps_minus_utc;
+};
+
+// All leap seconds since the GPS epoch. None has been announced after
+// 2017-01-01; a new one has to be appended here.
+constexpr SlogLeapSecond kSlogLeapSeconds[] = {
+    {362793600, 1},    // 1981-07-01
+    {394329600, 2},    // 1982-07-01
+    {425865600, 3},    // 1983-07-01
+    {489024000, 4},    // 1985-07-01
+    {567993600, 5},    // 1988-01-01
+    {631152000, 6},    // 1990-01-01
+    {662688000, 7},    // 1991-01-01
+    {709948800, 8},    // 1992-07-01
+    {741484800, 9},    // 1993-07-01
+    {773020800, 10},   // 1994-07-01
+    {820454400, 11},   // 1996-01-01
+    {867715200, 12},   // 1997-07-01
+    {915148800, 13},   // 1999-01-01
+    {1136073600, 14},  // 2006-01-01
+    {1230768000, 15},  // 2009-01-01
+    {1341100800, 16},  // 2012-07-01
+    {1435708800, 17},  // 2015-07-01
+    {1483228800, 18},  // 2017-01-01
+};
+
+// Nanoseconds since the GPS epoch to Unix nanoseconds (UTC). A leap second
+// itself maps onto the first second after it, as Unix time has no room for
+// it. The offset found is cached per thread, so converting timestamps of one
+// period costs two comparisons and an add.
+int64_t gpsToUnixNs(int64_t gps_ns);
+// Unix nanoseconds (UTC) to nanoseconds since the GPS epoch.
+int64_t unixToGpsNs(int64_t unix_ns);
+
+// Unix nanoseconds of the global timestamp in any supported clock.
+SLOG_INLINE int64_t toUnixNs(const SlogTimestamps& timestamps) {
+  return timestamps.global_clock_type_id ==
+                 SlogGlobalClockTypeId::kGpsEpochClock
+             ? gpsToUnixNs(timestamps.global_ns)
+             : timestamps.global_ns;
+}
+
+}  // namespace slog
+
+#endif
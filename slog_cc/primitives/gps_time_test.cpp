@@ -0,0 +1,63 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/primitives/gps_time.h"
+
+#include <gtest/gtest.h>
+
+namespace slog {
+
+namespace {
+
+constexpr int64_t kNs = 1000000000;
+
+}  // namespace
+
+TEST(SlogGpsTime, known_values) {
+  EXPECT_EQ(kGpsEpochUnixSecond * kNs, gpsToUnixNs(0));
+  EXPECT_EQ(0, unixToGpsNs(kGpsEpochUnixSecond * kNs));
+  // 2017-01-01T00:00:00Z, 18 leap seconds since the GPS epoch.
+  EXPECT_EQ(1483228800 * kNs, gpsToUnixNs(1167264018 * kNs));
+  EXPECT_EQ(1167264018 * kNs, unixToGpsNs(1483228800 * kNs));
+  // 2016-12-31T23:59:59Z, 17 leap seconds.
+  EXPECT_EQ(1483228799 * kNs, gpsToUnixNs(1167264016 * kNs));
+}
+
+TEST(SlogGpsTime, leap_second) {
+  // The leap second 2016-12-31T23:59:60Z maps onto the next second.
+  EXPECT_EQ(1483228800 * kNs, gpsToUnixNs(1167264017 * kNs));
+  EXPECT_EQ(1483228800 * kNs + 500000000,
+            gpsToUnixNs(1167264017 * kNs + 500000000));
+  EXPECT_EQ(1483228800 * kNs - 1, gpsToUnixNs(1167264017 * kNs - 1));
+}
+
+TEST(SlogGpsTime, round_trip) {
+  // Alternates between the first and the last period to switch the cache.
+  for (int64_t unix_second = 300000000; unix_second < 1700000000;
+       unix_second += 7777777) {
+    const int64_t unix_ns = unix_second * kNs + 123;
+    EXPECT_EQ(unix_ns, gpsToUnixNs(unixToGpsNs(unix_ns)));
+    EXPECT_EQ(1690000000 * kNs, gpsToUnixNs(unixToGpsNs(1690000000 * kNs)));
+  }
+}
+
+TEST(SlogGpsTime, to_unix_ns) {
+  SlogTimestamps timestamps;
+  timestamps.global_ns = 1167264018 * kNs;
+  EXPECT_EQ(1167264018 * kNs, toUnixNs(timestamps));
+  timestamps.global_clock_type_id = SlogGlobalClockTypeId::kGpsEpochClock;
+  EXPECT_EQ(1483228800 * kNs, toUnixNs(timestamps));
+}
+
+}  // namespace slog
@@ -68,11 +68,19 @@ class SlogRecord {
 
   bool isNoisy() const;
 
+  // Set on emission when the stderr echo of the record is left to the async
+  // echo, see SlogContext::addAsyncStderrEcho().
+  SLOG_INLINE bool async_stderr_echo() const { return async_stderr_echo_; }
+  SLOG_INLINE void set_async_stderr_echo(bool value) {
+    async_stderr_echo_ = value;
+  }
+
  private:
   int32_t thread_id_ = -1;
   int32_t call_site_id_ = -1;
   SlogTimestamps time_;
   int8_t severity_ = -1;
+  bool async_stderr_echo_ = false;
   std::vector<SlogTag> tags_;
 };
 
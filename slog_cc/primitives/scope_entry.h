@@ -0,0 +1,100 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_primitives_scope_entry
+#define slog_cc_primitives_scope_entry
+
+#include <cstdint>
+
+#include "slog_cc/primitives/timestamps.h"
+
+namespace slog {
+
+// Tags of scope records, see SLOG_SCOPE.
+constexpr char kSlogTagKeyFuncBlockStart[] = ".func_block_b";
+constexpr char kSlogTagKeyScopeClose[] = ".scope_close";
+constexpr char kSlogTagKeyScopeId[] = ".scope_id";
+constexpr char kSlogTagKeyScopeDepth[] = ".scope_depth";
+constexpr char kSlogTagKeyScopeName[] = ".scope_name";
+constexpr char kSlogTagKeyScopeOpen[] = ".scope_open";
+// Name ID of the scope, see SlogContext::scopeName().
+constexpr char kSlogTagKeyScopeNameId[] = ".scope_name_id";
+// Tags of close records, they let a close be processed without its open.
+constexpr char kSlogTagKeyScopeDuration[] = ".duration_ns";
+constexpr char kSlogTagKeyScopeParentId[] = ".parent_scope_id";
+// Resources used by the thread within the scope, on close records of sampled
+// scopes, see SlogContext::setScopeUsageSampling().
+constexpr char kSlogTagKeyScopeCpuNs[] = ".cpu_ns";
+constexpr char kSlogTagKeyScopeVoluntarySwitches[] = ".voluntary_switches";
+constexpr char kSlogTagKeyScopeInvoluntarySwitches[] = ".involuntary_switches";
+constexpr char kSlogTagKeyScopeMinorFaults[] = ".minor_faults";
+constexpr char kSlogTagKeyScopeMajorFaults[] = ".major_faults";
+// perf counter deltas on close records of sampled scopes, see
+// SlogContext::setScopePerfSampling(): hardware counters, or software ones
+// where the hardware ones are unavailable.
+constexpr char kSlogTagKeyScopeCycles[] = ".cycles";
+constexpr char kSlogTagKeyScopeInstructions[] = ".instructions";
+constexpr char kSlogTagKeyScopeCacheMisses[] = ".cache_misses";
+constexpr char kSlogTagKeyScopeBranchMisses[] = ".branch_misses";
+constexpr char kSlogTagKeyScopeTaskClockNs[] = ".task_clock_ns";
+constexpr char kSlogTagKeyScopeContextSwitches[] = ".context_switches";
+constexpr char kSlogTagKeyScopeCpuMigrations[] = ".cpu_migrations";
+constexpr char kSlogTagKeyScopePageFaults[] = ".page_faults";
+// Heap allocations of the thread within sampled scopes, see
+// SlogContext::setScopeAllocSampling().
+constexpr char kSlogTagKeyScopeAllocs[] = ".allocs";
+constexpr char kSlogTagKeyScopeFrees[] = ".frees";
+constexpr char kSlogTagKeyScopeAllocBytes[] = ".alloc_bytes";
+constexpr char kSlogTagKeyScopeFreeBytes[] = ".free_bytes";
+// Tags of SlogScopeWatchdog warnings about a scope open past its budget,
+// with the name ID and depth tags of the scope. Like kSlogTagKeyOverrunScopeId
+// the scope ID has a key of its own, the warning doesn't open or close it.
+constexpr char kSlogTagKeyLateScopeId[] = ".late_scope_id";
+constexpr char kSlogTagKeyScopeThreadId[] = ".scope_thread_id";
+constexpr char kSlogTagKeyScopeOpenNs[] = ".open_ns";
+constexpr char kSlogTagKeyScopeBudget[] = ".budget_ns";
+// Tags of SLOG_SCOPE_BUDGET warnings about a scope over its budget, with the
+// name ID and budget tags: the scope ID, the overrun, and the total duration
+// and count of child scopes of each name, e.g. ".child_ns.load". The scope ID
+// isn't kSlogTagKeyScopeId, which marks scope open and close records.
+constexpr char kSlogTagKeyOverrunScopeId[] = ".overrun_scope_id";
+constexpr char kSlogTagKeyScopeOverrun[] = ".overrun_ns";
+constexpr char kSlogTagKeyScopeChildNsPrefix[] = ".child_ns.";
+constexpr char kSlogTagKeyScopeChildCountPrefix[] = ".child_count.";
+// Child name of the children beyond SlogScopeBudget::kMaxChildren names.
+constexpr char kSlogScopeOtherChildren[] = "(other)";
+
+// A compact record of a scope opening or closing, emitted by SLOG_FAST_SCOPE
+// instead of a SlogRecord with string-keyed tags.
+struct SlogScopeEntry {
+  // Only elapsed_ns is read when the scope opens or closes. The global time is
+  // added when the entry is drained, with the offset between the clocks then.
+  SlogTimestamps time;
+  // Elapsed time since the opening, 0 for an opening.
+  int64_t duration_ns;
+  int32_t thread_id;
+  int32_t call_site_id;
+  // Name of the scope is SlogContext::scopeName(name_id).
+  int32_t name_id;
+  int32_t scope_id;
+  // ID of the enclosing scope of the thread, 0 for none.
+  int32_t parent_scope_id;
+  // 1 for an outermost scope.
+  int32_t depth;
+  bool open;
+};
+
+}  // namespace slog
+
+#endif
@@ -16,20 +16,80 @@
 
 #include <algorithm>
 #include <cassert>
-#include <chrono>
+#include <cstdio>
+#include <ctime>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "slog_cc/primitives/call_site.h"
+#include "slog_cc/primitives/gps_time.h"
 #include "slog_cc/primitives/record.h"
 #include "slog_cc/util/assert_macro.h"
 #include "slog_cc/util/string_util.h"
 
 namespace slog {
 
+namespace {
+
+// Local time of the last second printed by this thread. Records mostly come in
+// time order, so localtime_r() runs about once per second per thread.
+struct SlogLocalTimeCache {
+  int64_t unix_second = std::numeric_limits<int64_t>::min();
+  tm local_tm;
+};
+
+const tm& localTime(int64_t unix_second) {
+  thread_local SlogLocalTimeCache cache;
+  if (cache.unix_second != unix_second) {
+    const std::time_t t = unix_second;
+    localtime_r(&t, &cache.local_tm);
+    cache.unix_second = unix_second;
+  }
+  return cache.local_tm;
+}
+
+// Appends `value` as exactly `width` digits with leading zeros.
+void appendDigits(uint32_t value, int width, std::string* out) {
+  char buffer[10];
+  for (int i = width - 1; i >= 0; --i) {
+    buffer[i] = '0' + value % 10;
+    value /= 10;
+  }
+  out->append(buffer, width);
+}
+
+void appendInt(int64_t value, std::string* out) {
+  char buffer[20];
+  char* end = buffer + sizeof(buffer);
+  char* pos = end;
+  uint64_t abs_value = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+  do {
+    *--pos = '0' + abs_value % 10;
+    abs_value /= 10;
+  } while (abs_value != 0);
+  if (value < 0) {
+    out->push_back('-');
+  }
+  out->append(pos, end - pos);
+}
+
+// Same output as std::to_string(double).
+void appendDouble(double value, std::string* out) {
+  char buffer[32];
+  const int size = std::snprintf(buffer, sizeof(buffer), "%f", value);
+  if (size >= 0 && static_cast<size_t>(size) < sizeof(buffer)) {
+    out->append(buffer, size);
+  } else {
+    out->append(std::to_string(value));
+  }
+}
+
+}  // namespace
+
 class SlogPrinter::Impl {
   using Line = std::vector<std::string>;
   using Row = std::vector<Line>;
@@ -110,6 +170,11 @@ class SlogPrinter::Impl {
 
   std::string flatText(const SlogRecord& record) const {
     std::string res;
+    appendFlatText(record, &res);
+    return res;
+  }
+
+  void appendFlatText(const SlogRecord& record, std::string* out) const {
     for (const auto& tag : record.tags()) {
       if (tag.verbosity() == SlogTagVerbosity::kSilent) {
         continue;
@@ -118,17 +183,16 @@ class SlogPrinter::Impl {
         case SlogTagValueType::kNone:
           break;
         case SlogTagValueType::kString:
-          res += tag.valueString();
+          out->append(tag.valueString());
           break;
         case SlogTagValueType::kInt:
-          res += std::to_string(tag.valueInt());
+          appendInt(tag.valueInt(), out);
           break;
         case SlogTagValueType::kDouble:
-          res += std::to_string(tag.valueDouble());
+          appendDouble(tag.valueDouble(), out);
           break;
       };
     }
-    return res;
   }
 
   std::string formatStderrLine(uint8_t severity, int month, int day, int hour,
@@ -142,47 +206,57 @@ class SlogPrinter::Impl {
                               msg.c_str());
   }
 
+  // Formats like formatStderrLine() but writes straight into `out`: the
+  // broken-down time is cached per second, the file basename is precomputed
+  // by the call site and numbers are formatted without printf.
+  void appendStderrLine(const SlogRecord& r, const SlogCallSite& cs,
+                        std::string* out) const {
+    const int64_t unix_ns = toUnixNs(r.time());
+    int64_t unix_second = unix_ns / 1000000000;
+    int64_t sub_second_ns = unix_ns % 1000000000;
+    if (sub_second_ns < 0) {
+      sub_second_ns += 1000000000;
+      --unix_second;
+    }
+    const tm& now_tm = localTime(unix_second);
+
+    constexpr char severities[] = "UDIWEF";
+    out->push_back(severities[r.severity()]);
+    appendDigits(now_tm.tm_mon + 1, 2, out);
+    appendDigits(now_tm.tm_mday, 2, out);
+    out->push_back(' ');
+    appendDigits(now_tm.tm_hour, 2, out);
+    out->push_back(':');
+    appendDigits(now_tm.tm_min, 2, out);
+    out->push_back(':');
+    appendDigits(now_tm.tm_sec, 2, out);
+    out->push_back('.');
+    appendDigits(sub_second_ns / 1000, 6, out);
+    out->push_back(' ');
+    appendInt(r.thread_id(), out);
+    out->push_back(' ');
+    out->append(cs.basename());
+    out->push_back(':');
+    appendInt(cs.line(), out);
+    out->append("] ", 2);
+    appendFlatText(r, out);
+  }
+
   std::string stderrLine(const SlogRecord& r, const SlogCallSite& cs) const {
-    // TODO(vsbus): improve perf ot emitStderrLine(). It regressed 1.5x
-    // comparing to using GLOG directly.
-    const auto now = [&r] {
-      switch (r.time().global_clock_type_id) {
-        case SlogGlobalClockTypeId::kWallTimeClock:
-          return std::chrono::system_clock::time_point(
-              std::chrono::duration_cast<std::chrono::system_clock::duration>(
-                  std::chrono::nanoseconds(r.time().global_ns)));
-        case SlogGlobalClockTypeId::kGpsEpochClock:
-          // TODO(vsbus): implement gps-unix-ts-conversion to avoid calling
-          // clock one more time here.
-          return std::chrono::system_clock::now();
-      }
-      SLOG_ASSERT(0 && "This line is supposed to be unreachable code.");
-    }();
-    const std::time_t now_t = std::chrono::system_clock::to_time_t(now);
-    tm now_tm;
-    localtime_r(&now_t, &now_tm);
-    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
-        now - std::chrono::system_clock::from_time_t(now_t));
-
-    const int severity = r.severity();
-    const int month = now_tm.tm_mon + 1;
-    const int day = now_tm.tm_mday;
-    const int hour = now_tm.tm_hour;
-    const int minute = now_tm.tm_min;
-    const double second = now_tm.tm_sec + (us.count() / 1e6);
-    const int thread_id = r.thread_id();
-    const std::string file_name = util::split(cs.file(), '/').back();
-    const int lineno = cs.line();
-    const std::string msg = flatText(r);
-
-    return formatStderrLine(severity, month, day, hour, minute, second,
-                            thread_id, file_name, lineno, msg);
+    std::string line;
+    appendStderrLine(r, cs, &line);
+    return line;
   }
 
   void emitStderrLine(const SlogRecord& r, const SlogCallSite& cs) const {
-    // TODO(vsbus): make emitStderr thread-safe by adding locks around printing
-    // the line.
-    std::cerr << stderrLine(r, cs) << std::endl;
+    // The buffer is reused across records, and the line goes out with one
+    // write, so lines of concurrent threads don't interleave.
+    thread_local std::string line;
+    line.clear();
+    appendStderrLine(r, cs, &line);
+    line.push_back('\n');
+    std::cerr.write(line.data(), line.size());
+    std::cerr.flush();
   }
 
   std::string renderLine(const Line& line) const {
@@ -311,9 +385,10 @@ class SlogPrinter::Impl {
        }},
       {"global_time_sec", 20,
        [](const SlogRecord& r, const SlogCallSite&) {
-         return std::vector<std::string>{
-             std::to_string(r.time().global_ns / 1000000000) + "." +
-             std::to_string(r.time().global_ns % 1000000000)};
+         const int64_t unix_ns = toUnixNs(r.time());
+         return std::vector<std::string>{util::stringPrintf(
+             "%ld.%09ld", static_cast<long>(unix_ns / 1000000000),
+             static_cast<long>(unix_ns % 1000000000))};
        }},
       {"file", 32,
        [](const SlogRecord&, const SlogCallSite& call_site) {
@@ -360,6 +435,12 @@ std::string SlogPrinter::formatStderrLine(uint8_t severity, int month, int day,
                                  thread_id, file_name, lineno, msg);
 }
 
+void SlogPrinter::appendStderrLine(const SlogRecord& record,
+                                   const SlogCallSite& call_site,
+                                   std::string* out) const {
+  impl_->appendStderrLine(record, call_site, out);
+}
+
 std::string SlogPrinter::stderrLine(const SlogRecord& record,
                                     const SlogCallSite& call_site) const {
   return impl_->stderrLine(record, call_site);
@@ -36,6 +36,10 @@ class SlogPrinter {
                                const std::string& msg) const;
   std::string stderrLine(const SlogRecord& record,
                          const SlogCallSite& call_site) const;
+  // Appends the line of stderrLine() to `out`, e.g. to reuse one buffer for
+  // many records.
+  void appendStderrLine(const SlogRecord& record, const SlogCallSite& call_site,
+                        std::string* out) const;
   void emitStderrLine(const SlogRecord& record, const SlogCallSite& call_site) const;
 
   std::vector<std::string> tableSplitter() const;
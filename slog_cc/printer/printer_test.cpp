@@ -14,8 +14,13 @@
 
 #include "slog_cc/printer/printer.h"
 
+#include <stdlib.h>
+#include <time.h>
+
 #include <gtest/gtest.h>
 
+#include "slog_cc/primitives/call_site.h"
+#include "slog_cc/primitives/gps_time.h"
 #include "slog_cc/primitives/record.h"
 
 namespace slog {
@@ -32,6 +37,42 @@ TEST(SlogPrinterTest, formatStderrLine) {
                                            "foo.cc", 73, "hola"));
 }
 
+TEST(SlogPrinterTest, stderrLine) {
+  setenv("TZ", "UTC", 1);
+  tzset();
+  const SlogPrinter printer;
+  const SlogCallSite call_site("foo", "a/b/foo.cc", 73);
+  SlogRecord record(42, 0, WARNING);
+  record.addTag("msg", "x = ");
+  record.addTag("i", -7);
+  record.addTag("d", 0.5);
+  record.addTag("silent", "s", SlogTagVerbosity::kSilent);
+  SlogTimestamps time;
+  time.global_ns = 1640995199123456789;
+  record.set_time(time);
+  EXPECT_EQ("W1231 23:59:59.123456 42 foo.cc:73] x = -70.500000",
+            printer.stderrLine(record, call_site));
+
+  // The next second is a new day.
+  time.global_ns += 1000000000;
+  record.set_time(time);
+  EXPECT_EQ("W0101 00:00:00.123456 42 foo.cc:73] x = -70.500000",
+            printer.stderrLine(record, call_site));
+
+  time.global_ns = -1;
+  record.set_time(time);
+  std::string line = "prefix ";
+  printer.appendStderrLine(record, SlogCallSite("foo", "foo.cc", 1), &line);
+  EXPECT_EQ("prefix W1231 23:59:59.999999 42 foo.cc:1] x = -70.500000", line);
+
+  // GPS timestamps are printed in UTC.
+  time.global_ns = unixToGpsNs(1640995199123456789);
+  time.global_clock_type_id = SlogGlobalClockTypeId::kGpsEpochClock;
+  record.set_time(time);
+  EXPECT_EQ("W1231 23:59:59.123456 42 foo.cc:73] x = -70.500000",
+            printer.stderrLine(record, call_site));
+}
+
 TEST(SlogPrinterTest, debugStringTag) {
   EXPECT_EQ(
       R"raw({
@@ -0,0 +1,351 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/sinks/binary_file_sink.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+
+#include "slog_cc/codec/segment.h"
+#include "slog_cc/context/context.h"
+#include "slog_cc/util/string_util.h"
+
+namespace slog {
+
+namespace {
+
+constexpr char kSegmentFileExtension[] = ".slogseg";
+
+// Parses the sequence number from a segment file name of the form
+// <prefix>.<sequence>.slogseg. Returns -1 for foreign files.
+int64_t segmentSequence(const std::string& file_name,
+                        const std::string& prefix) {
+  const std::string extension = kSegmentFileExtension;
+  if (file_name.size() <= prefix.size() + 1 + extension.size() ||
+      !util::startsWith(file_name, prefix + ".") ||
+      file_name.compare(file_name.size() - extension.size(), extension.size(),
+                        extension) != 0) {
+    return -1;
+  }
+  const std::string digits =
+      file_name.substr(prefix.size() + 1,
+                       file_name.size() - prefix.size() - 1 - extension.size());
+  if (digits.find_first_not_of("0123456789") != std::string::npos) {
+    return -1;
+  }
+  return std::strtoll(digits.c_str(), nullptr, 10);
+}
+
+std::vector<std::pair<int64_t, std::string>> findSegments(
+    const std::string& directory, const std::string& prefix) {
+  std::vector<std::pair<int64_t, std::string>> segments;
+  DIR* dir = opendir(directory.c_str());
+  if (dir == nullptr) {
+    return segments;
+  }
+  while (const dirent* entry = readdir(dir)) {
+    const int64_t sequence = segmentSequence(entry->d_name, prefix);
+    if (sequence >= 0) {
+      segments.emplace_back(sequence, directory + "/" + entry->d_name);
+    }
+  }
+  closedir(dir);
+  std::sort(segments.begin(), segments.end());
+  return segments;
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    const ssize_t n = ::write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+int64_t unixNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+SlogSegmentWriter::SlogSegmentWriter(const SlogBinaryFileSinkOptions& options)
+    : options_(options) {
+  // Continue numbering after segments left by previous runs so they are
+  // deleted first when the disk budget is exceeded.
+  const auto existing = findSegments(options_.directory, options_.file_prefix);
+  if (!existing.empty()) {
+    segment_sequence_ = existing.back().first;
+  }
+  buffer_.reserve(options_.write_size + kSlogFileWriteAlignment);
+  io_thread_ = std::thread([this] { ioLoop(); });
+}
+
+SlogSegmentWriter::~SlogSegmentWriter() {
+  {
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    if (!segment_path_.empty()) {
+      handOff(/*all=*/true, /*last=*/true);
+    }
+  }
+  {
+    std::unique_lock<std::mutex> lock(io_mutex_);
+    done_ = true;
+  }
+  io_cv_.notify_all();
+  io_thread_.join();
+}
+
+std::string SlogSegmentWriter::segmentPath(int64_t sequence) const {
+  return options_.directory + "/" + options_.file_prefix + "." +
+         util::stringPrintf("%08lld", static_cast<long long>(sequence)) +
+         kSegmentFileExtension;
+}
+
+bool SlogSegmentWriter::needsRotation() const {
+  return segment_path_.empty() ||
+         segment_bytes_ >= options_.max_segment_bytes ||
+         std::chrono::steady_clock::now() - segment_start_time_ >=
+             options_.max_segment_duration;
+}
+
+void SlogSegmentWriter::openSegment(const SlogCallSiteLookup& call_site_lookup,
+                                    int32_t num_call_sites) {
+  if (!segment_path_.empty()) {
+    handOff(/*all=*/true, /*last=*/true);
+  }
+  segment_path_ = segmentPath(++segment_sequence_);
+  segment_start_time_ = std::chrono::steady_clock::now();
+
+  SlogSegmentHeader header;
+  header.created_unix_ns = unixNowNs();
+  header.sequence = segment_sequence_;
+  appendSegmentHeader(header, &buffer_);
+
+  encoder_.reset();
+  scratch_.clear();
+  encoder_.encodeDictionary(num_call_sites, call_site_lookup, &scratch_);
+  appendBlock(scratch_.data(), scratch_.size(), &buffer_);
+  segment_bytes_ = buffer_.size();
+}
+
+void SlogSegmentWriter::write(const std::vector<SlogRecord>& records,
+                              const SlogCallSiteLookup& call_site_lookup,
+                              int32_t num_call_sites) {
+  std::unique_lock<std::mutex> lock(write_mutex_);
+  if (!records.empty()) {
+    if (needsRotation()) {
+      openSegment(call_site_lookup, num_call_sites);
+    }
+    scratch_.clear();
+    encoder_.encodeBatch(records, call_site_lookup, &scratch_);
+    const size_t size_before = buffer_.size();
+    appendBlock(scratch_.data(), scratch_.size(), &buffer_);
+    segment_bytes_ += buffer_.size() - size_before;
+  }
+  if (buffer_.size() >= options_.write_size) {
+    handOff(/*all=*/false, /*last=*/false);
+  } else if (!buffer_.empty() &&
+             std::chrono::steady_clock::now() - last_hand_off_time_ >=
+                 options_.flush_interval) {
+    handOff(/*all=*/true, /*last=*/false);
+  }
+}
+
+void SlogSegmentWriter::handOff(bool all, bool last) {
+  last_hand_off_time_ = std::chrono::steady_clock::now();
+  if (all && !last) {
+    // The next chunk starts at an aligned offset too.
+    const size_t size_before = buffer_.size();
+    appendPadding(kSlogFileWriteAlignment, &buffer_);
+    segment_bytes_ += buffer_.size() - size_before;
+  }
+  const size_t size =
+      all ? buffer_.size()
+          : buffer_.size() / kSlogFileWriteAlignment * kSlogFileWriteAlignment;
+  if (size == 0 && !last) {
+    return;
+  }
+  Chunk chunk;
+  chunk.path = segment_path_;
+  chunk.last = last;
+  if (size == buffer_.size()) {
+    chunk.data.swap(buffer_);
+    buffer_.reserve(options_.write_size + kSlogFileWriteAlignment);
+  } else {
+    chunk.data.assign(buffer_, 0, size);
+    buffer_.erase(0, size);
+  }
+  if (last) {
+    segment_path_.clear();
+  }
+  {
+    std::unique_lock<std::mutex> lock(io_mutex_);
+    io_queue_.emplace_back(std::move(chunk));
+    num_chunks_queued_ += 1;
+  }
+  io_cv_.notify_all();
+}
+
+void SlogSegmentWriter::flush() {
+  size_t num_queued = 0;
+  {
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    handOff(/*all=*/true, /*last=*/false);
+  }
+  std::unique_lock<std::mutex> lock(io_mutex_);
+  num_queued = num_chunks_queued_;
+  while (num_chunks_written_ < num_queued) {
+    io_done_cv_.wait(lock);
+  }
+}
+
+void SlogSegmentWriter::ioLoop() {
+  int fd = -1;
+  std::string open_path;
+  while (true) {
+    Chunk chunk;
+    {
+      std::unique_lock<std::mutex> lock(io_mutex_);
+      while (io_queue_.empty() && !done_) {
+        io_cv_.wait(lock);
+      }
+      if (io_queue_.empty()) {
+        break;
+      }
+      chunk = std::move(io_queue_.front());
+      io_queue_.pop_front();
+    }
+
+    if (chunk.path != open_path) {
+      if (fd != -1) {
+        close(fd);
+      }
+      open_path = chunk.path;
+      fd = open(open_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+      if (fd == -1) {
+        std::cerr << "slog: failed to open segment file " << open_path
+                  << ", errno " << errno << std::endl;
+      }
+      enforceDiskBudget(open_path);
+    }
+    if (fd != -1 && !writeAll(fd, chunk.data.data(), chunk.data.size())) {
+      std::cerr << "slog: failed to write segment file " << open_path
+                << ", errno " << errno << std::endl;
+    }
+    if (chunk.last) {
+      if (fd != -1) {
+        close(fd);
+      }
+      fd = -1;
+      open_path.clear();
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(io_mutex_);
+      num_chunks_written_ += 1;
+    }
+    io_done_cv_.notify_all();
+  }
+  if (fd != -1) {
+    close(fd);
+  }
+}
+
+void SlogSegmentWriter::enforceDiskBudget(const std::string& open_path) {
+  if (options_.max_total_bytes == 0) {
+    return;
+  }
+  const auto segments =
+      findSegments(options_.directory, options_.file_prefix);
+  std::vector<size_t> sizes;
+  size_t total_size = 0;
+  for (const auto& segment : segments) {
+    struct stat st;
+    sizes.push_back(stat(segment.second.c_str(), &st) == 0 ? st.st_size : 0);
+    total_size += sizes.back();
+  }
+  // The open segment grows up to max_segment_bytes, reserve space for it.
+  total_size += options_.max_segment_bytes;
+  for (size_t i = 0;
+       i < segments.size() && total_size > options_.max_total_bytes; ++i) {
+    if (segments[i].second == open_path) {
+      continue;
+    }
+    if (unlink(segments[i].second.c_str()) == 0) {
+      total_size -= sizes[i];
+    }
+  }
+}
+
+std::vector<std::string> SlogSegmentWriter::listSegments() const {
+  std::vector<std::string> paths;
+  for (auto& segment : findSegments(options_.directory, options_.file_prefix)) {
+    paths.emplace_back(std::move(segment.second));
+  }
+  return paths;
+}
+
+SlogBinaryFileSink::SlogBinaryFileSink(
+    const SlogBinaryFileSinkOptions& options,
+    std::shared_ptr<SlogContext> slog_context,
+    std::unique_ptr<SlogBatchFilter> filter)
+    : slog_context_(slog_context),
+      writer_(options),
+      filter_stage_(std::move(filter)),
+      slog_subscriber_(slog_context_->createAsyncBatchSubscriber(
+          [this](const std::vector<SlogRecord>& records) {
+            write(filter_stage_.process(records));
+          })) {}
+
+SlogBinaryFileSink::~SlogBinaryFileSink() {
+  // Stop receiving records before the writer is destroyed.
+  slog_subscriber_.reset();
+  const std::vector<SlogRecord>& held_back = filter_stage_.flush();
+  if (!held_back.empty()) {
+    write(held_back);
+  }
+}
+
+void SlogBinaryFileSink::write(const std::vector<SlogRecord>& records) {
+  writer_.write(
+      records,
+      [this](int32_t call_site_id) {
+        return slog_context_->getCallSite(call_site_id);
+      },
+      static_cast<int32_t>(slog_context_->numCallSites()));
+}
+
+void SlogBinaryFileSink::flush() {
+  slog_context_->waitAsyncSubscribers();
+  writer_.flush();
+}
+
+}  // namespace slog
@@ -0,0 +1,155 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_sinks_binary_file_sink
+#define slog_cc_sinks_binary_file_sink
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "slog_cc/codec/codec.h"
+#include "slog_cc/context/subscribers.h"
+#include "slog_cc/primitives/record.h"
+
+namespace slog {
+
+class SlogContext;
+
+struct SlogBinaryFileSinkOptions {
+  // Segment files are named <directory>/<file_prefix>.<sequence>.slogseg.
+  std::string directory = "/tmp";
+  std::string file_prefix = "slog";
+
+  // A segment is closed and a new one is started when either limit is hit.
+  size_t max_segment_bytes = 64 << 20;
+  std::chrono::seconds max_segment_duration{3600};
+
+  // Oldest segments with the same prefix are deleted when the total size of
+  // segments exceeds this budget. The segment being written is never deleted.
+  // 0 disables the limit.
+  size_t max_total_bytes = 1 << 30;
+
+  // Encoded data is accumulated in memory and written with write() calls of
+  // this size at offsets aligned to kSlogFileWriteAlignment. Data written
+  // early, by flush_interval or flush(), is padded to the alignment.
+  size_t write_size = 1 << 20;
+
+  // Accumulated data is written at least this often, even if write_size is not
+  // reached.
+  std::chrono::milliseconds flush_interval{1000};
+};
+
+constexpr size_t kSlogFileWriteAlignment = 4096;
+
+// Writes batches of records to rotating binary segment files, see
+// codec/segment.h for the file layout. Encoding happens in the caller thread,
+// file I/O, rotation and disk budget enforcement happen in a background
+// thread. write() is thread-safe but meant to be called from one thread.
+class SlogSegmentWriter {
+ public:
+  explicit SlogSegmentWriter(const SlogBinaryFileSinkOptions& options);
+  ~SlogSegmentWriter();
+
+  // Encodes records into the current segment. `call_site_lookup` resolves
+  // call sites the records refer to; `num_call_sites` call sites are written
+  // to the dictionary header of each new segment. An empty batch only triggers
+  // time-based flushing.
+  void write(const std::vector<SlogRecord>& records,
+             const SlogCallSiteLookup& call_site_lookup,
+             int32_t num_call_sites);
+
+  // Blocks until all data passed to write() is written to the files.
+  void flush();
+
+  // Paths of existing segment files with the configured prefix, oldest first.
+  std::vector<std::string> listSegments() const;
+
+ private:
+  struct Chunk {
+    std::string path;
+    std::string data;
+    // Close the file after writing this chunk.
+    bool last = false;
+  };
+
+  bool needsRotation() const;
+  void openSegment(const SlogCallSiteLookup& call_site_lookup,
+                   int32_t num_call_sites);
+  // Passes buffered data to the I/O thread. If `all` is false only a prefix
+  // that is a multiple of kSlogFileWriteAlignment is passed.
+  void handOff(bool all, bool last);
+  void ioLoop();
+  void enforceDiskBudget(const std::string& open_path);
+  std::string segmentPath(int64_t sequence) const;
+
+  const SlogBinaryFileSinkOptions options_;
+
+  // State of the encoding side, guarded by write_mutex_.
+  std::mutex write_mutex_;
+  SlogRecordEncoder encoder_;
+  std::string scratch_;
+  std::string buffer_;
+  std::string segment_path_;
+  int64_t segment_sequence_ = 0;
+  size_t segment_bytes_ = 0;
+  std::chrono::steady_clock::time_point segment_start_time_;
+  std::chrono::steady_clock::time_point last_hand_off_time_;
+
+  // Queue of chunks to write, guarded by io_mutex_.
+  std::mutex io_mutex_;
+  std::condition_variable io_cv_;
+  std::condition_variable io_done_cv_;
+  std::deque<Chunk> io_queue_;
+  size_t num_chunks_queued_ = 0;
+  size_t num_chunks_written_ = 0;
+  bool done_ = false;
+  std::thread io_thread_;
+};
+
+// An async batch subscriber writing all records of a SlogContext to rotating
+// binary segment files. An optional `filter` runs in front of the writer, see
+// SlogBatchFilterStage.
+class SlogBinaryFileSink {
+ public:
+  SlogBinaryFileSink(const SlogBinaryFileSinkOptions& options,
+                     std::shared_ptr<SlogContext> slog_context,
+                     std::unique_ptr<SlogBatchFilter> filter = nullptr);
+  ~SlogBinaryFileSink();
+
+  // Blocks until all records emitted before this call are written to files.
+  void flush();
+
+  std::vector<std::string> listSegments() const {
+    return writer_.listSegments();
+  }
+
+ private:
+  void write(const std::vector<SlogRecord>& records);
+
+  std::shared_ptr<SlogContext> slog_context_;
+  SlogSegmentWriter writer_;
+  SlogBatchFilterStage filter_stage_;
+  SlogSubscriber slog_subscriber_;
+};
+
+}  // namespace slog
+
+#endif
@@ -0,0 +1,180 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/sinks/binary_file_sink.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/codec/codec.h"
+#include "slog_cc/codec/segment.h"
+#include "slog_cc/context/context.h"
+#include "slog_cc/slog.h"
+
+namespace slog {
+
+class SlogBinaryFileSinkTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    char dir_template[] = "/tmp/slog_binary_file_sink_test.XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir_template));
+    options_.directory = dir_template;
+    options_.file_prefix = "test";
+    options_.max_segment_bytes = 16 << 10;
+    options_.write_size = 4 << 10;
+    options_.max_total_bytes = 64 << 10;
+  }
+
+  void TearDown() override {
+    for (const auto& path : SlogSegmentWriter(options_).listSegments()) {
+      unlink(path.c_str());
+    }
+    rmdir(options_.directory.c_str());
+  }
+
+  static std::string readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+
+  // Decodes all valid blocks of a segment and returns values of the "i" tag.
+  // Returns the status that stopped reading in `last_status`.
+  static std::vector<int64_t> readSegment(const std::string& data,
+                                          SlogBlockStatus* last_status) {
+    std::vector<int64_t> values;
+    SlogSegmentHeader header;
+    EXPECT_TRUE(parseSegmentHeader(data.data(), data.size(), &header));
+    const char* pos = data.data() + kSlogSegmentHeaderSize;
+    const char* end = data.data() + data.size();
+    SlogRecordDecoder decoder;
+    const char* payload = nullptr;
+    size_t payload_size = 0;
+    while ((*last_status = readBlock(&pos, end, &payload, &payload_size)) ==
+           SlogBlockStatus::kOk) {
+      SlogDecodedBatch batch;
+      size_t consumed = 0;
+      EXPECT_TRUE(
+          decoder.decodeBatch(payload, payload_size, &batch, &consumed));
+      EXPECT_EQ(payload_size, consumed);
+      for (const auto& record : batch.records) {
+        const SlogTagView* tag = record.find_tag("i");
+        if (tag != nullptr) {
+          values.push_back(tag->valueInt());
+          EXPECT_NE(nullptr, decoder.callSite(record.call_site_id()));
+        }
+      }
+    }
+    return values;
+  }
+
+ protected:
+  SlogBinaryFileSinkOptions options_;
+};
+
+TEST_F(SlogBinaryFileSinkTest, rotation_and_disk_budget) {
+  constexpr int kNumRecords = 20000;
+  {
+    SlogBinaryFileSink sink(options_, SlogContext::getInstance());
+    for (int i = 0; i < kNumRecords; ++i) {
+      SLOG(INFO).addTag("i", i).addTag("payload", "0123456789");
+      if (i % 1000 == 0) {
+        SlogContext::getInstance()->waitAsyncSubscribers();
+      }
+    }
+    sink.flush();
+  }
+
+  const auto segments = SlogSegmentWriter(options_).listSegments();
+  ASSERT_GT(segments.size(), 1);
+  size_t total_size = 0;
+  for (const auto& path : segments) {
+    total_size += readFile(path).size();
+  }
+  EXPECT_LE(total_size, options_.max_total_bytes);
+
+  // Oldest records were deleted, the rest are consecutive and complete.
+  std::vector<int64_t> values;
+  for (const auto& path : segments) {
+    SlogBlockStatus status;
+    const auto segment_values = readSegment(readFile(path), &status);
+    EXPECT_EQ(SlogBlockStatus::kEnd, status);
+    values.insert(values.end(), segment_values.begin(), segment_values.end());
+  }
+  ASSERT_FALSE(values.empty());
+  EXPECT_GT(values.front(), 0);
+  EXPECT_EQ(kNumRecords - 1, values.back());
+  for (size_t i = 1; i < values.size(); ++i) {
+    ASSERT_EQ(values[i - 1] + 1, values[i]);
+  }
+}
+
+TEST_F(SlogBinaryFileSinkTest, aligned_writes) {
+  options_.max_segment_bytes = 1 << 20;
+  SlogBinaryFileSink sink(options_, SlogContext::getInstance());
+  for (int i = 0; i < 10; ++i) {
+    SLOG(INFO).addTag("i", i);
+    sink.flush();
+    // Flushed data is padded, so the next write starts aligned too.
+    const auto segments = sink.listSegments();
+    ASSERT_EQ(1, segments.size());
+    const std::string data = readFile(segments[0]);
+    EXPECT_EQ(0, data.size() % kSlogFileWriteAlignment);
+    SlogBlockStatus status;
+    EXPECT_EQ(i + 1, readSegment(data, &status).size());
+    EXPECT_EQ(SlogBlockStatus::kEnd, status);
+  }
+}
+
+TEST_F(SlogBinaryFileSinkTest, truncated_segment) {
+  options_.max_segment_bytes = 1 << 20;
+  options_.flush_interval = std::chrono::milliseconds(60000);
+  {
+    SlogBinaryFileSink sink(options_, SlogContext::getInstance());
+    for (int i = 0; i < 9; ++i) {
+      SLOG(INFO).addTag("i", i);
+      sink.flush();
+    }
+    // The last block isn't padded, the segment ends with it.
+    SLOG(INFO).addTag("i", 9);
+    SlogContext::getInstance()->waitAsyncSubscribers();
+  }
+  const auto segments = SlogSegmentWriter(options_).listSegments();
+  ASSERT_EQ(1, segments.size());
+  const std::string data = readFile(segments[0]);
+
+  SlogBlockStatus status;
+  EXPECT_EQ(10, readSegment(data, &status).size());
+  EXPECT_EQ(SlogBlockStatus::kEnd, status);
+
+  // A torn write loses only the last block.
+  EXPECT_EQ(9, readSegment(data.substr(0, data.size() - 3), &status).size());
+  EXPECT_EQ(SlogBlockStatus::kTruncated, status);
+
+  // A flipped bit is detected by the checksum.
+  std::string corrupted = data;
+  corrupted[corrupted.size() - 2] ^= 1;
+  EXPECT_EQ(9, readSegment(corrupted, &status).size());
+  EXPECT_EQ(SlogBlockStatus::kCorrupted, status);
+}
+
+}  // namespace slog
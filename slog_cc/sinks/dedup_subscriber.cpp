@@ -0,0 +1,176 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/sinks/dedup_subscriber.h"
+
+#include <cstring>
+#include <string>
+
+#include "slog_cc/context/context.h"
+
+namespace slog {
+
+namespace {
+
+SLOG_INLINE uint64_t mix(uint64_t hash, uint64_t value) {
+  hash ^= value;
+  hash *= 0x9e3779b97f4a7c15ULL;
+  return hash ^ (hash >> 32);
+}
+
+// Hashes 8 bytes at a time, strings of tags are mostly short.
+uint64_t mixString(uint64_t hash, const std::string& s) {
+  const char* data = s.data();
+  size_t size = s.size();
+  for (; size >= 8; data += 8, size -= 8) {
+    uint64_t word;
+    std::memcpy(&word, data, 8);
+    hash = mix(hash, word);
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, data, size);
+  return mix(hash, tail ^ (static_cast<uint64_t>(s.size()) << 56));
+}
+
+bool sameContent(const SlogRecord& a, const SlogRecord& b) {
+  if (a.call_site_id() != b.call_site_id() || a.severity() != b.severity() ||
+      a.tags().size() != b.tags().size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.tags().size(); ++i) {
+    const SlogTag& x = a.tags()[i];
+    const SlogTag& y = b.tags()[i];
+    if (x.valueType() != y.valueType() || x.verbosity() != y.verbosity() ||
+        x.valueNumericData() != y.valueNumericData() || x.key() != y.key() ||
+        x.valueString() != y.valueString()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+SlogDedupFilter::SlogDedupFilter(const SlogDedupOptions& options)
+    : options_(options) {}
+
+uint64_t SlogDedupFilter::hash(const SlogRecord& record) {
+  uint64_t hash = mix(static_cast<uint32_t>(record.call_site_id()),
+                      static_cast<uint64_t>(record.severity()) << 32);
+  for (const SlogTag& tag : record.tags()) {
+    hash = mixString(hash, tag.key());
+    hash = mix(hash, tag.valueNumericData() ^
+                         (static_cast<uint64_t>(tag.valueType()) << 60));
+    if (tag.valueType() == SlogTagValueType::kString) {
+      hash = mixString(hash, tag.valueString());
+    }
+  }
+  return hash;
+}
+
+void SlogDedupFilter::emitRepeats(Entry* entry, std::vector<SlogRecord>* out) {
+  if (entry->num_repeats == 0) {
+    return;
+  }
+  out->push_back(entry->record);
+  SlogRecord& record = out->back();
+  record.set_time(entry->last_repeat_time);
+  record.addTag(kSlogTagKeyRepeatCount, entry->num_repeats,
+                SlogTagVerbosity::kSilent);
+  record.addTag(kSlogTagKeyRepeatFirstNs, entry->first_repeat_ns,
+                SlogTagVerbosity::kSilent);
+  record.addTag(kSlogTagKeyRepeatLastNs, entry->last_repeat_ns,
+                SlogTagVerbosity::kSilent);
+}
+
+void SlogDedupFilter::expire(int64_t now_ns, std::vector<SlogRecord>* out) {
+  while (!expiry_order_.empty()) {
+    auto it = entries_.find(expiry_order_.front());
+    if (it->second.window_end_ns > now_ns) {
+      break;
+    }
+    emitRepeats(&it->second, out);
+    entries_.erase(it);
+    expiry_order_.pop_front();
+  }
+}
+
+void SlogDedupFilter::process(const std::vector<SlogRecord>& records,
+                              int64_t now_ns, std::vector<SlogRecord>* out) {
+  expire(now_ns, out);
+  for (const SlogRecord& record : records) {
+    const uint64_t record_hash = hash(record);
+    auto it = entries_.find(record_hash);
+    if (it != entries_.end() && sameContent(it->second.record, record)) {
+      Entry& entry = it->second;
+      if (entry.num_repeats == 0) {
+        entry.first_repeat_ns = record.time().global_ns;
+      }
+      ++entry.num_repeats;
+      entry.last_repeat_ns = record.time().global_ns;
+      entry.last_repeat_time = record.time();
+      continue;
+    }
+    // A hash collision with a different record is passed on without tracking.
+    if (it == entries_.end() && entries_.size() < options_.max_entries) {
+      entries_.emplace(
+          record_hash,
+          Entry(record, now_ns + options_.window.count() * 1000000));
+      expiry_order_.push_back(record_hash);
+    }
+    out->push_back(record);
+  }
+}
+
+void SlogDedupFilter::process(const std::vector<SlogRecord>& records,
+                              std::vector<SlogRecord>* out) {
+  process(records, nowNs(), out);
+}
+
+void SlogDedupFilter::flush(std::vector<SlogRecord>* out) {
+  for (const uint64_t record_hash : expiry_order_) {
+    emitRepeats(&entries_.at(record_hash), out);
+  }
+  entries_.clear();
+  expiry_order_.clear();
+}
+
+int64_t SlogDedupFilter::nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+SlogDedupSubscriber::SlogDedupSubscriber(
+    const SlogDedupOptions& options, std::shared_ptr<SlogContext> slog_context,
+    const SlogBatchCallback& downstream)
+    : filter_(options),
+      downstream_(downstream),
+      slog_subscriber_(slog_context->createAsyncBatchSubscriber(
+          [this](const std::vector<SlogRecord>& records) {
+            records_.clear();
+            filter_.process(records, &records_);
+            downstream_(records_);
+          })) {}
+
+SlogDedupSubscriber::~SlogDedupSubscriber() {
+  slog_subscriber_.reset();
+  records_.clear();
+  filter_.flush(&records_);
+  if (!records_.empty()) {
+    downstream_(records_);
+  }
+}
+
+}  // namespace slog
@@ -0,0 +1,128 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_sinks_dedup_subscriber
+#define slog_cc_sinks_dedup_subscriber
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "slog_cc/context/subscribers.h"
+#include "slog_cc/primitives/record.h"
+
+namespace slog {
+
+class SlogContext;
+
+// Tags of a record standing for repeats of an identical record.
+constexpr char kSlogTagKeyRepeatCount[] = ".repeat_count";
+constexpr char kSlogTagKeyRepeatFirstNs[] = ".repeat_first_ns";
+constexpr char kSlogTagKeyRepeatLastNs[] = ".repeat_last_ns";
+
+struct SlogDedupOptions {
+  // Repeats of a record within this window after its first occurrence are
+  // collapsed. The window is tumbling: it doesn't restart with each repeat,
+  // so a record repeating steadily is still reported once per window.
+  std::chrono::milliseconds window{1000};
+  // Distinct records tracked at once; more distinct records pass unchanged.
+  size_t max_entries = 4096;
+};
+
+// Collapses identical records: same call site, severity and tags (keys and
+// values), regardless of thread and time. The first occurrence passes right
+// away; repeats within the window are dropped and, when the window closes,
+// replaced by one copy of the record with kSlogTagKeyRepeatCount and global
+// times of the first and the last repeat. The copy has the time of the last
+// repeat, so it may follow newer records.
+//
+// Windows are tumbling rather than sliding, which bounds the delay of the
+// repeat count to one window and keeps one expiry per distinct record in
+// insertion order; a sliding window would hold back a record that keeps
+// repeating for as long as it does.
+//
+// Also a SlogBatchFilter, so sinks can run behind it, e.g.
+//   SlogBinaryFileSink sink(options, context,
+//                           std::unique_ptr<SlogBatchFilter>(
+//                               new SlogDedupFilter(SlogDedupOptions())));
+class SlogDedupFilter : public SlogBatchFilter {
+ public:
+  explicit SlogDedupFilter(const SlogDedupOptions& options);
+
+  // Appends records to pass on to `out`. `now_ns` is a monotonic time used for
+  // windows.
+  void process(const std::vector<SlogRecord>& records, int64_t now_ns,
+               std::vector<SlogRecord>* out);
+  // process() at the current steady clock time.
+  void process(const std::vector<SlogRecord>& records,
+               std::vector<SlogRecord>* out) override;
+  // Appends records for all repeats collapsed so far.
+  void flush(std::vector<SlogRecord>* out) override;
+
+  static uint64_t hash(const SlogRecord& record);
+
+ private:
+  struct Entry {
+    Entry(const SlogRecord& record, int64_t window_end_ns)
+        : record(record), window_end_ns(window_end_ns) {}
+
+    SlogRecord record;
+    int64_t window_end_ns;
+    int64_t num_repeats = 0;
+    int64_t first_repeat_ns = 0;
+    int64_t last_repeat_ns = 0;
+    SlogTimestamps last_repeat_time;
+  };
+
+  static int64_t nowNs();
+  // Closes windows ending at or before `now_ns`.
+  void expire(int64_t now_ns, std::vector<SlogRecord>* out);
+  void emitRepeats(Entry* entry, std::vector<SlogRecord>* out);
+
+  const SlogDedupOptions options_;
+  std::unordered_map<uint64_t, Entry> entries_;
+  // Hashes of entries_ in the order their windows end.
+  std::deque<uint64_t> expiry_order_;
+};
+
+// An async batch subscriber running SlogDedupFilter in front of an expensive
+// downstream callback, e.g. a SlogSegmentWriter. Sinks take the filter
+// directly instead:
+//   SlogDedupSubscriber dedup(SlogDedupOptions(), context,
+//                             [&](const std::vector<SlogRecord>& records) {
+//                               writer.write(records, lookup, num_call_sites);
+//                             });
+// The downstream callback runs in the async queue thread, also with empty
+// batches when the queue is idle.
+class SlogDedupSubscriber {
+ public:
+  SlogDedupSubscriber(const SlogDedupOptions& options,
+                      std::shared_ptr<SlogContext> slog_context,
+                      const SlogBatchCallback& downstream);
+  // Passes pending repeats downstream.
+  ~SlogDedupSubscriber();
+
+ private:
+  SlogDedupFilter filter_;
+  SlogBatchCallback downstream_;
+  std::vector<SlogRecord> records_;
+  SlogSubscriber slog_subscriber_;
+};
+
+}  // namespace slog
+
+#endif
@@ -0,0 +1,123 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/sinks/dedup_subscriber.h"
+
+#include <mutex>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/context/context.h"
+#include "slog_cc/slog.h"
+
+namespace slog {
+
+namespace {
+
+constexpr int64_t kMs = 1000000;
+
+SlogRecord makeRecord(int32_t call_site_id, const std::string& message,
+                      int64_t value, int64_t global_ns) {
+  SlogRecord record(/*thread_id=*/static_cast<int32_t>(global_ns % 7),
+                    call_site_id, ERROR);
+  record.addTag("", message);
+  record.addTag("value", value);
+  SlogTimestamps time;
+  time.global_ns = global_ns;
+  record.set_time(time);
+  return record;
+}
+
+}  // namespace
+
+TEST(SlogDedupFilterTest, collapse_repeats) {
+  SlogDedupOptions options;
+  options.window = std::chrono::milliseconds(100);
+  SlogDedupFilter filter(options);
+
+  std::vector<SlogRecord> out;
+  filter.process(
+      {makeRecord(1, "failed", 5, 1000), makeRecord(1, "failed", 5, 1001),
+       makeRecord(1, "failed", 6, 1002), makeRecord(2, "failed", 5, 1003),
+       makeRecord(1, "failed", 5, 1004)},
+      /*now_ns=*/0, &out);
+  // Different values and call sites are different records.
+  ASSERT_EQ(3, out.size());
+  EXPECT_EQ(1000, out[0].time().global_ns);
+  EXPECT_EQ(1002, out[1].time().global_ns);
+  EXPECT_EQ(1003, out[2].time().global_ns);
+
+  out.clear();
+  filter.process({makeRecord(1, "failed", 5, 1005)}, 50 * kMs, &out);
+  EXPECT_TRUE(out.empty());
+
+  // The window closes, repeats come out as one record.
+  filter.process({}, 100 * kMs, &out);
+  ASSERT_EQ(1, out.size());
+  const SlogRecord& repeats = out[0];
+  EXPECT_EQ(1, repeats.call_site_id());
+  EXPECT_EQ(1005, repeats.time().global_ns);
+  EXPECT_EQ(3, repeats.find_tag(kSlogTagKeyRepeatCount)->valueInt());
+  EXPECT_EQ(1001, repeats.find_tag(kSlogTagKeyRepeatFirstNs)->valueInt());
+  EXPECT_EQ(1005, repeats.find_tag(kSlogTagKeyRepeatLastNs)->valueInt());
+  EXPECT_EQ("failed", repeats.tags()[0].valueString());
+
+  // A new window starts with the next occurrence.
+  out.clear();
+  filter.process({makeRecord(1, "failed", 5, 2000)}, 150 * kMs, &out);
+  ASSERT_EQ(1, out.size());
+  EXPECT_EQ(nullptr, out[0].find_tag(kSlogTagKeyRepeatCount));
+  filter.process({makeRecord(1, "failed", 5, 2001)}, 160 * kMs, &out);
+  out.clear();
+  filter.flush(&out);
+  ASSERT_EQ(1, out.size());
+  EXPECT_EQ(1, out[0].find_tag(kSlogTagKeyRepeatCount)->valueInt());
+}
+
+TEST(SlogDedupFilterTest, max_entries) {
+  SlogDedupOptions options;
+  options.max_entries = 2;
+  SlogDedupFilter filter(options);
+  std::vector<SlogRecord> out;
+  for (int i = 0; i < 2; ++i) {
+    filter.process({makeRecord(1, "a", 1, 0), makeRecord(1, "b", 1, 0),
+                    makeRecord(1, "c", 1, 0)},
+                   0, &out);
+  }
+  // "c" isn't tracked, so its repeat passes.
+  EXPECT_EQ(4, out.size());
+}
+
+TEST(SlogDedupSubscriberTest, downstream) {
+  std::mutex mutex;
+  std::vector<SlogRecord> records;
+  {
+    SlogDedupSubscriber dedup(
+        SlogDedupOptions(), SlogContext::getInstance(),
+        [&](const std::vector<SlogRecord>& batch) {
+          std::unique_lock<std::mutex> lock(mutex);
+          records.insert(records.end(), batch.begin(), batch.end());
+        });
+    for (int i = 0; i < 1000; ++i) {
+      SLOG(ERROR).addTag("error", "connection refused");
+    }
+    SlogContext::getInstance()->waitAsyncSubscribers();
+  }
+  ASSERT_EQ(2, records.size());
+  EXPECT_EQ(nullptr, records[0].find_tag(kSlogTagKeyRepeatCount));
+  EXPECT_EQ(999, records[1].find_tag(kSlogTagKeyRepeatCount)->valueInt());
+}
+
+}  // namespace slog
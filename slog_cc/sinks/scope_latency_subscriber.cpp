@@ -0,0 +1,189 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/sinks/scope_latency_subscriber.h"
+
+#include "slog_cc/context/context.h"
+#include "slog_cc/primitives/scope_entry.h"
+
+namespace slog {
+
+constexpr int32_t SlogScopeLatency::kAllThreads;
+constexpr size_t SlogScopeLatencyAggregator::kMaxOpenScopes;
+
+namespace {
+
+SlogScopeLatency toLatency(const std::string& name, int32_t thread_id,
+                           const util::LogLinearHistogram& histogram) {
+  return SlogScopeLatency{name,
+                          thread_id,
+                          histogram.count(),
+                          histogram.sum(),
+                          histogram.valueAtPercentile(50),
+                          histogram.valueAtPercentile(90),
+                          histogram.valueAtPercentile(99),
+                          histogram.valueAtPercentile(99.9),
+                          histogram.max()};
+}
+
+}  // namespace
+
+SlogScopeLatencyAggregator::SlogScopeLatencyAggregator(
+    const NameLookup& name_lookup)
+    : name_lookup_(name_lookup) {}
+
+void SlogScopeLatencyAggregator::process(
+    const std::vector<SlogRecord>& records) {
+  for (const SlogRecord& record : records) {
+    const SlogTag* id_tag = record.find_tag(kSlogTagKeyScopeId);
+    if (id_tag == nullptr) {
+      continue;
+    }
+    const SlogTag* name_id_tag = record.find_tag(kSlogTagKeyScopeNameId);
+    const SlogTag* duration_tag = record.find_tag(kSlogTagKeyScopeDuration);
+    const auto key = std::make_pair(record.thread_id(), id_tag->valueInt());
+    if (duration_tag != nullptr && name_id_tag != nullptr) {
+      // A close record on its own.
+      const int64_t duration_ns = duration_tag->valueInt();
+      (*scopeByNameId(name_id_tag->valueInt()))[record.thread_id()].record(
+          duration_ns > 0 ? duration_ns : 0);
+    } else if (record.find_tag(kSlogTagKeyScopeOpen) != nullptr) {
+      // Opens with a name ID are followed by closes with a duration.
+      const SlogTag* name_tag = record.find_tag(kSlogTagKeyScopeName);
+      if (name_id_tag == nullptr && name_tag != nullptr) {
+        if (open_scopes_.size() >= kMaxOpenScopes &&
+            open_scopes_.find(key) == open_scopes_.end()) {
+          evictOldestOpenScope();
+        }
+        open_scopes_[key] = OpenScope{&scopes_[name_tag->valueString()],
+                                      record.time().elapsed_ns};
+      }
+    } else if (record.find_tag(kSlogTagKeyScopeClose) != nullptr) {
+      const auto it = open_scopes_.find(key);
+      if (it != open_scopes_.end()) {
+        const int64_t duration_ns =
+            record.time().elapsed_ns - it->second.elapsed_ns;
+        (*it->second.scope)[record.thread_id()].record(
+            duration_ns > 0 ? duration_ns : 0);
+        open_scopes_.erase(it);
+      }
+    }
+  }
+}
+
+std::vector<SlogScopeLatency> SlogScopeLatencyAggregator::snapshot(
+    bool per_thread) const {
+  std::vector<SlogScopeLatency> latencies;
+  for (const auto& scope : scopes_) {
+    util::LogLinearHistogram merged;
+    for (const auto& thread : scope.second) {
+      merged.merge(thread.second);
+    }
+    if (merged.count() == 0) {
+      continue;
+    }
+    latencies.push_back(
+        toLatency(scope.first, SlogScopeLatency::kAllThreads, merged));
+    if (per_thread) {
+      for (const auto& thread : scope.second) {
+        if (thread.second.count() != 0) {
+          latencies.push_back(
+              toLatency(scope.first, thread.first, thread.second));
+        }
+      }
+    }
+  }
+  return latencies;
+}
+
+void SlogScopeLatencyAggregator::reset() {
+  for (auto& scope : scopes_) {
+    for (auto it = scope.second.begin(); it != scope.second.end();) {
+      if (it->second.count() == 0) {
+        it = scope.second.erase(it);
+      } else {
+        it->second.reset();
+        ++it;
+      }
+    }
+  }
+}
+
+size_t SlogScopeLatencyAggregator::numHistograms() const {
+  size_t num_histograms = 0;
+  for (const auto& scope : scopes_) {
+    num_histograms += scope.second.size();
+  }
+  return num_histograms;
+}
+
+void SlogScopeLatencyAggregator::evictOldestOpenScope() {
+  // Only reached when closes keep getting lost, a scan is cheap enough.
+  auto oldest = open_scopes_.begin();
+  for (auto it = open_scopes_.begin(); it != open_scopes_.end(); ++it) {
+    if (it->second.elapsed_ns < oldest->second.elapsed_ns) {
+      oldest = it;
+    }
+  }
+  open_scopes_.erase(oldest);
+}
+
+SlogScopeLatencyAggregator::Scope* SlogScopeLatencyAggregator::scopeByNameId(
+    int32_t name_id) {
+  if (name_id < 0) {
+    return &scopes_[std::string()];
+  }
+  if (scopes_by_name_id_.size() <= static_cast<size_t>(name_id)) {
+    scopes_by_name_id_.resize(name_id + 1, nullptr);
+  }
+  Scope*& scope = scopes_by_name_id_[name_id];
+  if (scope == nullptr) {
+    scope = &scopes_[name_lookup_(name_id)];
+  }
+  return scope;
+}
+
+SlogScopeLatencySubscriber::SlogScopeLatencySubscriber(
+    std::shared_ptr<SlogContext> context)
+    : aggregator_([context](int32_t name_id) {
+        return context->scopeName(name_id);
+      }),
+      slog_subscriber_(context->createAsyncBatchSubscriber(
+          [this](const std::vector<SlogRecord>& records) {
+            if (records.empty()) {
+              return;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            aggregator_.process(records);
+          })) {}
+
+SlogScopeLatencySubscriber::~SlogScopeLatencySubscriber() {
+  slog_subscriber_.reset();
+}
+
+std::vector<SlogScopeLatency> SlogScopeLatencySubscriber::snapshot(
+    bool per_thread) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return aggregator_.snapshot(per_thread);
+}
+
+std::vector<SlogScopeLatency> SlogScopeLatencySubscriber::snapshotAndReset(
+    bool per_thread) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<SlogScopeLatency> latencies = aggregator_.snapshot(per_thread);
+  aggregator_.reset();
+  return latencies;
+}
+
+}  // namespace slog
@@ -0,0 +1,129 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_sinks_scope_latency_subscriber
+#define slog_cc_sinks_scope_latency_subscriber
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "slog_cc/context/subscribers.h"
+#include "slog_cc/primitives/record.h"
+#include "slog_cc/util/histogram.h"
+
+namespace slog {
+
+class SlogContext;
+
+// Latency of a scope name over the records aggregated since the last reset.
+struct SlogScopeLatency {
+  // thread_id of latencies merged across threads.
+  static constexpr int32_t kAllThreads = -1;
+
+  std::string name;
+  int32_t thread_id;
+  uint64_t count;
+  uint64_t sum_ns;
+  // Percentiles are within 12.5% of the exact ones, see
+  // util::LogLinearHistogram.
+  uint64_t p50_ns;
+  uint64_t p90_ns;
+  uint64_t p99_ns;
+  uint64_t p999_ns;
+  uint64_t max_ns;
+};
+
+// Aggregates durations of scope records into a log-linear histogram per scope
+// name and thread, other records are skipped. Close records with
+// kSlogTagKeyScopeDuration are taken alone, named by their name ID. Records
+// without it, e.g. of older logs, are paired by thread and scope ID; only
+// such open records are kept until their close, at most kMaxOpenScopes of
+// them. So the memory is constant per scope name and thread, and histograms
+// of threads without records between two resets are dropped.
+class SlogScopeLatencyAggregator {
+ public:
+  // Names scopes by name ID, e.g. SlogContext::scopeName().
+  using NameLookup = std::function<std::string(int32_t name_id)>;
+
+  // Beyond this many open records waiting for their close the oldest one is
+  // dropped, e.g. of a thread that exited or a close that was lost.
+  static constexpr size_t kMaxOpenScopes = 4096;
+
+  explicit SlogScopeLatencyAggregator(const NameLookup& name_lookup);
+
+  void process(const std::vector<SlogRecord>& records);
+  // Latencies of every scope name merged across threads, each followed by
+  // the latencies per thread if `per_thread`. Sorted by name and thread ID.
+  std::vector<SlogScopeLatency> snapshot(bool per_thread) const;
+  // Empties the histograms, keeping scopes open meanwhile to pair. Drops the
+  // histograms that were already empty.
+  void reset();
+
+  // Per-thread histograms held, about 4 KB each.
+  size_t numHistograms() const;
+  size_t numOpenScopes() const { return open_scopes_.size(); }
+
+ private:
+  // Histograms by thread ID.
+  using Scope = std::map<int32_t, util::LogLinearHistogram>;
+
+  struct OpenScope {
+    Scope* scope;
+    int64_t elapsed_ns;
+  };
+
+  Scope* scopeByNameId(int32_t name_id);
+  void evictOldestOpenScope();
+
+  const NameLookup name_lookup_;
+  std::map<std::string, Scope> scopes_;
+  // Indexed by name ID, nullptr if not looked up yet.
+  std::vector<Scope*> scopes_by_name_id_;
+  // Open records without name ID by thread and scope ID.
+  std::map<std::pair<int32_t, int64_t>, OpenScope> open_scopes_;
+};
+
+// An async batch subscriber aggregating scope latencies of a context, e.g. to
+// report percentiles periodically:
+//   SlogScopeLatencySubscriber latencies(context);
+//   ...
+//   for (const auto& latency : latencies.snapshotAndReset()) {
+//     std::cout << latency.name << " p99 " << latency.p99_ns << "\n";
+//   }
+class SlogScopeLatencySubscriber {
+ public:
+  explicit SlogScopeLatencySubscriber(std::shared_ptr<SlogContext> context);
+  ~SlogScopeLatencySubscriber();
+
+  // See SlogScopeLatencyAggregator::snapshot(). Records still in the async
+  // queue are not counted, see SlogContext::waitAsyncSubscribers().
+  std::vector<SlogScopeLatency> snapshot(bool per_thread = false);
+  // Snapshot of the latencies since the previous reset, then a reset.
+  std::vector<SlogScopeLatency> snapshotAndReset(bool per_thread = false);
+
+ private:
+  std::mutex mutex_;
+  SlogScopeLatencyAggregator aggregator_;
+  SlogSubscriber slog_subscriber_;
+};
+
+}  // namespace slog
+
+#endif
@@ -0,0 +1,170 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/sinks/scope_latency_subscriber.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/context/context.h"
+#include "slog_cc/slog.h"
+
+namespace slog {
+
+namespace {
+
+SlogRecord makeScopeRecord(int32_t thread_id, int64_t scope_id,
+                           int64_t elapsed_ns) {
+  SlogRecord record(thread_id, /*call_site_id=*/0, INFO);
+  record.addTag(kSlogTagKeyScopeId, scope_id);
+  SlogTimestamps time;
+  time.elapsed_ns = elapsed_ns;
+  record.set_time(time);
+  return record;
+}
+
+SlogRecord makeOpen(int32_t thread_id, int64_t scope_id,
+                    const std::string& name, int64_t elapsed_ns) {
+  SlogRecord record = makeScopeRecord(thread_id, scope_id, elapsed_ns);
+  record.addTag(kSlogTagKeyScopeOpen);
+  record.addTag(kSlogTagKeyScopeName, name);
+  return record;
+}
+
+SlogRecord makeClose(int32_t thread_id, int64_t scope_id, int64_t elapsed_ns) {
+  SlogRecord record = makeScopeRecord(thread_id, scope_id, elapsed_ns);
+  record.addTag(kSlogTagKeyScopeClose);
+  return record;
+}
+
+SlogRecord makeCloseWithDuration(int32_t thread_id, int64_t scope_id,
+                                 int32_t name_id, int64_t duration_ns) {
+  SlogRecord record = makeClose(thread_id, scope_id, 0);
+  record.addTag(kSlogTagKeyScopeNameId, name_id);
+  record.addTag(kSlogTagKeyScopeDuration, duration_ns);
+  return record;
+}
+
+}  // namespace
+
+TEST(SlogScopeLatencyAggregatorTest, pairs_and_durations) {
+  int num_lookups = 0;
+  SlogScopeLatencyAggregator aggregator([&](int32_t name_id) {
+    ++num_lookups;
+    return "scope_" + std::to_string(name_id);
+  });
+  std::vector<SlogRecord> records;
+  // Older records paired by thread and scope ID, a close without an open is
+  // skipped.
+  records.push_back(makeOpen(1, 1, "a", 1000));
+  records.push_back(makeOpen(2, 1, "a", 1000));
+  records.push_back(makeClose(2, 1, 1500));
+  records.push_back(makeClose(1, 1, 3000));
+  records.push_back(makeClose(1, 7, 3000));
+  for (int i = 1; i <= 100; ++i) {
+    records.push_back(makeCloseWithDuration(3, i, 5, i * 1000));
+  }
+  SlogRecord log(3, 1, INFO);
+  log.addTag("", "not a scope");
+  records.push_back(log);
+  aggregator.process(records);
+  EXPECT_EQ(1, num_lookups);
+
+  const std::vector<SlogScopeLatency> latencies = aggregator.snapshot(true);
+  ASSERT_EQ(5, latencies.size());
+  EXPECT_EQ("a", latencies[0].name);
+  EXPECT_EQ(SlogScopeLatency::kAllThreads, latencies[0].thread_id);
+  EXPECT_EQ(2, latencies[0].count);
+  EXPECT_EQ(2500, latencies[0].sum_ns);
+  EXPECT_EQ(2000, latencies[0].max_ns);
+  EXPECT_EQ(500, latencies[0].p50_ns);
+  EXPECT_EQ(1, latencies[1].thread_id);
+  EXPECT_EQ(2000, latencies[1].max_ns);
+  EXPECT_EQ(2, latencies[2].thread_id);
+  EXPECT_EQ(500, latencies[2].max_ns);
+
+  const SlogScopeLatency& b = latencies[3];
+  EXPECT_EQ("scope_5", b.name);
+  EXPECT_EQ(100, b.count);
+  EXPECT_EQ(100000, b.max_ns);
+  EXPECT_GE(b.p50_ns, 50000);
+  EXPECT_LE(b.p50_ns, 50000 * 1.125);
+  EXPECT_GE(b.p99_ns, 99000);
+  EXPECT_LE(b.p99_ns, b.p999_ns);
+  EXPECT_LE(b.p999_ns, b.max_ns);
+  EXPECT_EQ(3, latencies[4].thread_id);
+
+  // A reset keeps opens to pair.
+  aggregator.process({makeOpen(1, 2, "a", 5000)});
+  aggregator.reset();
+  EXPECT_TRUE(aggregator.snapshot(true).empty());
+  aggregator.process({makeClose(1, 2, 5100)});
+  ASSERT_EQ(1, aggregator.snapshot(false).size());
+  EXPECT_EQ(100, aggregator.snapshot(false)[0].max_ns);
+}
+
+TEST(SlogScopeLatencyAggregatorTest, bounded_memory) {
+  SlogScopeLatencyAggregator aggregator(
+      [](int32_t name_id) { return "scope_" + std::to_string(name_id); });
+  // Histograms of threads without records since the last reset are dropped.
+  for (int32_t thread_id = 0; thread_id < 10; ++thread_id) {
+    aggregator.process({makeCloseWithDuration(thread_id, 1, 0, 1000)});
+  }
+  EXPECT_EQ(10, aggregator.numHistograms());
+  aggregator.reset();
+  EXPECT_EQ(10, aggregator.numHistograms());
+  aggregator.process({makeCloseWithDuration(3, 2, 0, 1000)});
+  aggregator.reset();
+  EXPECT_EQ(1, aggregator.numHistograms());
+  aggregator.reset();
+  EXPECT_EQ(0, aggregator.numHistograms());
+
+  // Opens never closed don't accumulate, the oldest ones are dropped.
+  const int64_t num_opens = SlogScopeLatencyAggregator::kMaxOpenScopes + 10;
+  for (int64_t i = 0; i < num_opens; ++i) {
+    aggregator.process({makeOpen(1, i, "a", i * 1000)});
+  }
+  EXPECT_EQ(SlogScopeLatencyAggregator::kMaxOpenScopes,
+            aggregator.numOpenScopes());
+  aggregator.process({makeClose(1, 0, num_opens * 1000),
+                      makeClose(1, num_opens - 1, num_opens * 1000)});
+  const std::vector<SlogScopeLatency> latencies = aggregator.snapshot(false);
+  ASSERT_EQ(1, latencies.size());
+  EXPECT_EQ(1, latencies[0].count);
+  EXPECT_EQ(1000, latencies[0].max_ns);
+}
+
+TEST(SlogScopeLatencySubscriberTest, scopes) {
+  auto context = SlogContext::getInstance();
+  SlogScopeLatencySubscriber latencies(context);
+  for (int i = 0; i < 10; ++i) {
+    SLOG_SCOPE("latency_scope");
+    SLOG_FAST_SCOPE("latency_fast_scope");
+  }
+  SLOG(INFO) << "not a scope";
+  context->waitAsyncSubscribers();
+
+  const std::vector<SlogScopeLatency> snapshot = latencies.snapshotAndReset();
+  ASSERT_EQ(2, snapshot.size());
+  EXPECT_EQ("latency_fast_scope", snapshot[0].name);
+  EXPECT_EQ(10, snapshot[0].count);
+  EXPECT_EQ("latency_scope", snapshot[1].name);
+  EXPECT_EQ(10, snapshot[1].count);
+  EXPECT_LE(snapshot[1].p50_ns, snapshot[1].max_ns);
+  EXPECT_TRUE(latencies.snapshot().empty());
+}
+
+}  // namespace slog
@@ -0,0 +1,190 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/sinks/socket_sink.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "slog_cc/codec/segment.h"
+#include "slog_cc/context/context.h"
+
+namespace slog {
+
+namespace {
+
+// Blocks passed to one sendmsg() call.
+constexpr size_t kMaxIov = 64;
+
+int64_t unixNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+SlogSocketSink::SlogSocketSink(const SlogSocketSinkOptions& options,
+                               std::shared_ptr<SlogContext> slog_context,
+                               std::unique_ptr<SlogBatchFilter> filter)
+    : options_(options),
+      slog_context_(slog_context),
+      filter_stage_(std::move(filter)),
+      slog_subscriber_(slog_context_->createAsyncBatchSubscriber(
+          [this](const std::vector<SlogRecord>& records) {
+            publish(filter_stage_.process(records));
+          })) {}
+
+SlogSocketSink::~SlogSocketSink() {
+  // Stop receiving records before the socket is closed.
+  slog_subscriber_.reset();
+  const std::vector<SlogRecord>& held_back = filter_stage_.flush();
+  if (!held_back.empty() && fd_ >= 0) {
+    publish(held_back);
+  }
+  if (fd_ >= 0) {
+    send();
+    disconnect();
+  }
+}
+
+bool SlogSocketSink::connect() {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (options_.socket_path.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+  std::memcpy(address.sun_path, options_.socket_path.data(),
+              options_.socket_path.size());
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return false;
+  }
+  if (::connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    close(fd);
+    return false;
+  }
+  fd_ = fd;
+  connected_ = true;
+
+  // Each connection is a new stream with its own dictionary.
+  const SlogCallSiteLookup lookup = [this](int32_t call_site_id) {
+    return slog_context_->getCallSite(call_site_id);
+  };
+  Block block;
+  SlogSegmentHeader header;
+  header.created_unix_ns = unixNowNs();
+  appendSegmentHeader(header, &block.data);
+  encoder_.reset();
+  scratch_.clear();
+  encoder_.encodeDictionary(
+      static_cast<int32_t>(slog_context_->numCallSites()), lookup, &scratch_);
+  appendBlock(scratch_.data(), scratch_.size(), &block.data);
+  pending_bytes_ = block.data.size();
+  pending_.emplace_back(std::move(block));
+  return true;
+}
+
+void SlogSocketSink::disconnect() {
+  close(fd_);
+  fd_ = -1;
+  connected_ = false;
+  for (const Block& block : pending_) {
+    num_dropped_records_ += block.num_records;
+  }
+  pending_.clear();
+  front_offset_ = 0;
+  pending_bytes_ = 0;
+}
+
+void SlogSocketSink::send() {
+  iovec iov[kMaxIov];
+  while (!pending_.empty()) {
+    size_t num_iov = 0;
+    for (auto it = pending_.begin(); it != pending_.end() && num_iov < kMaxIov;
+         ++it, ++num_iov) {
+      const size_t offset = num_iov == 0 ? front_offset_ : 0;
+      iov[num_iov].iov_base = const_cast<char*>(it->data.data() + offset);
+      iov[num_iov].iov_len = it->data.size() - offset;
+    }
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = num_iov;
+    // Like writev(), but a closed reader must not raise SIGPIPE.
+    const ssize_t sent = sendmsg(fd_, &message, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        disconnect();
+      }
+      return;
+    }
+    size_t remaining = static_cast<size_t>(sent);
+    pending_bytes_ -= remaining;
+    while (remaining > 0) {
+      const size_t front_size = pending_.front().data.size() - front_offset_;
+      if (remaining < front_size) {
+        front_offset_ += remaining;
+        return;
+      }
+      remaining -= front_size;
+      num_sent_records_ += pending_.front().num_records;
+      pending_.pop_front();
+      front_offset_ = 0;
+    }
+  }
+}
+
+void SlogSocketSink::publish(const std::vector<SlogRecord>& records) {
+  if (fd_ < 0) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_connect_time_ >= options_.reconnect_interval) {
+      last_connect_time_ = now;
+      connect();
+    }
+  }
+  if (fd_ < 0) {
+    num_dropped_records_ += records.size();
+    return;
+  }
+  if (!records.empty()) {
+    if (pending_bytes_ >= options_.max_pending_bytes) {
+      // Dropped before encoding, so the dictionary of the stream stays valid.
+      num_dropped_records_ += records.size();
+    } else {
+      scratch_.clear();
+      encoder_.encodeBatch(
+          records,
+          [this](int32_t call_site_id) {
+            return slog_context_->getCallSite(call_site_id);
+          },
+          &scratch_);
+      Block block;
+      block.num_records = records.size();
+      appendBlock(scratch_.data(), scratch_.size(), &block.data);
+      pending_bytes_ += block.data.size();
+      pending_.emplace_back(std::move(block));
+    }
+  }
+  send();
+}
+
+}  // namespace slog
@@ -0,0 +1,103 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_sinks_socket_sink
+#define slog_cc_sinks_socket_sink
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "slog_cc/codec/codec.h"
+#include "slog_cc/context/subscribers.h"
+#include "slog_cc/primitives/record.h"
+
+namespace slog {
+
+class SlogContext;
+
+struct SlogSocketSinkOptions {
+  // Unix domain socket a reader listens on, e.g. slog_stream.
+  std::string socket_path = "/tmp/slog.sock";
+  // Encoded data waiting for a slow reader is bounded by this size, new
+  // records are dropped when it is reached.
+  size_t max_pending_bytes = 4 << 20;
+  // How often to try connecting while there is no reader.
+  std::chrono::milliseconds reconnect_interval{1000};
+};
+
+// An async batch subscriber streaming records of a SlogContext to a Unix domain
+// socket. The stream has the layout of a segment file (see codec/segment.h):
+// a segment header, a dictionary block with all known call sites, then one
+// block per batch carrying new call sites and tag keys incrementally. Every
+// connection starts a new stream, so a reader can save it as a segment.
+//
+// The socket is non-blocking. Pending blocks are sent with one scatter write
+// per batch; records are dropped and counted rather than blocking the context
+// when the reader is slow or absent.
+//
+// An optional `filter` runs in front of the socket, see SlogBatchFilterStage.
+class SlogSocketSink {
+ public:
+  SlogSocketSink(const SlogSocketSinkOptions& options,
+                 std::shared_ptr<SlogContext> slog_context,
+                 std::unique_ptr<SlogBatchFilter> filter = nullptr);
+  ~SlogSocketSink();
+
+  // True while a reader is connected.
+  bool connected() const { return connected_; }
+  uint64_t numSentRecords() const { return num_sent_records_; }
+  // Records emitted while no reader was connected, lost with a broken
+  // connection or dropped because the pending data limit was reached.
+  uint64_t numDroppedRecords() const { return num_dropped_records_; }
+
+ private:
+  struct Block {
+    std::string data;
+    size_t num_records = 0;
+  };
+
+  void publish(const std::vector<SlogRecord>& records);
+  bool connect();
+  void disconnect();
+  // Sends as much pending data as the socket takes without blocking.
+  void send();
+
+  const SlogSocketSinkOptions options_;
+  std::shared_ptr<SlogContext> slog_context_;
+
+  // Accessed from the async subscriber thread only.
+  int fd_ = -1;
+  std::chrono::steady_clock::time_point last_connect_time_;
+  SlogRecordEncoder encoder_;
+  std::string scratch_;
+  std::deque<Block> pending_;
+  // Bytes of pending_.front() already sent.
+  size_t front_offset_ = 0;
+  size_t pending_bytes_ = 0;
+
+  std::atomic<bool> connected_{false};
+  std::atomic<uint64_t> num_sent_records_{0};
+  std::atomic<uint64_t> num_dropped_records_{0};
+  SlogBatchFilterStage filter_stage_;
+  SlogSubscriber slog_subscriber_;
+};
+
+}  // namespace slog
+
+#endif
@@ -0,0 +1,77 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/sinks/stderr_sink.h"
+
+#include <errno.h>
+
+#include "slog_cc/context/context.h"
+
+namespace slog {
+
+SlogStderrSink::SlogStderrSink(const SlogStderrSinkOptions& options,
+                               std::shared_ptr<SlogContext> slog_context,
+                               std::unique_ptr<SlogBatchFilter> filter)
+    : options_(options),
+      slog_context_(slog_context),
+      filter_stage_(std::move(filter)) {
+  buffer_.reserve(options_.write_size + 1024);
+  slog_subscriber_ = slog_context_->createAsyncBatchSubscriber(
+      [this](const std::vector<SlogRecord>& records) {
+        echo(filter_stage_.process(records));
+      });
+  slog_context_->addAsyncStderrEcho();
+}
+
+SlogStderrSink::~SlogStderrSink() {
+  // Records left to the sink are all queued once it is removed, later ones
+  // are echoed synchronously.
+  slog_context_->removeAsyncStderrEcho();
+  slog_context_->waitAsyncSubscribers();
+  slog_subscriber_.reset();
+  echo(filter_stage_.flush());
+}
+
+void SlogStderrSink::echo(const std::vector<SlogRecord>& records) {
+  for (const SlogRecord& record : records) {
+    if (!record.async_stderr_echo()) {
+      continue;
+    }
+    printer_.appendStderrLine(
+        record, slog_context_->getCallSite(record.call_site_id()), &buffer_);
+    buffer_.push_back('\n');
+    if (buffer_.size() >= options_.write_size) {
+      write();
+    }
+  }
+  write();
+}
+
+void SlogStderrSink::write() {
+  size_t offset = 0;
+  while (offset < buffer_.size()) {
+    const ssize_t written = ::write(options_.fd, buffer_.data() + offset,
+                                    buffer_.size() - offset);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      break;
+    }
+    offset += written;
+  }
+  buffer_.clear();
+}
+
+}  // namespace slog
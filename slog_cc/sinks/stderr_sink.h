@@ -0,0 +1,71 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_sinks_stderr_sink
+#define slog_cc_sinks_stderr_sink
+
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "slog_cc/context/subscribers.h"
+#include "slog_cc/primitives/record.h"
+#include "slog_cc/printer/printer.h"
+
+namespace slog {
+
+class SlogContext;
+
+struct SlogStderrSinkOptions {
+  // Where lines are written.
+  int fd = STDERR_FILENO;
+  // Lines of a batch are accumulated up to this size per write() call.
+  size_t write_size = 64 << 10;
+};
+
+// Moves the stderr echo of noisy records off the emitting threads. While the
+// sink exists the SlogContext doesn't echo records synchronously, except
+// FATAL ones; the sink formats lines in the async queue thread and writes all
+// lines of a batch with a few large write() calls.
+//
+// Lines already queued when a FATAL record aborts the process are lost, the
+// FATAL line itself is always printed. Other records are echoed exactly once,
+// also when emitted by another thread while the sink is created or destroyed.
+// Only one sink may exist at a time, a second one aborts.
+//
+// An optional `filter` runs in front of the echo, see SlogBatchFilterStage.
+class SlogStderrSink {
+ public:
+  SlogStderrSink(const SlogStderrSinkOptions& options,
+                 std::shared_ptr<SlogContext> slog_context,
+                 std::unique_ptr<SlogBatchFilter> filter = nullptr);
+  ~SlogStderrSink();
+
+ private:
+  void echo(const std::vector<SlogRecord>& records);
+  void write();
+
+  const SlogStderrSinkOptions options_;
+  std::shared_ptr<SlogContext> slog_context_;
+  const SlogPrinter printer_;
+  std::string buffer_;
+  SlogBatchFilterStage filter_stage_;
+  SlogSubscriber slog_subscriber_;
+};
+
+}  // namespace slog
+
+#endif
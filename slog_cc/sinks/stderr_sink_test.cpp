@@ -0,0 +1,162 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/sinks/stderr_sink.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/context/context.h"
+#include "slog_cc/sinks/dedup_subscriber.h"
+#include "slog_cc/slog.h"
+#include "slog_cc/util/string_util.h"
+
+namespace slog {
+
+namespace {
+
+std::string readAvailable(int fd) {
+  std::string data;
+  char buffer[4096];
+  ssize_t size;
+  while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+    data.append(buffer, size);
+  }
+  return data;
+}
+
+}  // namespace
+
+TEST(SlogStderrSinkTest, async_echo) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  SlogStderrSinkOptions options;
+  options.fd = fds[1];
+  options.write_size = 256;
+
+  testing::internal::CaptureStderr();
+  {
+    SlogStderrSink sink(options, SlogContext::getInstance());
+    for (int i = 0; i < 100; ++i) {
+      SLOG(INFO) << "line " << i;
+    }
+    SLOG(INFO).addTag("silent", 1);
+    SlogContext::getInstance()->waitAsyncSubscribers();
+  }
+  // Nothing is echoed synchronously while the sink exists.
+  EXPECT_EQ("", testing::internal::GetCapturedStderr());
+
+  const std::vector<std::string> lines =
+      util::split(readAvailable(fds[0]), '\n', /*remove_empty_tokens=*/true);
+  ASSERT_EQ(100, lines.size());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ('I', lines[i][0]);
+    EXPECT_NE(std::string::npos, lines[i].find("stderr_sink_test.cpp:"));
+    EXPECT_EQ("] line " + std::to_string(i),
+              lines[i].substr(lines[i].find("] ")));
+  }
+
+  // Sync echo is back once the sink is gone.
+  testing::internal::CaptureStderr();
+  SLOG(INFO) << "sync";
+  EXPECT_NE(std::string::npos,
+            testing::internal::GetCapturedStderr().find("] sync"));
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(SlogStderrSinkTest, dedup_filter) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  SlogStderrSinkOptions options;
+  options.fd = fds[1];
+
+  // Echoed synchronously and likely still queued when the sink subscribes,
+  // the sink doesn't echo it again.
+  SLOG(INFO) << "sync";
+  {
+    SlogStderrSink sink(options, SlogContext::getInstance(),
+                        std::unique_ptr<SlogBatchFilter>(
+                            new SlogDedupFilter(SlogDedupOptions())));
+    for (int i = 0; i < 100; ++i) {
+      SLOG(INFO) << "repeated";
+    }
+    SlogContext::getInstance()->waitAsyncSubscribers();
+  }
+  // The first occurrence, then the repeats held back by the filter.
+  const std::vector<std::string> lines =
+      util::split(readAvailable(fds[0]), '\n', /*remove_empty_tokens=*/true);
+  ASSERT_EQ(2, lines.size());
+  EXPECT_EQ("] repeated", lines[0].substr(lines[0].find("] ")));
+  EXPECT_EQ("] repeated", lines[1].substr(lines[1].find("] ")));
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(SlogStderrSinkTest, exactly_once) {
+  FILE* file = tmpfile();
+  ASSERT_NE(nullptr, file);
+  SlogStderrSinkOptions options;
+  options.fd = fileno(file);
+
+  testing::internal::CaptureStderr();
+  std::atomic<bool> done{false};
+  std::atomic<int> num_lines{0};
+  std::thread emitter([&] {
+    while (!done) {
+      SLOG(INFO) << "line " << num_lines++;
+    }
+  });
+  // Records emitted while sinks come and go are echoed either synchronously
+  // or by a sink.
+  for (int i = 0; i < 100 || num_lines < 10000; ++i) {
+    SlogStderrSink sink(options, SlogContext::getInstance());
+    std::this_thread::yield();
+  }
+  done = true;
+  emitter.join();
+  SlogContext::getInstance()->waitAsyncSubscribers();
+
+  std::string echoed = testing::internal::GetCapturedStderr();
+  lseek(options.fd, 0, SEEK_SET);
+  echoed += readAvailable(options.fd);
+  std::vector<int> counts(num_lines);
+  for (const auto& line : util::split(echoed, '\n', true)) {
+    const size_t pos = line.find("] line ");
+    ASSERT_NE(std::string::npos, pos) << line;
+    counts.at(std::stoi(line.substr(pos + 7))) += 1;
+  }
+  for (int i = 0; i < num_lines; ++i) {
+    EXPECT_EQ(1, counts[i]) << "line " << i;
+  }
+  fclose(file);
+}
+
+TEST(SlogStderrSinkTest, second_sink) {
+  SlogStderrSink sink(SlogStderrSinkOptions(), SlogContext::getInstance());
+  ASSERT_DEATH(
+      SlogStderrSink(SlogStderrSinkOptions(), SlogContext::getInstance()),
+      "Only one async stderr echo");
+}
+
+}  // namespace slog
@@ -17,6 +17,7 @@
 
 #include "slog_cc/context/context.h"
 #include "slog_cc/events/event.h"
+#include "slog_cc/events/sampler.h"
 #include "slog_cc/events/scope.h"
 
 #define SLOG(severity)                                                \
@@ -27,14 +28,98 @@
     return slog_call_site_id;                                         \
   }())
 
+// Sampled variants of SLOG(severity). The sampler lives in static storage of
+// the call site, like slog_call_site_id of SLOG. Suppressed events don't build
+// a record; their number is added to the next emitted record as a
+// kSlogTagKeySuppressedCount tag. Usage:
+//   SLOG_EVERY_N(INFO, 100) << "processed " << n << " frames";
+//   SLOG_FIRST_N(WARNING, 10) << "no calibration for " << camera;
+//   SLOG_EVERY_T(ERROR, 1.0) << "queue is full";
+//   SLOG_RATE_LIMITED(INFO, /*rate=*/10.0, /*burst=*/50) << "event";
+#define _SLOG_SAMPLER()                                                    \
+  [func = __FUNCTION__]() -> slog::SlogCallSiteSampler& {                  \
+    static slog::SlogCallSiteSampler slog_sampler(                         \
+        slog::SlogContext::getInstance()->addCallSite(func, __FILE__,      \
+                                                      __LINE__));          \
+    return slog_sampler;                                                   \
+  }()
+
+#define _SLOG_SAMPLED(severity, sample)                                    \
+  for (slog::SlogSample slog_sample = sample; slog_sample.emit;            \
+       slog_sample.emit = false)                                           \
+  slog::addSuppressedCount(                                                \
+      slog::SlogEvent(slog::severity, slog_sample.call_site_id),           \
+      slog_sample.num_suppressed)
+
+#define SLOG_EVERY_N(severity, n) \
+  _SLOG_SAMPLED(severity, _SLOG_SAMPLER().everyN(n))
+
+#define SLOG_FIRST_N(severity, n) \
+  _SLOG_SAMPLED(severity, _SLOG_SAMPLER().firstN(n))
+
+#define SLOG_EVERY_T(severity, period_sec) \
+  _SLOG_SAMPLED(severity, _SLOG_SAMPLER().everyT(period_sec))
+
+#define SLOG_RATE_LIMITED(severity, rate, burst) \
+  _SLOG_SAMPLED(severity, _SLOG_SAMPLER().tokenBucket(rate, burst))
+
 #define CONCAT(a, b) CONCAT_INNER(a, b)
 #define CONCAT_INNER(a, b) a##b
 
+// Name of a SLOG_SCOPE with its ID, taken once per call site for a literal
+// name. scope_name is evaluated once.
+#define _SLOG_SCOPE_NAME(scope_name)                                   \
+  [](auto&& name) -> slog::SlogScopeName {                             \
+    static slog::SlogScopeNameSite slog_scope_name_site;               \
+    return slog_scope_name_site.name(name);                            \
+  }(scope_name)
+
 // C++ standard 12.2.3 guarantees that the SlogEvent is not destroyed before
-// SlogScope's constructor finishes.
-#define SLOG_SCOPE(scope_name)              \
+// SlogScope's constructor finishes. Names other than literals are looked up
+// on every open and their IDs are never released, so they should come from a
+// small set, e.g. not include a frame number.
+#define SLOG_SCOPE(scope_name)                \
   slog::SlogScope CONCAT(scope, __LINE__) = \
-      SLOG(INFO).addTag(slog::kSlogTagKeyScopeName, scope_name)
+      slog::SlogScopeEvent(SLOG(INFO), _SLOG_SCOPE_NAME(scope_name))
+
+// SLOG_SCOPE checked against a latency budget, a std::chrono duration, e.g.
+//   SLOG_SCOPE_BUDGET("plan", std::chrono::milliseconds(5));
+// A scope over its budget emits a WARNING record after its close record, with
+// the overrun and the durations of its child scopes by name, see
+// kSlogTagKeyScopeOverrun. Scopes within budget cost a comparison more.
+#define SLOG_SCOPE_BUDGET(scope_name, budget)                            \
+  slog::SlogScopeBudget CONCAT(scope_budget, __LINE__)(budget);          \
+  slog::SlogScope CONCAT(scope, __LINE__)(                               \
+      slog::SlogScopeEvent(SLOG(INFO), _SLOG_SCOPE_NAME(scope_name)),    \
+      &CONCAT(scope_budget, __LINE__))
+
+// A scope with the records of SLOG_SCOPE for async subscribers at a fraction
+// of the cost: it pushes two compact entries into a lock-free thread-local
+// ring, drained by the async queue thread. Its records follow the records
+// queued by then, so they may come after later records of the thread; order
+// them by time if needed. The name is taken once per call site, so it must
+// not change, e.g. a string literal, and no tags can be added. Sync
+// subscribers don't see its records; scope subscribers
+// (SlogContext::createAsyncScopeSubscriber) get the entries as they are.
+#define SLOG_FAST_SCOPE(scope_name)                                    \
+  slog::SlogFastScope CONCAT(scope, __LINE__)(                         \
+      [func = __FUNCTION__]() -> const slog::SlogFastScopeSite& {      \
+        static const slog::SlogFastScopeSite slog_fast_scope_site(     \
+            func, __FILE__, __LINE__, scope_name);                     \
+        return slog_fast_scope_site;                                   \
+      }())
+
+// A scope that emits no records: its duration goes to a histogram of the
+// call site kept per thread, read with SlogContext::scopeStats().snapshot().
+// Costs two clock reads and a few adds, no queueing. The name is taken once
+// per call site, as of SLOG_FAST_SCOPE.
+#define SLOG_SCOPE_STATS(scope_name)                                   \
+  slog::SlogStatsScope CONCAT(scope, __LINE__)(                        \
+      [func = __FUNCTION__]() -> const slog::SlogStatsScopeSite& {     \
+        static const slog::SlogStatsScopeSite slog_stats_scope_site(   \
+            func, __FILE__, __LINE__, scope_name);                     \
+        return slog_stats_scope_site;                                  \
+      }())
 
 #define SLOG_FUNC_BLOCK_START(func_block_name) \
   SLOG(INFO).addTag(slog::kSlogTagKeyFuncBlockStart, func_block_name)
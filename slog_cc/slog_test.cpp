@@ -14,17 +14,34 @@
 
 #include "slog_cc/slog.h"
 
+#include <elf.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <future>
+#include <map>
+#include <thread>
 #include <vector>
 
 #include <gtest/gtest.h>
 
 #include "slog_cc/context/context.h"
+#include "slog_cc/events/scope_watchdog.h"
+#include "slog_cc/events/stats_reporter.h"
 #include "slog_cc/primitives/call_site.h"
+#include "slog_cc/util/os/alloc_counters.h"
 #include "slog_cc/util/string_util.h"
+#include "slog_cc/util/usdt.h"
 
 using slog::kSlogTagKeyScopeDepth;
+using slog::kSlogTagKeyScopeDuration;
 using slog::kSlogTagKeyScopeId;
+using slog::kSlogTagKeyScopeNameId;
+using slog::kSlogTagKeyScopeParentId;
 using slog::SlogCallSite;
 using slog::SlogContext;
 using slog::SlogPrinter;
@@ -427,6 +444,430 @@ TEST_F(SlogTest, scope) {
   ASSERT_ASCENDING(true, slog_records_);
 }
 
+TEST_F(SlogTest, scope_close) {
+  {
+    SLOG_SCOPE("scope_a");
+    for (int i = 0; i < 2; ++i) {
+      SLOG_SCOPE("scope_b");
+    }
+  }
+  waitSlog();
+  ASSERT_EQ(6, slog_records_.size());
+
+  const SlogRecord& open_a = slog_records_[0];
+  const SlogRecord& close_a = slog_records_[5];
+  const int64_t scope_a_id =
+      getTag(open_a.tags(), kSlogTagKeyScopeId).valueInt();
+  EXPECT_EQ(close_a.time().elapsed_ns - open_a.time().elapsed_ns,
+            getTag(close_a.tags(), kSlogTagKeyScopeDuration).valueInt());
+  EXPECT_EQ(0, getTag(close_a.tags(), kSlogTagKeyScopeParentId).valueInt());
+  EXPECT_EQ("scope_a",
+            SlogContext::getInstance()->scopeName(
+                getTag(close_a.tags(), kSlogTagKeyScopeNameId).valueInt()));
+
+  // Both scope_b share the name ID.
+  for (const int i : {2, 4}) {
+    const SlogRecord& open_b = slog_records_[i - 1];
+    const SlogRecord& close_b = slog_records_[i];
+    EXPECT_EQ(close_b.time().elapsed_ns - open_b.time().elapsed_ns,
+              getTag(close_b.tags(), kSlogTagKeyScopeDuration).valueInt());
+    EXPECT_EQ(scope_a_id,
+              getTag(close_b.tags(), kSlogTagKeyScopeParentId).valueInt());
+    EXPECT_EQ(getTag(open_b.tags(), kSlogTagKeyScopeNameId).valueInt(),
+              getTag(close_b.tags(), kSlogTagKeyScopeNameId).valueInt());
+    EXPECT_EQ("scope_b",
+              SlogContext::getInstance()->scopeName(
+                  getTag(close_b.tags(), kSlogTagKeyScopeNameId).valueInt()));
+  }
+}
+
+TEST_F(SlogTest, scope_dynamic_name) {
+  char buffer[16] = "buffer_0";
+  for (int i = 0; i < 2; ++i) {
+    buffer[7] = '0' + i;
+    SLOG_SCOPE(buffer);
+    SLOG_SCOPE(std::string("string_") + std::to_string(i));
+  }
+  waitSlog();
+  ASSERT_EQ(8, slog_records_.size());
+  std::vector<std::string> names;
+  for (const SlogRecord& record : slog_records_) {
+    if (record.find_tag(slog::kSlogTagKeyScopeOpen) != nullptr) {
+      const std::string name =
+          getTag(record.tags(), slog::kSlogTagKeyScopeName).valueString();
+      EXPECT_EQ(name, SlogContext::getInstance()->scopeName(
+                          getTag(record.tags(), kSlogTagKeyScopeNameId)
+                              .valueInt()));
+      names.push_back(name);
+    }
+  }
+  EXPECT_EQ((std::vector<std::string>{"buffer_0", "string_0", "buffer_1",
+                                      "string_1"}),
+            names);
+}
+
+TEST_F(SlogTest, scope_usage) {
+  SlogContext::getInstance()->setScopeUsageSampling(1);
+  {
+    SLOG_SCOPE("busy");
+    volatile int64_t sum = 0;
+    for (int i = 0; i < 1000000; ++i) {
+      sum = sum + i;
+    }
+  }
+  waitSlog();
+  ASSERT_EQ(2, slog_records_.size());
+  EXPECT_EQ(nullptr, slog_records_[0].find_tag(slog::kSlogTagKeyScopeCpuNs));
+  const SlogRecord& close = slog_records_[1];
+  ASSERT_NE(nullptr, close.find_tag(slog::kSlogTagKeyScopeCpuNs));
+  const int64_t cpu_ns =
+      close.find_tag(slog::kSlogTagKeyScopeCpuNs)->valueInt();
+  EXPECT_GT(cpu_ns, 0);
+  EXPECT_LE(cpu_ns, getTag(close.tags(), kSlogTagKeyScopeDuration).valueInt());
+  for (const char* key : {slog::kSlogTagKeyScopeVoluntarySwitches,
+                          slog::kSlogTagKeyScopeInvoluntarySwitches,
+                          slog::kSlogTagKeyScopeMinorFaults,
+                          slog::kSlogTagKeyScopeMajorFaults}) {
+    EXPECT_LE(0, getTag(close.tags(), key).valueInt()) << key;
+  }
+
+  // Every second scope is sampled.
+  slog_records_.clear();
+  SlogContext::getInstance()->setScopeUsageSampling(0.5);
+  for (int i = 0; i < 10; ++i) {
+    SLOG_SCOPE("sampled");
+  }
+  SlogContext::getInstance()->setScopeUsageSampling(0);
+  for (int i = 0; i < 10; ++i) {
+    SLOG_SCOPE("not_sampled");
+  }
+  waitSlog();
+  ASSERT_EQ(40, slog_records_.size());
+  EXPECT_EQ(5, std::count_if(slog_records_.begin(), slog_records_.end(),
+                             [](const SlogRecord& record) {
+                               return record.find_tag(
+                                          slog::kSlogTagKeyScopeCpuNs) !=
+                                      nullptr;
+                             }));
+}
+
+TEST_F(SlogTest, scope_perf) {
+  SlogContext::getInstance()->setScopePerfSampling(1);
+  {
+    SLOG_SCOPE("busy");
+    volatile int64_t sum = 0;
+    for (int i = 0; i < 1000000; ++i) {
+      sum = sum + i;
+    }
+  }
+  SlogContext::getInstance()->setScopePerfSampling(0);
+  waitSlog();
+  ASSERT_EQ(2, slog_records_.size());
+  const SlogRecord& close = slog_records_[1];
+  // Depends on the machine: containers may have no perf events and VMs no
+  // hardware counters.
+  switch (slog::util::os::thread_perf_counters()->kind()) {
+    case slog::util::os::ThreadPerfCounters::Kind::kHardware:
+      EXPECT_GT(getTag(close.tags(), slog::kSlogTagKeyScopeInstructions)
+                    .valueInt(),
+                1000000);
+      EXPECT_LE(0, getTag(close.tags(), slog::kSlogTagKeyScopeCacheMisses)
+                       .valueInt());
+      break;
+    case slog::util::os::ThreadPerfCounters::Kind::kSoftware:
+      EXPECT_GT(getTag(close.tags(), slog::kSlogTagKeyScopeTaskClockNs)
+                    .valueInt(),
+                0);
+      EXPECT_LE(0, getTag(close.tags(), slog::kSlogTagKeyScopePageFaults)
+                       .valueInt());
+      break;
+    case slog::util::os::ThreadPerfCounters::Kind::kNone:
+      EXPECT_EQ(nullptr, close.find_tag(slog::kSlogTagKeyScopeCycles));
+      EXPECT_EQ(nullptr, close.find_tag(slog::kSlogTagKeyScopeTaskClockNs));
+      break;
+  }
+}
+
+TEST_F(SlogTest, scope_allocs) {
+  // The test links //slog_cc/util/os:alloc_hooks.
+  ASSERT_TRUE(slog::util::os::alloc_hooks_installed());
+  SlogContext::getInstance()->setScopeAllocSampling(1);
+  {
+    SLOG_SCOPE("allocating");
+    for (int i = 0; i < 10; ++i) {
+      // volatile so that the pair isn't elided.
+      char* volatile chars = new char[1000];
+      delete[] chars;
+    }
+    void* ptr = malloc(100);
+    ptr = realloc(ptr, 10000);
+    free(ptr);
+  }
+  {
+    SLOG_SCOPE("not_allocating");
+  }
+  SlogContext::getInstance()->setScopeAllocSampling(0);
+  waitSlog();
+  ASSERT_EQ(4, slog_records_.size());
+  EXPECT_EQ(nullptr, slog_records_[0].find_tag(slog::kSlogTagKeyScopeAllocs));
+  const SlogRecord& close = slog_records_[1];
+  // The open record may allocate too.
+  const int64_t allocs =
+      getTag(close.tags(), slog::kSlogTagKeyScopeAllocs).valueInt();
+  EXPECT_GE(allocs, 12);
+  EXPECT_GE(getTag(close.tags(), slog::kSlogTagKeyScopeFrees).valueInt(), 12);
+  EXPECT_GE(getTag(close.tags(), slog::kSlogTagKeyScopeAllocBytes).valueInt(),
+            20100);
+  EXPECT_GE(getTag(close.tags(), slog::kSlogTagKeyScopeFreeBytes).valueInt(),
+            20100);
+  EXPECT_LT(getTag(slog_records_[3].tags(), slog::kSlogTagKeyScopeAllocs)
+                .valueInt(),
+            allocs);
+}
+
+TEST_F(SlogTest, scope_watchdog) {
+  slog::SlogScopeWatchdogOptions options;
+  options.check_interval = std::chrono::milliseconds(0);
+  options.default_budget = std::chrono::hours(1);
+  options.budgets["stuck"] = std::chrono::milliseconds(20);
+  slog::SlogScopeWatchdog watchdog(options, SlogContext::getInstance());
+  std::promise<void> opened;
+  std::promise<void> released;
+  std::thread thread([&] {
+    SLOG_SCOPE("outer");
+    SLOG_FAST_SCOPE("stuck");
+    opened.set_value();
+    released.get_future().wait();
+  });
+  opened.get_future().wait();
+
+  const auto stacks = SlogContext::getInstance()->scopeStacks().snapshot();
+  ASSERT_EQ(1, stacks.size());
+  ASSERT_EQ(2, stacks[0].scopes.size());
+  EXPECT_EQ("outer",
+            SlogContext::getInstance()->scopeName(stacks[0].scopes[0].name_id));
+  EXPECT_EQ(1, stacks[0].scopes[0].depth);
+  const slog::SlogOpenScope stuck = stacks[0].scopes[1];
+  EXPECT_EQ("stuck", SlogContext::getInstance()->scopeName(stuck.name_id));
+  EXPECT_EQ(2, stuck.depth);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // Checked after the first flush, the warning is handled by the next ones,
+  // reported once.
+  for (int i = 0; i < 3; ++i) {
+    waitSlog();
+  }
+  std::vector<SlogRecord> warnings;
+  for (const SlogRecord& record : slog_records_) {
+    if (record.find_tag(slog::kSlogTagKeyScopeOpenNs) != nullptr) {
+      warnings.push_back(record);
+    }
+  }
+  ASSERT_EQ(1, warnings.size());
+  const auto& tags = warnings[0].tags();
+  EXPECT_EQ(slog::WARNING, warnings[0].severity());
+  EXPECT_EQ(stacks[0].thread_id,
+            getTag(tags, slog::kSlogTagKeyScopeThreadId).valueInt());
+  EXPECT_EQ(stuck.scope_id,
+            getTag(tags, slog::kSlogTagKeyLateScopeId).valueInt());
+  // Not a scope boundary, e.g. for the trace subscriber.
+  EXPECT_EQ(nullptr, warnings[0].find_tag(kSlogTagKeyScopeId));
+  EXPECT_EQ(stuck.name_id, getTag(tags, kSlogTagKeyScopeNameId).valueInt());
+  EXPECT_GE(getTag(tags, slog::kSlogTagKeyScopeOpenNs).valueInt(), 50000000);
+  EXPECT_EQ(20000000, getTag(tags, slog::kSlogTagKeyScopeBudget).valueInt());
+
+  released.set_value();
+  thread.join();
+  EXPECT_TRUE(SlogContext::getInstance()->scopeStacks().snapshot().empty());
+  // The close records, not to be seen by the next test.
+  waitSlog();
+}
+
+TEST_F(SlogTest, scope_budget) {
+  int32_t plan_scope_id = 0;
+  {
+    SLOG_SCOPE_BUDGET("plan", std::chrono::milliseconds(5));
+    plan_scope_id = SlogContext::getInstance()
+                        ->scopeStacks()
+                        .snapshot()[0]
+                        .scopes.back()
+                        .scope_id;
+    {
+      SLOG_SCOPE("load");
+      // Not a child of plan.
+      SLOG_SCOPE("inner");
+      std::this_thread::sleep_for(std::chrono::milliseconds(4));
+    }
+    for (int i = 0; i < 2; ++i) {
+      SLOG_FAST_SCOPE("solve");
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    SLOG_SCOPE("solve");
+  }
+  {
+    SLOG_SCOPE_BUDGET("quick", std::chrono::seconds(1));
+  }
+  waitSlog();
+  std::vector<SlogRecord> warnings;
+  for (const SlogRecord& record : slog_records_) {
+    if (record.severity() == slog::WARNING) {
+      warnings.push_back(record);
+    }
+  }
+  ASSERT_EQ(1, warnings.size());
+  const auto& tags = warnings[0].tags();
+  EXPECT_EQ(plan_scope_id,
+            getTag(tags, slog::kSlogTagKeyOverrunScopeId).valueInt());
+  EXPECT_EQ(nullptr, warnings[0].find_tag(kSlogTagKeyScopeId));
+  EXPECT_EQ("plan", SlogContext::getInstance()->scopeName(
+                        getTag(tags, kSlogTagKeyScopeNameId).valueInt()));
+  EXPECT_EQ(5000000, getTag(tags, slog::kSlogTagKeyScopeBudget).valueInt());
+  EXPECT_GT(getTag(tags, slog::kSlogTagKeyScopeOverrun).valueInt(), 0);
+  EXPECT_GE(getTag(tags, ".child_ns.load").valueInt(), 4000000);
+  EXPECT_EQ(1, getTag(tags, ".child_count.load").valueInt());
+  EXPECT_GE(getTag(tags, ".child_ns.solve").valueInt(), 4000000);
+  EXPECT_EQ(3, getTag(tags, ".child_count.solve").valueInt());
+  EXPECT_EQ(nullptr, warnings[0].find_tag(".child_ns.inner"));
+  EXPECT_EQ(nullptr, warnings[0].find_tag(kSlogTagKeyScopeDuration));
+}
+
+TEST_F(SlogTest, scope_budget_breakdown_others) {
+  slog::SlogScopeBudget budget(std::chrono::nanoseconds(0));
+  for (int i = 0; i < slog::SlogScopeBudget::kMaxChildren + 2; ++i) {
+    budget.addChild(i, 10);
+    budget.addChild(i, 5);
+  }
+  ASSERT_EQ(slog::SlogScopeBudget::kMaxChildren, budget.num_children);
+  EXPECT_EQ(2, budget.children[0].count);
+  EXPECT_EQ(15, budget.children[0].duration_ns);
+  EXPECT_EQ(4, budget.others.count);
+  EXPECT_EQ(30, budget.others.duration_ns);
+}
+
+// Arguments of the USDT probes of the test binary by "provider:name", from
+// its .note.stapsdt notes.
+std::multimap<std::string, std::string> usdtProbes() {
+  std::ifstream file("/proc/self/exe", std::ios::binary);
+  const std::string elf((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+  const auto* header = reinterpret_cast<const Elf64_Ehdr*>(elf.data());
+  const auto* sections =
+      reinterpret_cast<const Elf64_Shdr*>(elf.data() + header->e_shoff);
+  const char* section_names =
+      elf.data() + sections[header->e_shstrndx].sh_offset;
+  const auto align4 = [](size_t size) { return (size + 3) & ~size_t{3}; };
+  std::multimap<std::string, std::string> probes;
+  for (int i = 0; i < header->e_shnum; ++i) {
+    if (strcmp(section_names + sections[i].sh_name, ".note.stapsdt") != 0) {
+      continue;
+    }
+    size_t offset = sections[i].sh_offset;
+    const size_t end = offset + sections[i].sh_size;
+    while (offset + sizeof(Elf64_Nhdr) <= end) {
+      const auto* note =
+          reinterpret_cast<const Elf64_Nhdr*>(elf.data() + offset);
+      const char* name = elf.data() + offset + sizeof(Elf64_Nhdr);
+      // Addresses of the probe, the base and the semaphore, then strings.
+      const char* provider = name + align4(note->n_namesz) + 3 * 8;
+      const char* probe = provider + strlen(provider) + 1;
+      const char* args = probe + strlen(probe) + 1;
+      if (note->n_type == 3 && strcmp(name, "stapsdt") == 0) {
+        probes.emplace(std::string(provider) + ":" + probe, args);
+      }
+      offset += sizeof(Elf64_Nhdr) + align4(note->n_namesz) +
+                align4(note->n_descsz);
+    }
+  }
+  return probes;
+}
+
+TEST_F(SlogTest, usdt_probes) {
+#if SLOG_USDT_ENABLED
+  SLOG(INFO) << "probed";
+  {
+    SLOG_SCOPE("probed");
+    SLOG_FAST_SCOPE("probed_fast");
+  }
+  waitSlog();
+  const auto probes = usdtProbes();
+  for (const char* probe : {"slog:event", "slog:scope_open",
+                            "slog:scope_close"}) {
+    const auto range = probes.equal_range(probe);
+    ASSERT_NE(range.first, range.second) << probe;
+    for (auto it = range.first; it != range.second; ++it) {
+      // Four or two signed 64-bit arguments.
+      EXPECT_EQ(std::string(probe) == "slog:event" ? 2 : 4,
+                std::count(it->second.begin(), it->second.end(), '@'))
+          << it->second;
+      EXPECT_EQ(0, it->second.find("-8@")) << it->second;
+    }
+  }
+#endif
+}
+
+TEST_F(SlogTest, stats) {
+  auto context = SlogContext::getInstance();
+  const slog::SlogStats before = context->stats();
+  for (int i = 0; i < 10; ++i) {
+    SLOG(INFO).addTag("counted");
+  }
+  { SLOG_FAST_SCOPE("counted_fast"); }
+  waitSlog();
+  const slog::SlogStats after = context->stats();
+  EXPECT_EQ(10, after.records_emitted - before.records_emitted);
+  EXPECT_EQ(10, after.records_enqueued - before.records_enqueued);
+  EXPECT_EQ(2, after.scope_entries_collected - before.scope_entries_collected);
+  EXPECT_EQ(12, after.records_delivered - before.records_delivered);
+  EXPECT_EQ(0, after.queue_depth);
+  EXPECT_GE(after.queue_depth_high_water, 1);
+  EXPECT_GT(after.batches, before.batches);
+  EXPECT_GE(after.batch_size_max, 1);
+  EXPECT_EQ(1, after.flush_waits - before.flush_waits);
+  EXPECT_GT(after.flush_wait_total_ns, before.flush_wait_total_ns);
+  EXPECT_GE(after.flush_wait_total_ns, after.flush_wait_max_ns);
+
+  // The async subscriber of the fixture got every record, timed.
+  ASSERT_EQ(before.subscribers.size(), after.subscribers.size());
+  bool found = false;
+  for (size_t i = 0; i < after.subscribers.size(); ++i) {
+    if (after.subscribers[i].kind == "async" &&
+        after.subscribers[i].calls - before.subscribers[i].calls == 12) {
+      found = true;
+      EXPECT_GT(after.subscribers[i].total_ns, 0);
+      EXPECT_GE(after.subscribers[i].total_ns, after.subscribers[i].max_ns);
+    }
+  }
+  EXPECT_TRUE(found);
+
+  {
+    slog::SlogStatsReporterOptions options;
+    options.interval = std::chrono::milliseconds(0);
+    slog::SlogStatsReporter reporter(options, context);
+    // Reported in the queue iteration of this record, delivered by the next.
+    SLOG(INFO) << "report";
+    waitSlog();
+    waitSlog();
+  }
+  std::vector<SlogRecord> reports;
+  for (const SlogRecord& record : slog_records_) {
+    if (record.find_tag(".stats.records_enqueued") != nullptr) {
+      reports.push_back(record);
+    }
+  }
+  ASSERT_GE(reports.size(), 1);
+  const auto& tags = reports[0].tags();
+  EXPECT_EQ(slog::INFO, reports[0].severity());
+  EXPECT_LE(after.records_enqueued,
+            getTag(tags, ".stats.records_enqueued").valueInt());
+  EXPECT_EQ(slog::SlogTagVerbosity::kSilent,
+            getTag(tags, ".stats.records_enqueued").verbosity());
+  EXPECT_NE(tags.end(),
+            std::find_if(tags.begin(), tags.end(), [](const SlogTag& tag) {
+              return tag.key().find(".stats.subscriber.") == 0 &&
+                     tag.key().find(".async.calls") != std::string::npos;
+            }));
+}
+
 TEST_F(SlogTest, func_block) {
   {
     ASSERT_EQ(0, slog_records_.size());
@@ -483,6 +924,157 @@ TEST_F(SlogTest, races) {
   }
 }
 
+TEST_F(SlogTest, fast_scope) {
+  std::mutex entries_mutex;
+  std::vector<slog::SlogScopeEntry> entries;
+  SlogSubscriber scope_subscriber =
+      SlogContext::getInstance()->createAsyncScopeSubscriber(
+          [&](const std::vector<slog::SlogScopeEntry>& batch) {
+            std::unique_lock<std::mutex> lock(entries_mutex);
+            entries.insert(entries.end(), batch.begin(), batch.end());
+          });
+  int fast_scope_line = -1;
+  {
+    SLOG_FAST_SCOPE("fast_a");
+    fast_scope_line = __LINE__ - 1;
+    EXPECT_EQ(1, SlogScope::currentScopeDepth());
+    {
+      SLOG_SCOPE("scope_b");
+      EXPECT_EQ(2, SlogScope::currentScopeDepth());
+      SLOG(INFO) << "inside";
+    }
+  }
+  EXPECT_EQ(0, SlogScope::currentScopeDepth());
+  waitSlog();
+
+  // The same records as of SLOG_SCOPE. They follow the records queued by
+  // then, which keep their order.
+  ASSERT_EQ(5, slog_records_.size());
+  std::vector<SlogRecord> queued;
+  for (const SlogRecord& record : slog_records_) {
+    const slog::SlogTag* name = record.find_tag(".scope_name");
+    const slog::SlogTag* parent = record.find_tag(kSlogTagKeyScopeParentId);
+    if ((name == nullptr || name->valueString() != "fast_a") &&
+        (parent == nullptr || parent->valueInt() != 0)) {
+      queued.push_back(record);
+    }
+  }
+  ASSERT_EQ(3, queued.size());
+  ASSERT_ASCENDING(true, queued);
+  // In time order they nest with the other records.
+  std::vector<SlogRecord> records = slog_records_;
+  std::stable_sort(records.begin(), records.end(),
+                   [](const SlogRecord& a, const SlogRecord& b) {
+                     return a.time().elapsed_ns < b.time().elapsed_ns;
+                   });
+  const SlogRecord& open = records[0];
+  const SlogCallSite call_site =
+      SlogContext::getInstance()->getCallSite(open.call_site_id());
+  EXPECT_EQ(fast_scope_line, call_site.line());
+  EXPECT_EQ("fast_a", getTag(open.tags(), ".scope_name").valueString());
+  EXPECT_EQ(1, countTags(open.tags(), ".scope_open"));
+  EXPECT_EQ(1, getTag(open.tags(), kSlogTagKeyScopeDepth).valueInt());
+  const int64_t scope_id = getTag(open.tags(), kSlogTagKeyScopeId).valueInt();
+  EXPECT_EQ(scope_id + 1,
+            getTag(records[1].tags(), kSlogTagKeyScopeId).valueInt());
+  EXPECT_EQ(2,
+            getTag(records[1].tags(), kSlogTagKeyScopeDepth).valueInt());
+  const SlogRecord& close = records[4];
+  EXPECT_EQ(0, close.call_site_id());
+  EXPECT_EQ(1, countTags(close.tags(), ".scope_close"));
+  EXPECT_EQ(scope_id, getTag(close.tags(), kSlogTagKeyScopeId).valueInt());
+  EXPECT_EQ(close.time().elapsed_ns - open.time().elapsed_ns,
+            getTag(close.tags(), kSlogTagKeyScopeDuration).valueInt());
+  EXPECT_EQ(0, getTag(close.tags(), kSlogTagKeyScopeParentId).valueInt());
+  EXPECT_EQ(scope_id,
+            getTag(records[3].tags(), kSlogTagKeyScopeParentId)
+                .valueInt());
+  EXPECT_EQ("fast_a",
+            SlogContext::getInstance()->scopeName(
+                getTag(close.tags(), kSlogTagKeyScopeNameId).valueInt()));
+
+  std::unique_lock<std::mutex> lock(entries_mutex);
+  ASSERT_EQ(2, entries.size());
+  EXPECT_TRUE(entries[0].open);
+  EXPECT_FALSE(entries[1].open);
+  EXPECT_EQ(open.thread_id(), entries[0].thread_id);
+  EXPECT_EQ(scope_id, entries[1].scope_id);
+  EXPECT_EQ("fast_a",
+            SlogContext::getInstance()->scopeName(entries[0].name_id));
+  EXPECT_EQ(entries[0].name_id, entries[1].name_id);
+  EXPECT_EQ(entries[1].time.elapsed_ns - entries[0].time.elapsed_ns,
+            entries[1].duration_ns);
+}
+
+TEST_F(SlogTest, fast_scope_threads) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumScopes = 1000;
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < kNumThreads; ++i) {
+    futures.emplace_back(std::async(std::launch::async, [] {
+      for (int j = 0; j < kNumScopes; ++j) {
+        SLOG_FAST_SCOPE("fast");
+      }
+    }));
+  }
+  for (auto& f : futures) {
+    f.get();
+  }
+
+  waitSlog();
+  ASSERT_EQ(2 * kNumThreads * kNumScopes, slog_records_.size());
+  EXPECT_EQ(0, SlogContext::getInstance()->numDroppedScopeEntries());
+  std::map<int64_t, std::vector<SlogRecord>> thread_slog_records;
+  for (const auto& record : slog_records_) {
+    thread_slog_records[record.thread_id()].push_back(record);
+  }
+  EXPECT_EQ(kNumThreads, thread_slog_records.size());
+  for (const auto& item : thread_slog_records) {
+    EXPECT_EQ(2 * kNumScopes, item.second.size());
+    ASSERT_ASCENDING(true, item.second);
+  }
+}
+
+TEST_F(SlogTest, scope_stats) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumScopes = 1000;
+  auto run_scopes = [] {
+    for (int j = 0; j < kNumScopes; ++j) {
+      SLOG_SCOPE_STATS("stats_a");
+      SLOG_SCOPE_STATS("stats_b");
+    }
+  };
+  // Histograms of exited threads stay in the statistics.
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < kNumThreads; ++i) {
+    futures.emplace_back(std::async(std::launch::async, run_scopes));
+  }
+  for (auto& f : futures) {
+    f.get();
+  }
+  run_scopes();
+
+  waitSlog();
+  EXPECT_EQ(0, slog_records_.size());
+  int num_sites = 0;
+  for (const slog::SlogScopeStats& stats :
+       SlogContext::getInstance()->scopeStats().snapshot()) {
+    if (stats.name != "stats_a" && stats.name != "stats_b") {
+      continue;
+    }
+    ++num_sites;
+    const auto& durations = stats.durations_ns;
+    EXPECT_EQ((kNumThreads + 1) * kNumScopes, durations.count());
+    EXPECT_LE(durations.min(), durations.valueAtPercentile(50));
+    EXPECT_LE(durations.valueAtPercentile(50), durations.max());
+    EXPECT_LE(durations.min() * durations.count(), durations.sum());
+    const SlogCallSite call_site =
+        SlogContext::getInstance()->getCallSite(stats.call_site_id);
+    EXPECT_EQ("slog_cc/slog_test.cpp", call_site.file());
+  }
+  EXPECT_EQ(2, num_sites);
+}
+
 TEST_F(SlogTest, severity) {
   SLOG(INFO) << "info";
   waitSlog();
@@ -538,3 +1130,105 @@ TEST_F(SlogTest, slow_callback) {
   }
   // No need to wait for all slog messages to be processed.
 }
+
+TEST_F(SlogTest, batch_subscriber) {
+  std::mutex mutex;
+  std::vector<std::string> messages;
+  size_t num_empty_batches = 0;
+  auto batch_subscriber =
+      SlogContext::getInstance()->createAsyncBatchSubscriber(
+          [&](const std::vector<SlogRecord>& batch) {
+            std::unique_lock<std::mutex> lock(mutex);
+            num_empty_batches += batch.empty();
+            for (const auto& record : batch) {
+              messages.push_back(record.tags().at(0).key());
+            }
+          });
+  SLOG(INFO).addTag("first");
+  SLOG(INFO).addTag("second");
+  waitSlog();
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    EXPECT_EQ((std::vector<std::string>{"first", "second"}), messages);
+  }
+  ASSERT_EQ(2, slog_records_.size());
+
+  // Idle queue runs batch subscribers with empty batches.
+  usleep(1500 * 1000);
+  std::unique_lock<std::mutex> lock(mutex);
+  EXPECT_GT(num_empty_batches, 0);
+}
+
+TEST_F(SlogTest, every_n) {
+  for (int i = 0; i < 10; ++i) {
+    SLOG_EVERY_N(INFO, 4) << "i=" << i;
+  }
+  waitSlog();
+  ASSERT_EQ(3, slog_records_.size());
+  const int32_t call_site_id = slog_records_[0].call_site_id();
+  EXPECT_EQ(__LINE__ - 5,
+            SlogContext::getInstance()->getCallSite(call_site_id).line());
+  EXPECT_EQ("i=0", SlogPrinter().flatText(slog_records_[0]));
+  EXPECT_EQ(0, countTags(slog_records_[0].tags(),
+                         slog::kSlogTagKeySuppressedCount));
+  EXPECT_EQ("i=4", SlogPrinter().flatText(slog_records_[1]));
+  EXPECT_EQ(3, getTag(slog_records_[1].tags(),
+                      slog::kSlogTagKeySuppressedCount)
+                   .valueInt());
+  EXPECT_EQ("i=8", SlogPrinter().flatText(slog_records_[2]));
+  EXPECT_EQ(call_site_id, slog_records_[2].call_site_id());
+}
+
+TEST_F(SlogTest, first_n) {
+  for (int i = 0; i < 10; ++i) {
+    SLOG_FIRST_N(INFO, 3).addTag("i", i);
+  }
+  waitSlog();
+  ASSERT_EQ(3, slog_records_.size());
+  EXPECT_EQ(2, getTag(slog_records_.back().tags(), "i").valueInt());
+
+  // Sampled macros are single statements.
+  if (slog_records_.empty())
+    SLOG_FIRST_N(INFO, 1) << "not emitted";
+  else
+    SLOG(INFO) << "emitted";
+  waitSlog();
+  EXPECT_EQ("emitted", SlogPrinter().flatText(slog_records_.back()));
+}
+
+TEST_F(SlogTest, every_t) {
+  const auto start = std::chrono::steady_clock::now();
+  int num_calls = 0;
+  while (std::chrono::steady_clock::now() - start <
+         std::chrono::milliseconds(250)) {
+    // Arguments of suppressed events are not evaluated.
+    SLOG_EVERY_T(INFO, 0.1).addTag("call", num_calls);
+    ++num_calls;
+    usleep(1000);
+  }
+  waitSlog();
+  // Emitted at 0, 100 and 200 ms, the rest is suppressed and counted.
+  ASSERT_GE(slog_records_.size(), 2);
+  ASSERT_LE(slog_records_.size(), 3);
+  EXPECT_EQ(0, getTag(slog_records_[0].tags(), "call").valueInt());
+  const SlogRecord& second = slog_records_[1];
+  EXPECT_EQ(getTag(second.tags(), "call").valueInt() - 1,
+            getTag(second.tags(), slog::kSlogTagKeySuppressedCount).valueInt());
+}
+
+TEST_F(SlogTest, rate_limited) {
+  std::vector<std::future<void>> futures;
+  for (int t = 0; t < 4; ++t) {
+    futures.emplace_back(std::async(std::launch::async, [] {
+      for (int i = 0; i < 1000; ++i) {
+        SLOG_RATE_LIMITED(INFO, /*rate=*/1.0, /*burst=*/10) << "event";
+      }
+    }));
+  }
+  for (auto& future : futures) {
+    future.wait();
+  }
+  waitSlog();
+  // Only the burst passes at once, no matter how many threads log.
+  EXPECT_EQ(10, slog_records_.size());
+}
@@ -0,0 +1,175 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/transport/collector.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <thread>
+
+#include "slog_cc/transport/shm_transport.h"
+#include "slog_cc/util/string_util.h"
+
+namespace slog {
+
+SlogCollector::SlogCollector(const SlogCollectorOptions& options)
+    : options_(options), writer_(options.sink) {}
+
+void SlogCollector::discover() {
+  DIR* dir = opendir(kSlogShmDirectory);
+  if (dir == nullptr) {
+    return;
+  }
+  while (const dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (!util::startsWith(name, options_.ring_prefix)) {
+      continue;
+    }
+    auto it = producers_.find(name);
+    if (it != producers_.end()) {
+      // A process with a reused pid replaced the ring of an exited one. The
+      // old ring stays until it is drained and its producer is gone.
+      struct stat st;
+      const std::string path = std::string(kSlogShmDirectory) + "/" + name;
+      if (stat(path.c_str(), &st) != 0 ||
+          st.st_ino == it->second->ring.inode()) {
+        continue;
+      }
+      drain(it->second.get());
+      num_dropped_by_removed_ += it->second->ring.numDropped();
+      producers_.erase(it);
+    }
+    std::unique_ptr<Producer> producer(new Producer());
+    // Fails while the producer is still initializing the ring, retried on the
+    // next poll.
+    if (producer->ring.open(name)) {
+      producers_.emplace(name, std::move(producer));
+    }
+  }
+  closedir(dir);
+}
+
+int32_t SlogCollector::mapCallSite(Producer* producer, int32_t call_site_id) {
+  if (call_site_id < 0) {
+    return call_site_id;
+  }
+  if (static_cast<size_t>(call_site_id) >= producer->call_site_ids.size()) {
+    producer->call_site_ids.resize(call_site_id + 1, -1);
+  }
+  int32_t& mapped_id = producer->call_site_ids[call_site_id];
+  if (mapped_id >= 0) {
+    return mapped_id;
+  }
+  const SlogCallSite* call_site = producer->decoder.callSite(call_site_id);
+  const SlogCallSite unknown_call_site("", "", 0);
+  if (call_site == nullptr) {
+    call_site = &unknown_call_site;
+  }
+  const std::string key = call_site->file() + '\0' + call_site->function() +
+                          '\0' + std::to_string(call_site->line());
+  auto it = call_site_ids_.find(key);
+  if (it == call_site_ids_.end()) {
+    it = call_site_ids_.emplace(key, static_cast<int32_t>(call_sites_.size()))
+             .first;
+    call_sites_.push_back(*call_site);
+  }
+  mapped_id = it->second;
+  return mapped_id;
+}
+
+size_t SlogCollector::drain(Producer* producer) {
+  size_t num_records = 0;
+  const char* data = nullptr;
+  size_t size = 0;
+  SlogDecodedBatch batch;
+  while (producer->ring.peek(&data, &size)) {
+    if (size > 0 && (data[0] & kSlogShmMessageReset) != 0) {
+      producer->decoder.reset();
+      producer->call_site_ids.clear();
+    }
+    size_t consumed = 0;
+    if (size == 0 || !producer->decoder.decodeBatch(data + 1, size - 1,
+                                                    &batch, &consumed)) {
+      // The dictionary is out of sync, skip until the producer resets it.
+      std::cerr << "slog: failed to decode a message of "
+                << producer->ring.name() << std::endl;
+      producer->ring.consume();
+      continue;
+    }
+    records_.clear();
+    for (const SlogRecordView& view : batch.records) {
+      SlogRecord record(view.thread_id(),
+                        mapCallSite(producer, view.call_site_id()),
+                        view.severity());
+      record.set_time(view.time());
+      for (const SlogTagView& tag : view) {
+        record.addTag(tag.toTag());
+      }
+      records_.emplace_back(std::move(record));
+    }
+    // Views reference the ring, release the message only after copying.
+    producer->ring.consume();
+    writer_.write(
+        records_,
+        [this](int32_t call_site_id) { return call_sites_[call_site_id]; },
+        static_cast<int32_t>(call_sites_.size()));
+    num_records += records_.size();
+  }
+  return num_records;
+}
+
+size_t SlogCollector::poll() {
+  discover();
+  size_t num_records = 0;
+  for (auto it = producers_.begin(); it != producers_.end();) {
+    Producer* producer = it->second.get();
+    // Check before draining, so records published right before exit are
+    // drained too.
+    const bool gone = producer->ring.producerGone();
+    num_records += drain(producer);
+    if (gone) {
+      num_dropped_by_removed_ += producer->ring.numDropped();
+      producer->ring.unlink();
+      it = producers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // Lets the writer flush on time even when no records come.
+  writer_.write({}, nullptr, 0);
+  num_collected_ += num_records;
+  return num_records;
+}
+
+void SlogCollector::run() {
+  while (!stop_) {
+    if (poll() == 0) {
+      std::this_thread::sleep_for(options_.poll_interval);
+    }
+  }
+  poll();
+  flush();
+}
+
+uint64_t SlogCollector::numDropped() const {
+  uint64_t num_dropped = num_dropped_by_removed_;
+  for (const auto& item : producers_) {
+    num_dropped += item.second->ring.numDropped();
+  }
+  return num_dropped;
+}
+
+}  // namespace slog
@@ -0,0 +1,91 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_transport_collector
+#define slog_cc_transport_collector
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "slog_cc/codec/codec.h"
+#include "slog_cc/primitives/call_site.h"
+#include "slog_cc/primitives/record.h"
+#include "slog_cc/sinks/binary_file_sink.h"
+#include "slog_cc/transport/shm_ring.h"
+
+namespace slog {
+
+struct SlogCollectorOptions {
+  // Rings named <ring_prefix><pid> in kSlogShmDirectory are collected.
+  std::string ring_prefix = kSlogShmRingPrefix;
+  // Where collected records are written.
+  SlogBinaryFileSinkOptions sink;
+  // Sleep between polls when all rings are empty.
+  std::chrono::milliseconds poll_interval{5};
+};
+
+// Drains shared memory rings of SlogShmTransport's of many processes into one
+// binary segment sink. Call site IDs are per process, the collector maps them
+// to its own call site table, so segments are decodable as usual.
+class SlogCollector {
+ public:
+  explicit SlogCollector(const SlogCollectorOptions& options);
+
+  // Finds new rings, drains all rings and removes rings of producers that
+  // exited. Returns the number of collected records.
+  size_t poll();
+
+  // Polls until stop() is called, then drains once more and flushes.
+  void run();
+  void stop() { stop_ = true; }
+
+  // Blocks until collected records are written to files.
+  void flush() { writer_.flush(); }
+
+  size_t numProducers() const { return producers_.size(); }
+  // Messages dropped by producers, including producers already removed.
+  uint64_t numDropped() const;
+  uint64_t numCollected() const { return num_collected_; }
+
+ private:
+  struct Producer {
+    SlogShmRing ring;
+    SlogRecordDecoder decoder;
+    // Producer call site ID -> collector call site ID, -1 if not mapped yet.
+    std::vector<int32_t> call_site_ids;
+  };
+
+  void discover();
+  size_t drain(Producer* producer);
+  int32_t mapCallSite(Producer* producer, int32_t call_site_id);
+
+  const SlogCollectorOptions options_;
+  std::map<std::string, std::unique_ptr<Producer>> producers_;
+  std::vector<SlogCallSite> call_sites_;
+  std::map<std::string, int32_t> call_site_ids_;
+  std::vector<SlogRecord> records_;
+  uint64_t num_dropped_by_removed_ = 0;
+  uint64_t num_collected_ = 0;
+  std::atomic<bool> stop_{false};
+  SlogSegmentWriter writer_;
+};
+
+}  // namespace slog
+
+#endif
@@ -0,0 +1,147 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/transport/collector.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slog_cc/analysis_tools/binlog/slog_binlog_reader.h"
+#include "slog_cc/context/context.h"
+#include "slog_cc/slog.h"
+#include "slog_cc/transport/shm_transport.h"
+
+namespace slog {
+
+class SlogCollectorTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    char dir_template[] = "/tmp/slog_collector_test.XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir_template));
+    collector_options_.ring_prefix =
+        "slog_collector_test." + std::to_string(getpid()) + ".";
+    collector_options_.sink.directory = dir_template;
+    collector_options_.sink.file_prefix = "test";
+    transport_options_.ring_prefix = collector_options_.ring_prefix;
+  }
+
+  void TearDown() override {
+    for (const auto& path :
+         SlogSegmentWriter(collector_options_.sink).listSegments()) {
+      unlink(path.c_str());
+    }
+    rmdir(collector_options_.sink.directory.c_str());
+  }
+
+  // Returns values of the "i" tag of all collected records.
+  std::vector<int64_t> readValues() {
+    SlogLogReader reader;
+    EXPECT_TRUE(reader.open(
+        SlogSegmentWriter(collector_options_.sink).listSegments()));
+    std::vector<int64_t> values;
+    const auto range = reader.query(SlogRecordFilter());
+    for (auto it = range.begin(); it != range.end(); ++it) {
+      const SlogTagView* tag = it->find_tag("i");
+      if (tag == nullptr) {
+        continue;
+      }
+      values.push_back(tag->valueInt());
+      const SlogCallSite* call_site =
+          it.segment().callSite(it->call_site_id());
+      EXPECT_NE(nullptr, call_site);
+      if (call_site != nullptr) {
+        EXPECT_NE(std::string::npos, call_site->file().find("collector_test"));
+      }
+    }
+    return values;
+  }
+
+ protected:
+  SlogCollectorOptions collector_options_;
+  SlogShmTransportOptions transport_options_;
+};
+
+TEST_F(SlogCollectorTest, collect) {
+  SlogCollector collector(collector_options_);
+  {
+    SlogShmTransport transport(transport_options_, SlogContext::getInstance());
+    ASSERT_TRUE(transport.isOpen());
+    for (int i = 0; i < 1000; ++i) {
+      SLOG(INFO).addTag("i", i);
+    }
+    SlogContext::getInstance()->waitAsyncSubscribers();
+    EXPECT_EQ(1000, collector.poll());
+    EXPECT_EQ(1, collector.numProducers());
+
+    for (int i = 1000; i < 2000; ++i) {
+      SLOG(INFO).addTag("i", i);
+    }
+    SlogContext::getInstance()->waitAsyncSubscribers();
+  }
+  // Records published before the transport closed are still collected, then
+  // the ring is removed.
+  EXPECT_EQ(1000, collector.poll());
+  EXPECT_EQ(0, collector.numProducers());
+  EXPECT_EQ(0, collector.numDropped());
+  collector.flush();
+
+  const std::vector<int64_t> values = readValues();
+  ASSERT_EQ(2000, values.size());
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_EQ(i, values[i]);
+  }
+}
+
+TEST_F(SlogCollectorTest, recover_after_drops) {
+  transport_options_.ring_bytes = 4096;
+  transport_options_.max_records_per_message = 4;
+  SlogCollector collector(collector_options_);
+  uint64_t num_dropped_records = 0;
+  {
+    SlogShmTransport transport(transport_options_, SlogContext::getInstance());
+    ASSERT_TRUE(transport.isOpen());
+
+    // The collector doesn't poll, so the ring fills up.
+    for (int i = 0; i < 200; ++i) {
+      SLOG(INFO).addTag("i", i).addTag("payload", std::string(100, 'x'));
+    }
+    SlogContext::getInstance()->waitAsyncSubscribers();
+    num_dropped_records = transport.numDroppedRecords();
+    EXPECT_GT(num_dropped_records, 0);
+    collector.poll();
+    EXPECT_GT(collector.numDropped(), 0);
+
+    // Messages after the drop carry a fresh dictionary and decode fine.
+    for (int i = 200; i < 210; ++i) {
+      SLOG(INFO).addTag("i", i);
+    }
+    SlogContext::getInstance()->waitAsyncSubscribers();
+    EXPECT_EQ(10, collector.poll());
+  }
+  collector.poll();
+  EXPECT_EQ(0, collector.numProducers());
+  collector.flush();
+
+  const std::vector<int64_t> values = readValues();
+  ASSERT_GE(values.size(), 10);
+  EXPECT_EQ(200 - num_dropped_records + 10, values.size());
+  EXPECT_EQ(209, values.back());
+}
+
+}  // namespace slog
@@ -0,0 +1,241 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/transport/shm_ring.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <set>
+
+namespace slog {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'L', 'O', 'G', 'S', 'H', 'M', 0};
+constexpr uint32_t kVersion = 1;
+// Marks the unused tail of the data area, the next message is at offset 0.
+constexpr uint32_t kPadding = 0xffffffff;
+constexpr size_t kFrameHeaderSize = sizeof(uint32_t);
+
+size_t frameSize(size_t payload_size) {
+  return (kFrameHeaderSize + payload_size + 7) & ~static_cast<size_t>(7);
+}
+
+std::string shmPath(const std::string& name) { return "/" + name; }
+
+// Names of rings created by this process, which create() must not replace.
+std::mutex& createdNamesMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::set<std::string>& createdNames() {
+  static std::set<std::string> names;
+  return names;
+}
+
+bool reserveName(const std::string& name) {
+  std::unique_lock<std::mutex> lock(createdNamesMutex());
+  return createdNames().insert(name).second;
+}
+
+void releaseName(const std::string& name) {
+  std::unique_lock<std::mutex> lock(createdNamesMutex());
+  createdNames().erase(name);
+}
+
+}  // namespace
+
+SlogShmRing::~SlogShmRing() {
+  if (header_ != nullptr) {
+    munmap(header_, mapped_size_);
+  }
+  if (created_) {
+    releaseName(name_);
+  }
+}
+
+bool SlogShmRing::map(int fd, size_t size) {
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  struct stat st;
+  if (fstat(fd, &st) == 0) {
+    inode_ = st.st_ino;
+  }
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  header_ = static_cast<SlogShmRingHeader*>(data);
+  data_ = static_cast<char*>(data) + sizeof(SlogShmRingHeader);
+  mapped_size_ = size;
+  return true;
+}
+
+bool SlogShmRing::create(const std::string& name, size_t capacity) {
+  size_t rounded_capacity = 4096;
+  while (rounded_capacity < capacity) {
+    rounded_capacity *= 2;
+  }
+  if (isOpen() || !reserveName(name)) {
+    return false;
+  }
+  name_ = name;
+  created_ = true;
+  // Not a ring of this process, so a stale one left by a crashed process of
+  // the same pid.
+  shm_unlink(shmPath(name_).c_str());
+  const int fd = shm_open(shmPath(name_).c_str(),
+                          O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd == -1) {
+    return false;
+  }
+  const size_t size = sizeof(SlogShmRingHeader) + rounded_capacity;
+  if (ftruncate(fd, size) != 0) {
+    ::close(fd);
+    shm_unlink(shmPath(name_).c_str());
+    return false;
+  }
+  if (!map(fd, size)) {
+    shm_unlink(shmPath(name_).c_str());
+    return false;
+  }
+  // The memory is zero-filled, atomics are constructed in place.
+  new (header_) SlogShmRingHeader();
+  header_->version = kVersion;
+  header_->pid = getpid();
+  header_->capacity = rounded_capacity;
+  header_->write_pos.store(0, std::memory_order_relaxed);
+  header_->read_pos.store(0, std::memory_order_relaxed);
+  header_->num_dropped.store(0, std::memory_order_relaxed);
+  header_->closed.store(0, std::memory_order_relaxed);
+  // Consumers check the magic last, publish it after everything else.
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(header_->magic, kMagic, sizeof(kMagic));
+  return true;
+}
+
+bool SlogShmRing::open(const std::string& name) {
+  name_ = name;
+  const int fd = shm_open(shmPath(name_).c_str(), O_RDWR | O_CLOEXEC, 0);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(SlogShmRingHeader)) {
+    ::close(fd);
+    return false;
+  }
+  if (!map(fd, st.st_size)) {
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t capacity = header_->capacity;
+  if (memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header_->version != kVersion || capacity == 0 ||
+      (capacity & (capacity - 1)) != 0 ||
+      sizeof(SlogShmRingHeader) + capacity > mapped_size_) {
+    munmap(header_, mapped_size_);
+    header_ = nullptr;
+    return false;
+  }
+  next_read_pos_ = header_->read_pos.load(std::memory_order_relaxed);
+  return true;
+}
+
+void SlogShmRing::unlink() { shm_unlink(shmPath(name_).c_str()); }
+
+size_t SlogShmRing::maxMessageSize() const {
+  return header_->capacity / 2 - kFrameHeaderSize;
+}
+
+bool SlogShmRing::write(const char* data, size_t size) {
+  const uint64_t capacity = header_->capacity;
+  const size_t frame_size = frameSize(size);
+  uint64_t pos = header_->write_pos.load(std::memory_order_relaxed);
+  const uint64_t read_pos = header_->read_pos.load(std::memory_order_acquire);
+  const size_t offset = pos & (capacity - 1);
+  const size_t room_to_end = capacity - offset;
+  const size_t padding = room_to_end < frame_size ? room_to_end : 0;
+  if (size > maxMessageSize() ||
+      pos + padding + frame_size - read_pos > capacity) {
+    header_->num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  if (padding > 0) {
+    memcpy(data_ + offset, &kPadding, sizeof(kPadding));
+    pos += padding;
+  }
+  const uint32_t size32 = size;
+  char* frame = data_ + (pos & (capacity - 1));
+  memcpy(frame, &size32, sizeof(size32));
+  memcpy(frame + kFrameHeaderSize, data, size);
+  header_->write_pos.store(pos + frame_size, std::memory_order_release);
+  return true;
+}
+
+bool SlogShmRing::peek(const char** data, size_t* size) {
+  const uint64_t capacity = header_->capacity;
+  uint64_t pos = header_->read_pos.load(std::memory_order_relaxed);
+  const uint64_t write_pos = header_->write_pos.load(std::memory_order_acquire);
+  while (pos != write_pos) {
+    const size_t offset = pos & (capacity - 1);
+    uint32_t frame_size = 0;
+    memcpy(&frame_size, data_ + offset, sizeof(frame_size));
+    if (frame_size == kPadding) {
+      pos += capacity - offset;
+      header_->read_pos.store(pos, std::memory_order_release);
+      continue;
+    }
+    if (frameSize(frame_size) > capacity - offset ||
+        pos + frameSize(frame_size) > write_pos) {
+      return false;
+    }
+    *data = data_ + offset + kFrameHeaderSize;
+    *size = frame_size;
+    next_read_pos_ = pos + frameSize(frame_size);
+    return true;
+  }
+  return false;
+}
+
+void SlogShmRing::consume() {
+  header_->read_pos.store(next_read_pos_, std::memory_order_release);
+}
+
+void SlogShmRing::close() {
+  header_->closed.store(1, std::memory_order_release);
+}
+
+bool SlogShmRing::closed() const {
+  return header_->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool SlogShmRing::producerGone() const {
+  return closed() || (kill(header_->pid, 0) == -1 && errno == ESRCH);
+}
+
+uint64_t SlogShmRing::numDropped() const {
+  return header_->num_dropped.load(std::memory_order_relaxed);
+}
+
+}  // namespace slog
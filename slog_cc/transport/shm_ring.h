@@ -0,0 +1,116 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_transport_shm_ring
+#define slog_cc_transport_shm_ring
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace slog {
+
+// Shared memory objects of rings are named <kSlogShmRingPrefix><pid>, the
+// collector finds them by listing kSlogShmDirectory.
+constexpr char kSlogShmRingPrefix[] = "slog_ring.";
+constexpr char kSlogShmDirectory[] = "/dev/shm";
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "Shared memory rings need lock-free 64-bit atomics.");
+
+// Layout of the beginning of the shared memory object. Positions grow
+// monotonically, the offset in the data area is position % capacity.
+struct SlogShmRingHeader {
+  char magic[8];
+  uint32_t version;
+  // The producer process.
+  int32_t pid;
+  // Size of the data area following the header, a power of 2.
+  uint64_t capacity;
+
+  alignas(64) std::atomic<uint64_t> write_pos;
+  alignas(64) std::atomic<uint64_t> read_pos;
+  // Messages the producer couldn't fit into the ring.
+  alignas(64) std::atomic<uint64_t> num_dropped;
+  // Set by the producer on a clean shutdown.
+  std::atomic<uint32_t> closed;
+};
+
+// A single-producer single-consumer ring of messages in POSIX shared memory.
+// Messages are framed as u32 size + payload, padded to 8 bytes, and never wrap
+// around the end of the data area, so the consumer reads them in place. The
+// producer never blocks: a message that doesn't fit is dropped and counted.
+class SlogShmRing {
+ public:
+  SlogShmRing() = default;
+  ~SlogShmRing();
+  SlogShmRing(const SlogShmRing&) = delete;
+  SlogShmRing& operator=(const SlogShmRing&) = delete;
+
+  // Producer side. Creates the shared memory object `name` (without the
+  // leading slash), replacing a stale one left by a crashed process.
+  // `capacity` is rounded up to a power of 2. Fails if a ring created by this
+  // process with the same name still exists, e.g. a second SlogShmTransport
+  // with the same prefix.
+  bool create(const std::string& name, size_t capacity);
+
+  // Consumer side. Opens a ring created by another process.
+  bool open(const std::string& name);
+
+  // Removes the shared memory object name; the mapping stays valid.
+  void unlink();
+
+  // Producer side. Returns false and counts a drop if the message doesn't fit.
+  bool write(const char* data, size_t size);
+  // Largest message write() may accept.
+  size_t maxMessageSize() const;
+
+  // Consumer side. Returns the next message without consuming it, false if
+  // the ring is empty or corrupted.
+  bool peek(const char** data, size_t* size);
+  // Releases the message returned by the last peek().
+  void consume();
+
+  // Marks the ring as closed by the producer.
+  void close();
+  bool closed() const;
+  // True if the producer is closed or its process doesn't exist anymore.
+  bool producerGone() const;
+
+  bool isOpen() const { return header_ != nullptr; }
+  const std::string& name() const { return name_; }
+  pid_t pid() const { return header_->pid; }
+  uint64_t numDropped() const;
+  // Identity of the shared memory object, changes when a name is reused.
+  ino_t inode() const { return inode_; }
+
+ private:
+  bool map(int fd, size_t size);
+
+  std::string name_;
+  SlogShmRingHeader* header_ = nullptr;
+  char* data_ = nullptr;
+  size_t mapped_size_ = 0;
+  ino_t inode_ = 0;
+  uint64_t next_read_pos_ = 0;
+  // name_ is reserved by create() until destruction.
+  bool created_ = false;
+};
+
+}  // namespace slog
+
+#endif
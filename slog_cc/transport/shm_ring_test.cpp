@@ -0,0 +1,138 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/transport/shm_ring.h"
+
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace slog {
+
+namespace {
+
+std::string ringName() {
+  return "slog_ring_test." + std::to_string(getpid());
+}
+
+}  // namespace
+
+TEST(SlogShmRingTest, write_and_read) {
+  SlogShmRing producer;
+  ASSERT_TRUE(producer.create(ringName(), 4096));
+  SlogShmRing consumer;
+  ASSERT_TRUE(consumer.open(ringName()));
+  consumer.unlink();
+  EXPECT_EQ(getpid(), consumer.pid());
+
+  const char* data = nullptr;
+  size_t size = 0;
+  EXPECT_FALSE(consumer.peek(&data, &size));
+
+  // Messages of varying sizes wrap around the end of the ring many times.
+  for (int i = 0; i < 1000; ++i) {
+    const std::string message(i % 300 + 1, 'a' + i % 26);
+    ASSERT_TRUE(producer.write(message.data(), message.size()));
+    ASSERT_TRUE(consumer.peek(&data, &size));
+    ASSERT_EQ(message, std::string(data, size));
+    consumer.consume();
+    ASSERT_FALSE(consumer.peek(&data, &size));
+  }
+  EXPECT_EQ(0, consumer.numDropped());
+
+  EXPECT_FALSE(consumer.closed());
+  EXPECT_FALSE(consumer.producerGone());
+  producer.close();
+  EXPECT_TRUE(consumer.producerGone());
+}
+
+TEST(SlogShmRingTest, name_in_use) {
+  {
+    SlogShmRing producer;
+    ASSERT_TRUE(producer.create(ringName(), 4096));
+    // The ring of this process isn't replaced.
+    SlogShmRing other;
+    EXPECT_FALSE(other.create(ringName(), 4096));
+    EXPECT_FALSE(other.isOpen());
+    SlogShmRing consumer;
+    ASSERT_TRUE(consumer.open(ringName()));
+    EXPECT_TRUE(producer.write("a", 1));
+    const char* data = nullptr;
+    size_t size = 0;
+    EXPECT_TRUE(consumer.peek(&data, &size));
+  }
+  // The name is free again once the ring is destroyed, the leftover object
+  // is replaced.
+  SlogShmRing producer;
+  ASSERT_TRUE(producer.create(ringName(), 4096));
+  producer.unlink();
+}
+
+TEST(SlogShmRingTest, full_ring_drops) {
+  SlogShmRing producer;
+  ASSERT_TRUE(producer.create(ringName(), 4096));
+  SlogShmRing consumer;
+  ASSERT_TRUE(consumer.open(ringName()));
+  consumer.unlink();
+
+  const std::string message(1000, 'x');
+  int num_written = 0;
+  for (int i = 0; i < 10; ++i) {
+    num_written += producer.write(message.data(), message.size());
+  }
+  EXPECT_EQ(4, num_written);
+  EXPECT_EQ(6, consumer.numDropped());
+  const std::string too_big(producer.maxMessageSize() + 1, 'x');
+  EXPECT_FALSE(producer.write(too_big.data(), too_big.size()));
+
+  // Space is reclaimed as the consumer reads.
+  const char* data = nullptr;
+  size_t size = 0;
+  ASSERT_TRUE(consumer.peek(&data, &size));
+  consumer.consume();
+  EXPECT_TRUE(producer.write(message.data(), message.size()));
+}
+
+TEST(SlogShmRingTest, concurrent) {
+  SlogShmRing producer;
+  ASSERT_TRUE(producer.create(ringName(), 4096));
+  SlogShmRing consumer;
+  ASSERT_TRUE(consumer.open(ringName()));
+  consumer.unlink();
+
+  constexpr int kNumMessages = 10000;
+  std::thread producer_thread([&producer] {
+    for (int i = 0; i < kNumMessages;) {
+      const std::string message = std::to_string(i);
+      if (producer.write(message.data(), message.size())) {
+        ++i;
+      }
+    }
+  });
+  for (int i = 0; i < kNumMessages;) {
+    const char* data = nullptr;
+    size_t size = 0;
+    if (consumer.peek(&data, &size)) {
+      ASSERT_EQ(std::to_string(i), std::string(data, size));
+      consumer.consume();
+      ++i;
+    }
+  }
+  producer_thread.join();
+}
+
+}  // namespace slog
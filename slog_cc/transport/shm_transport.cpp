@@ -0,0 +1,77 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/transport/shm_transport.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "slog_cc/context/context.h"
+
+namespace slog {
+
+SlogShmTransport::SlogShmTransport(const SlogShmTransportOptions& options,
+                                   std::shared_ptr<SlogContext> slog_context,
+                                   std::unique_ptr<SlogBatchFilter> filter)
+    : options_(options),
+      slog_context_(slog_context),
+      filter_stage_(std::move(filter)) {
+  const std::string name = options_.ring_prefix + std::to_string(getpid());
+  if (!ring_.create(name, options_.ring_bytes)) {
+    std::cerr << "slog: failed to create shared memory ring " << name
+              << std::endl;
+    return;
+  }
+  slog_subscriber_ = slog_context_->createAsyncBatchSubscriber(
+      [this](const std::vector<SlogRecord>& records) {
+        publish(filter_stage_.process(records));
+      });
+}
+
+SlogShmTransport::~SlogShmTransport() {
+  // Stop receiving records before the ring is closed.
+  slog_subscriber_.reset();
+  if (ring_.isOpen()) {
+    publish(filter_stage_.flush());
+    ring_.close();
+  }
+}
+
+void SlogShmTransport::publish(const std::vector<SlogRecord>& records) {
+  const SlogCallSiteLookup lookup = [this](int32_t call_site_id) {
+    return slog_context_->getCallSite(call_site_id);
+  };
+  for (size_t i = 0; i < records.size();
+       i += options_.max_records_per_message) {
+    const size_t n =
+        std::min(options_.max_records_per_message, records.size() - i);
+    if (reset_pending_) {
+      encoder_.reset();
+    }
+    message_.assign(1, static_cast<char>(reset_pending_ ? kSlogShmMessageReset
+                                                        : 0));
+    encoder_.encodeBatch(records.data() + i, n, lookup, &message_);
+    if (ring_.write(message_.data(), message_.size())) {
+      reset_pending_ = false;
+    } else {
+      // The dictionary part of the lost message has to be sent again.
+      reset_pending_ = true;
+      num_dropped_records_ += n;
+    }
+  }
+}
+
+}  // namespace slog
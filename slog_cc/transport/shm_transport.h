@@ -0,0 +1,82 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_transport_shm_transport
+#define slog_cc_transport_shm_transport
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "slog_cc/codec/codec.h"
+#include "slog_cc/context/subscribers.h"
+#include "slog_cc/primitives/record.h"
+#include "slog_cc/transport/shm_ring.h"
+
+namespace slog {
+
+class SlogContext;
+
+// A message in the ring is a u8 flags byte followed by one codec batch.
+// kSlogShmMessageReset tells the collector to reset its decoder: the batch
+// starts a new dictionary, e.g. after a message was dropped.
+constexpr uint8_t kSlogShmMessageReset = 1;
+
+struct SlogShmTransportOptions {
+  // The ring is named <ring_prefix><pid>.
+  std::string ring_prefix = kSlogShmRingPrefix;
+  size_t ring_bytes = 4 << 20;
+  // Batches are split into messages of at most this many records.
+  size_t max_records_per_message = 512;
+};
+
+// An async batch subscriber publishing encoded records of a SlogContext into a
+// shared memory ring drained by slog_collector. The per-process cost is
+// encoding plus a memcpy; formatting and file I/O happen in the collector.
+// When the collector falls behind, messages are dropped rather than blocking
+// the process.
+//
+// An optional `filter` runs in front of the ring, see SlogBatchFilterStage.
+class SlogShmTransport {
+ public:
+  SlogShmTransport(const SlogShmTransportOptions& options,
+                   std::shared_ptr<SlogContext> slog_context,
+                   std::unique_ptr<SlogBatchFilter> filter = nullptr);
+  // Marks the ring closed, the collector drains and removes it.
+  ~SlogShmTransport();
+
+  // False if the ring couldn't be created, records are not published then.
+  bool isOpen() const { return ring_.isOpen(); }
+  const std::string& ringName() const { return ring_.name(); }
+  // Records lost because the ring was full.
+  uint64_t numDroppedRecords() const { return num_dropped_records_; }
+
+ private:
+  void publish(const std::vector<SlogRecord>& records);
+
+  const SlogShmTransportOptions options_;
+  std::shared_ptr<SlogContext> slog_context_;
+  SlogShmRing ring_;
+  SlogRecordEncoder encoder_;
+  bool reset_pending_ = true;
+  std::string message_;
+  uint64_t num_dropped_records_ = 0;
+  SlogBatchFilterStage filter_stage_;
+  SlogSubscriber slog_subscriber_;
+};
+
+}  // namespace slog
+
+#endif
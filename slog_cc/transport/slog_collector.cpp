@@ -0,0 +1,85 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Collector daemon draining shared memory rings of processes using
+// SlogShmTransport into one set of binary segment files, e.g.:
+//   slog_collector --directory=/var/log/slog --max_total_mb=1024
+
+#include <signal.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "slog_cc/transport/collector.h"
+#include "slog_cc/util/string_util.h"
+
+namespace {
+
+constexpr char kUsage[] =
+    "Usage: slog_collector [options]\n"
+    "  --directory=<dir>      where segments are written, /tmp by default\n"
+    "  --file_prefix=<name>   segment file prefix, slog by default\n"
+    "  --ring_prefix=<name>   shared memory ring prefix, slog_ring. default\n"
+    "  --max_segment_mb=<mb>  size of one segment\n"
+    "  --max_total_mb=<mb>    disk budget for all segments\n"
+    "  --poll_ms=<ms>         sleep between polls of idle rings\n";
+
+slog::SlogCollector* g_collector = nullptr;
+
+void handleSignal(int) {
+  if (g_collector != nullptr) {
+    g_collector->stop();
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  slog::SlogCollectorOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const std::string value = arg.substr(arg.find('=') + 1);
+    if (slog::util::startsWith(arg, "--directory=")) {
+      options.sink.directory = value;
+    } else if (slog::util::startsWith(arg, "--file_prefix=")) {
+      options.sink.file_prefix = value;
+    } else if (slog::util::startsWith(arg, "--ring_prefix=")) {
+      options.ring_prefix = value;
+    } else if (slog::util::startsWith(arg, "--max_segment_mb=")) {
+      options.sink.max_segment_bytes =
+          std::strtoull(value.c_str(), nullptr, 10) << 20;
+    } else if (slog::util::startsWith(arg, "--max_total_mb=")) {
+      options.sink.max_total_bytes = std::strtoull(value.c_str(), nullptr, 10)
+                                     << 20;
+    } else if (slog::util::startsWith(arg, "--poll_ms=")) {
+      options.poll_interval =
+          std::chrono::milliseconds(std::strtoll(value.c_str(), nullptr, 10));
+    } else {
+      std::cerr << kUsage;
+      return 1;
+    }
+  }
+
+  slog::SlogCollector collector(options);
+  g_collector = &collector;
+  signal(SIGINT, handleSignal);
+  signal(SIGTERM, handleSignal);
+  collector.run();
+  g_collector = nullptr;
+  std::cerr << "slog_collector: collected " << collector.numCollected()
+            << " records, producers dropped " << collector.numDropped()
+            << " messages" << std::endl;
+  return 0;
+}
@@ -0,0 +1,90 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/util/crc32c.h"
+
+#include <cstring>
+
+namespace slog {
+namespace util {
+
+namespace {
+
+// Reversed Castagnoli polynomial.
+constexpr uint32_t kPolynomial = 0x82f63b78;
+
+struct Crc32cTable {
+  uint32_t values[256];
+
+  Crc32cTable() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (kPolynomial & (0 - (crc & 1)));
+      }
+      values[i] = crc;
+    }
+  }
+};
+
+uint32_t crc32cSoftware(const uint8_t* data, size_t size, uint32_t crc) {
+  static const Crc32cTable table;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table.values[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) uint32_t crc32cHardware(const uint8_t* data,
+                                                          size_t size,
+                                                          uint32_t crc) {
+  uint64_t crc64 = crc;
+  while (size >= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = __builtin_ia32_crc32di(crc64, word);
+    data += sizeof(word);
+    size -= sizeof(word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+  while (size > 0) {
+    crc = __builtin_ia32_crc32qi(crc, *data);
+    ++data;
+    --size;
+  }
+  return crc;
+}
+
+bool hasHardwareCrc32c() {
+  static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+  return has_sse42;
+}
+#endif
+
+}  // namespace
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+#if defined(__x86_64__)
+  if (hasHardwareCrc32c()) {
+    return ~crc32cHardware(bytes, size, crc);
+  }
+#endif
+  return ~crc32cSoftware(bytes, size, crc);
+}
+
+}  // namespace util
+}  // namespace slog
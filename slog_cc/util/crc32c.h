@@ -0,0 +1,32 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_util_crc32c
+#define slog_cc_util_crc32c
+
+#include <cstddef>
+#include <cstdint>
+
+namespace slog {
+namespace util {
+
+// CRC-32C (Castagnoli) checksum. Uses the SSE4.2 crc32 instruction when the
+// CPU supports it and a table-driven implementation otherwise. `crc` is the
+// checksum of preceding data to extend, 0 for a new checksum.
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+}  // namespace util
+}  // namespace slog
+
+#endif
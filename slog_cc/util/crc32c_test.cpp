@@ -0,0 +1,41 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "crc32c.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace slog {
+namespace util {
+
+TEST(Crc32c, known_values) {
+  EXPECT_EQ(0u, crc32c("", 0));
+  EXPECT_EQ(0xe3069283u, crc32c("123456789", 9));
+  const std::string zeros(32, '\0');
+  EXPECT_EQ(0x8a9136aau, crc32c(zeros.data(), zeros.size()));
+}
+
+TEST(Crc32c, extend) {
+  const std::string data = "The quick brown fox jumps over the lazy dog";
+  for (size_t split = 0; split <= data.size(); ++split) {
+    EXPECT_EQ(crc32c(data.data(), data.size()),
+              crc32c(data.data() + split, data.size() - split,
+                     crc32c(data.data(), split)));
+  }
+}
+
+}  // namespace util
+}  // namespace slog
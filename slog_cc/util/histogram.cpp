@@ -0,0 +1,109 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slog_cc/util/histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace slog {
+namespace util {
+
+LogLinearHistogram& LogLinearHistogram::operator=(
+    const LogLinearHistogram& other) {
+  if (this != &other) {
+    reset();
+    merge(other);
+  }
+  return *this;
+}
+
+void LogLinearHistogram::merge(const LogLinearHistogram& other) {
+  for (int i = 0; i < kNumBuckets; ++i) {
+    const uint64_t n = other.bucketCount(i);
+    if (n != 0) {
+      add(&counts_[i], n);
+    }
+  }
+  add(&count_, other.count());
+  add(&sum_, other.sum());
+  const uint64_t other_min = other.min_.load(std::memory_order_relaxed);
+  if (other_min < min_.load(std::memory_order_relaxed)) {
+    min_.store(other_min, std::memory_order_relaxed);
+  }
+  if (other.max() > max()) {
+    max_.store(other.max(), std::memory_order_relaxed);
+  }
+}
+
+void LogLinearHistogram::reset() {
+  for (auto& count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  min_.store(UINT64_MAX, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LogLinearHistogram::min() const {
+  const uint64_t min = min_.load(std::memory_order_relaxed);
+  return min == UINT64_MAX && count() == 0 ? 0 : min;
+}
+
+uint64_t LogLinearHistogram::valueAtPercentile(double percentile) const {
+  // Ranks by the bucket counts, count_ may be ahead or behind them while
+  // another thread records.
+  uint64_t total = 0;
+  for (const auto& count : counts_) {
+    total += count.load(std::memory_order_relaxed);
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100;
+  const uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(fraction * total)));
+  if (rank == 1) {
+    return min();
+  }
+  uint64_t cumulative = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    cumulative += bucketCount(i);
+    if (cumulative >= rank) {
+      return std::max(std::min(bucketHighest(i), max()), min());
+    }
+  }
+  return max();
+}
+
+uint64_t LogLinearHistogram::bucketLowest(int index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  const int shift = (index >> kSubBucketBits) - 1;
+  return static_cast<uint64_t>(kSubBuckets + (index & (kSubBuckets - 1)))
+         << shift;
+}
+
+uint64_t LogLinearHistogram::bucketHighest(int index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  const int shift = (index >> kSubBucketBits) - 1;
+  return bucketLowest(index) + ((uint64_t{1} << shift) - 1);
+}
+
+}  // namespace util
+}  // namespace slog
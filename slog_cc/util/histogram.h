@@ -0,0 +1,104 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_util_histogram
+#define slog_cc_util_histogram
+
+#include <atomic>
+#include <cstdint>
+
+#include "slog_cc/util/inline_macro.h"
+
+namespace slog {
+namespace util {
+
+// HDR-style log-linear histogram of uint64_t values: values below kSubBuckets
+// have a bucket each, every power of two range above is split into
+// kSubBuckets equal buckets. A bucket is at most 1/8 of its lowest value
+// wide, so percentiles are within 12.5% of the exact ones, over the whole
+// range in a constant ~4 KB.
+//
+// One thread records, any thread may read or merge it meanwhile: counters are
+// relaxed atomics written with plain loads and stores, so recording costs a
+// few adds and readers see each counter torn-free, if not all of them at the
+// same instant.
+class LogLinearHistogram {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  LogLinearHistogram() = default;
+  LogLinearHistogram(const LogLinearHistogram& other) { merge(other); }
+  LogLinearHistogram& operator=(const LogLinearHistogram& other);
+
+  SLOG_INLINE void record(uint64_t value) {
+    add(&counts_[bucketIndex(value)], 1);
+    add(&count_, 1);
+    add(&sum_, value);
+    if (value < min_.load(std::memory_order_relaxed)) {
+      min_.store(value, std::memory_order_relaxed);
+    }
+    if (value > max_.load(std::memory_order_relaxed)) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  // Adds the values of `other`, which may be recorded by another thread
+  // meanwhile, unlike this one.
+  void merge(const LogLinearHistogram& other);
+  // Must not be called while another thread records.
+  void reset();
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+  // 0 when empty.
+  uint64_t min() const;
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+  // The value `percentile` percent of the values are less than or equal to,
+  // up to the bucket width, e.g. 99.9 for p99.9. 0 when empty.
+  uint64_t valueAtPercentile(double percentile) const;
+
+  uint64_t bucketCount(int index) const {
+    return counts_[index].load(std::memory_order_relaxed);
+  }
+  static SLOG_INLINE int bucketIndex(uint64_t value) {
+    if (value < kSubBuckets) {
+      return static_cast<int>(value);
+    }
+    const int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+    return ((shift + 1) << kSubBucketBits) +
+           static_cast<int>((value >> shift) & (kSubBuckets - 1));
+  }
+  // The range of values of a bucket.
+  static uint64_t bucketLowest(int index);
+  static uint64_t bucketHighest(int index);
+
+ private:
+  static SLOG_INLINE void add(std::atomic<uint64_t>* counter, uint64_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n,
+                   std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> counts_[kNumBuckets] = {};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> min_{UINT64_MAX};
+  std::atomic<uint64_t> max_{0};
+};
+
+}  // namespace util
+}  // namespace slog
+
+#endif
@@ -0,0 +1,77 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "histogram.h"
+
+#include <gtest/gtest.h>
+
+namespace slog {
+namespace util {
+
+TEST(LogLinearHistogram, buckets) {
+  using H = LogLinearHistogram;
+  EXPECT_EQ(0u, H::bucketLowest(0));
+  for (int i = 1; i < H::kNumBuckets; ++i) {
+    // Buckets are contiguous and map back to their index.
+    EXPECT_EQ(H::bucketHighest(i - 1) + 1, H::bucketLowest(i));
+    EXPECT_EQ(i, H::bucketIndex(H::bucketLowest(i)));
+    EXPECT_EQ(i, H::bucketIndex(H::bucketHighest(i)));
+    EXPECT_LE(H::bucketHighest(i) - H::bucketLowest(i),
+              H::bucketLowest(i) / H::kSubBuckets);
+  }
+  EXPECT_EQ(UINT64_MAX, H::bucketHighest(H::kNumBuckets - 1));
+}
+
+TEST(LogLinearHistogram, percentiles) {
+  LogLinearHistogram histogram;
+  EXPECT_EQ(0u, histogram.valueAtPercentile(50));
+  EXPECT_EQ(0u, histogram.min());
+  for (uint64_t value = 1; value <= 1000; ++value) {
+    histogram.record(value * 1000);
+  }
+  EXPECT_EQ(1000u, histogram.count());
+  EXPECT_EQ(500500000u, histogram.sum());
+  EXPECT_EQ(1000u, histogram.min());
+  EXPECT_EQ(1000000u, histogram.max());
+  for (const double percentile : {1.0, 50.0, 90.0, 99.0, 99.9}) {
+    const double exact = percentile * 10000;
+    EXPECT_GE(histogram.valueAtPercentile(percentile), exact);
+    EXPECT_LE(histogram.valueAtPercentile(percentile), exact * 1.125);
+  }
+  EXPECT_EQ(1000000u, histogram.valueAtPercentile(100));
+  EXPECT_EQ(1000u, histogram.valueAtPercentile(0));
+}
+
+TEST(LogLinearHistogram, merge) {
+  LogLinearHistogram a;
+  LogLinearHistogram b;
+  a.record(5);
+  b.record(3);
+  b.record(1 << 20);
+  a.merge(b);
+  EXPECT_EQ(3u, a.count());
+  EXPECT_EQ(3u, a.min());
+  EXPECT_EQ(1u << 20, a.max());
+  EXPECT_EQ(5u, a.valueAtPercentile(50));
+
+  LogLinearHistogram copy = a;
+  a.reset();
+  EXPECT_EQ(0u, a.count());
+  EXPECT_EQ(3u, copy.count());
+  EXPECT_EQ(a.bucketCount(LogLinearHistogram::bucketIndex(5)), 0u);
+  EXPECT_EQ(copy.bucketCount(LogLinearHistogram::bucketIndex(5)), 1u);
+}
+
+}  // namespace util
+}  // namespace slog
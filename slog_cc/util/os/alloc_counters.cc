@@ -0,0 +1,24 @@
+#include "alloc_counters.h"
+
+namespace slog {
+namespace util {
+namespace os {
+
+namespace {
+
+// Zero-initialized without a constructor and in the static TLS block, so the
+// malloc hooks can update it without allocating, even on thread startup.
+thread_local AllocCounters counters __attribute__((tls_model("initial-exec")));
+bool installed = false;
+
+}  // namespace
+
+AllocCounters* thread_alloc_counters() { return &counters; }
+
+bool alloc_hooks_installed() { return installed; }
+
+void set_alloc_hooks_installed() { installed = true; }
+
+}  // namespace os
+}  // namespace util
+}  // namespace slog
@@ -0,0 +1,32 @@
+#ifndef slog_cc_util_os_alloc_counters
+#define slog_cc_util_os_alloc_counters
+
+#include <cstdint>
+
+namespace slog {
+namespace util {
+namespace os {
+
+// Heap allocations of a thread so far. Byte counts are usable sizes of the
+// blocks, so that the bytes of an allocation and of its free match.
+struct AllocCounters {
+  uint64_t allocs;
+  uint64_t frees;
+  uint64_t allocated_bytes;
+  uint64_t freed_bytes;
+};
+
+// Counters of the calling thread, updated by the malloc interposition of the
+// alloc_hooks target. They stay 0 when it isn't linked into the binary.
+AllocCounters* thread_alloc_counters();
+
+// Whether the alloc_hooks target is linked into the binary.
+bool alloc_hooks_installed();
+// Called by alloc_hooks during static initialization.
+void set_alloc_hooks_installed();
+
+}  // namespace os
+}  // namespace util
+}  // namespace slog
+
+#endif
@@ -0,0 +1,4 @@
+#include "../alloc_counters.h"
+
+// The QNX libc has no entry points to forward interposed malloc calls to, so
+// allocations aren't counted and alloc_hooks_installed() stays false.
@@ -0,0 +1,24 @@
+#include "../perf_counters.h"
+
+namespace slog {
+namespace util {
+namespace os {
+
+// QNX has no perf events, there are never counters.
+ThreadPerfCounters::ThreadPerfCounters() {}
+
+ThreadPerfCounters::~ThreadPerfCounters() {}
+
+bool ThreadPerfCounters::read(uint64_t* values) const {
+  (void)values;
+  return false;
+}
+
+ThreadPerfCounters* thread_perf_counters() {
+  thread_local ThreadPerfCounters counters;
+  return &counters;
+}
+
+}  // namespace os
+}  // namespace util
+}  // namespace slog
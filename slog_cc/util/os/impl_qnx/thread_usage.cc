@@ -0,0 +1,21 @@
+#include "../thread_usage.h"
+
+#include <time.h>
+
+namespace slog {
+namespace util {
+namespace os {
+
+// QNX has no per thread rusage, only the CPU time is filled.
+bool get_thread_usage(ThreadUsage* usage) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return false;
+  }
+  usage->cpu_ns = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+  return true;
+}
+
+}  // namespace os
+}  // namespace util
+}  // namespace slog
@@ -0,0 +1,111 @@
+#include <errno.h>
+#include <malloc.h>
+
+#include "../alloc_counters.h"
+
+// glibc allocator entry points, the interposed functions below forward to
+// them.
+extern "C" {
+void* __libc_malloc(size_t size);
+void __libc_free(void* ptr);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+}
+
+namespace {
+
+using slog::util::os::AllocCounters;
+using slog::util::os::thread_alloc_counters;
+
+inline void countAlloc(void* ptr) {
+  if (ptr != nullptr) {
+    AllocCounters* counters = thread_alloc_counters();
+    ++counters->allocs;
+    counters->allocated_bytes += malloc_usable_size(ptr);
+  }
+}
+
+inline void countFree(size_t usable_size) {
+  AllocCounters* counters = thread_alloc_counters();
+  ++counters->frees;
+  counters->freed_bytes += usable_size;
+}
+
+const bool installed = (slog::util::os::set_alloc_hooks_installed(), true);
+
+}  // namespace
+
+// Every allocation function of glibc is interposed, so that a block is
+// counted the same way when allocated and freed. A realloc counts as a free
+// of the old block and an allocation of the new one, even in place.
+extern "C" {
+
+void* malloc(size_t size) {
+  void* ptr = __libc_malloc(size);
+  countAlloc(ptr);
+  return ptr;
+}
+
+void free(void* ptr) {
+  if (ptr != nullptr) {
+    countFree(malloc_usable_size(ptr));
+    __libc_free(ptr);
+  }
+}
+
+void* calloc(size_t count, size_t size) {
+  void* ptr = __libc_calloc(count, size);
+  countAlloc(ptr);
+  return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+  const size_t old_size = ptr != nullptr ? malloc_usable_size(ptr) : 0;
+  void* new_ptr = __libc_realloc(ptr, size);
+  // On failure the old block is kept, unless the size is 0.
+  if (ptr != nullptr && (new_ptr != nullptr || size == 0)) {
+    countFree(old_size);
+  }
+  countAlloc(new_ptr);
+  return new_ptr;
+}
+
+void* memalign(size_t alignment, size_t size) {
+  void* ptr = __libc_memalign(alignment, size);
+  countAlloc(ptr);
+  return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+  if (alignment % sizeof(void*) != 0 ||
+      (alignment & (alignment - 1)) != 0 || alignment == 0) {
+    return EINVAL;
+  }
+  void* ptr = memalign(alignment, size);
+  if (ptr == nullptr) {
+    return ENOMEM;
+  }
+  *out = ptr;
+  return 0;
+}
+
+void* valloc(size_t size) {
+  void* ptr = __libc_valloc(size);
+  countAlloc(ptr);
+  return ptr;
+}
+
+void* pvalloc(size_t size) {
+  void* ptr = __libc_pvalloc(size);
+  countAlloc(ptr);
+  return ptr;
+}
+
+}  // extern "C"
@@ -0,0 +1,160 @@
+#include "../perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace slog {
+namespace util {
+namespace os {
+
+namespace {
+
+struct CounterConfig {
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr CounterConfig kHardwareCounters[ThreadPerfCounters::kNumCounters] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+constexpr CounterConfig kSoftwareCounters[ThreadPerfCounters::kNumCounters] = {
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+int perfEventOpen(const CounterConfig& counter, int group_fd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = counter.type;
+  attr.config = counter.config;
+  attr.read_format = PERF_FORMAT_GROUP;
+  // Counting user space only works with perf_event_paranoid up to 2, the
+  // usual default.
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attr, /*pid=*/0, /*cpu=*/-1, group_fd,
+                 PERF_FLAG_FD_CLOEXEC);
+}
+
+}  // namespace
+
+ThreadPerfCounters::ThreadPerfCounters() {
+  for (int& fd : fds_) {
+    fd = -1;
+  }
+  if (!open(Kind::kHardware)) {
+    open(Kind::kSoftware);
+  }
+}
+
+ThreadPerfCounters::~ThreadPerfCounters() { close(); }
+
+bool ThreadPerfCounters::open(Kind kind) {
+  const CounterConfig* counters =
+      kind == Kind::kHardware ? kHardwareCounters : kSoftwareCounters;
+  for (int i = 0; i < kNumCounters; ++i) {
+    fds_[i] = perfEventOpen(counters[i], i == 0 ? -1 : fds_[0]);
+    if (fds_[i] < 0) {
+      close();
+      return false;
+    }
+  }
+  kind_ = kind;
+#if defined(__x86_64__) || defined(__i386__)
+  if (kind == Kind::kHardware) {
+    for (int i = 0; i < kNumCounters; ++i) {
+      void* page = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED,
+                        fds_[i], 0);
+      pages_[i] = page == MAP_FAILED ? nullptr : page;
+    }
+  }
+#endif
+  return true;
+}
+
+void ThreadPerfCounters::close() {
+  for (int i = 0; i < kNumCounters; ++i) {
+    if (pages_[i] != nullptr) {
+      munmap(pages_[i], sysconf(_SC_PAGESIZE));
+      pages_[i] = nullptr;
+    }
+    if (fds_[i] >= 0) {
+      ::close(fds_[i]);
+      fds_[i] = -1;
+    }
+  }
+  kind_ = Kind::kNone;
+}
+
+bool ThreadPerfCounters::read(uint64_t* values) const {
+  if (kind_ == Kind::kNone) {
+    return false;
+  }
+  if (readRdpmc(values)) {
+    return true;
+  }
+  uint64_t buffer[1 + kNumCounters];
+  if (::read(fds_[0], buffer, sizeof(buffer)) !=
+          static_cast<ssize_t>(sizeof(buffer)) ||
+      buffer[0] != kNumCounters) {
+    return false;
+  }
+  memcpy(values, buffer + 1, sizeof(uint64_t) * kNumCounters);
+  return true;
+}
+
+// The self-monitoring sequence of perf_event_mmap_page in
+// linux/perf_event.h.
+bool ThreadPerfCounters::readRdpmc(uint64_t* values) const {
+#if defined(__x86_64__) || defined(__i386__)
+  for (int i = 0; i < kNumCounters; ++i) {
+    const auto* page = static_cast<volatile perf_event_mmap_page*>(pages_[i]);
+    if (page == nullptr) {
+      return false;
+    }
+    uint32_t seq;
+    do {
+      seq = page->lock;
+      __atomic_signal_fence(__ATOMIC_SEQ_CST);
+      const uint32_t index = page->index;
+      if (!page->cap_user_rdpmc || index == 0) {
+        return false;
+      }
+      const uint16_t width = page->pmc_width;
+      int64_t count = __rdpmc(index - 1);
+      count <<= 64 - width;
+      count >>= 64 - width;
+      values[i] = page->offset + count;
+      __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    } while (page->lock != seq);
+  }
+  return true;
+#else
+  (void)values;
+  return false;
+#endif
+}
+
+ThreadPerfCounters* thread_perf_counters() {
+  thread_local ThreadPerfCounters counters;
+  return &counters;
+}
+
+}  // namespace os
+}  // namespace util
+}  // namespace slog
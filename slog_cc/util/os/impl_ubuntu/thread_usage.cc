@@ -0,0 +1,27 @@
+#include "../thread_usage.h"
+
+#include <sys/resource.h>
+#include <time.h>
+
+namespace slog {
+namespace util {
+namespace os {
+
+bool get_thread_usage(ThreadUsage* usage) {
+  struct timespec ts;
+  struct rusage ru;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0 ||
+      getrusage(RUSAGE_THREAD, &ru) != 0) {
+    return false;
+  }
+  usage->cpu_ns = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+  usage->voluntary_switches = ru.ru_nvcsw;
+  usage->involuntary_switches = ru.ru_nivcsw;
+  usage->minor_faults = ru.ru_minflt;
+  usage->major_faults = ru.ru_majflt;
+  return true;
+}
+
+}  // namespace os
+}  // namespace util
+}  // namespace slog
@@ -0,0 +1,55 @@
+#ifndef slog_cc_util_os_perf_counters
+#define slog_cc_util_os_perf_counters
+
+#include <cstdint>
+
+namespace slog {
+namespace util {
+namespace os {
+
+// A perf_event group counting the calling thread in user space.
+class ThreadPerfCounters {
+ public:
+  static constexpr int kNumCounters = 4;
+
+  enum class Kind {
+    // perf events are unavailable, e.g. in a container without them.
+    kNone,
+    // Task clock ns, context switches, CPU migrations, page faults, where
+    // there is no PMU, e.g. in most VMs.
+    kSoftware,
+    // Cycles, instructions, cache misses, branch misses.
+    kHardware,
+  };
+
+  // Opens hardware counters, software ones if they fail, none if both fail.
+  ThreadPerfCounters();
+  ~ThreadPerfCounters();
+  ThreadPerfCounters(const ThreadPerfCounters&) = delete;
+  ThreadPerfCounters& operator=(const ThreadPerfCounters&) = delete;
+
+  Kind kind() const { return kind_; }
+  // Reads kNumCounters values in the order of kind(): with rdpmc when the
+  // kernel allows it for hardware counters, no syscall; with one read() of
+  // the group otherwise. Returns false with no counters or on failure.
+  bool read(uint64_t* values) const;
+
+ private:
+  bool open(Kind kind);
+  void close();
+  bool readRdpmc(uint64_t* values) const;
+
+  Kind kind_ = Kind::kNone;
+  int fds_[kNumCounters];
+  // perf_event_mmap_page of each counter for rdpmc, nullptr if not mapped.
+  void* pages_[kNumCounters] = {};
+};
+
+// Counters of the calling thread, opened on first use.
+ThreadPerfCounters* thread_perf_counters();
+
+}  // namespace os
+}  // namespace util
+}  // namespace slog
+
+#endif
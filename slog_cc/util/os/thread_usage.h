@@ -0,0 +1,28 @@
+#ifndef slog_cc_util_os_thread_usage
+#define slog_cc_util_os_thread_usage
+
+#include <cstdint>
+
+namespace slog {
+namespace util {
+namespace os {
+
+// Resources used by a thread so far.
+struct ThreadUsage {
+  int64_t cpu_ns = 0;
+  int64_t voluntary_switches = 0;
+  int64_t involuntary_switches = 0;
+  int64_t minor_faults = 0;
+  int64_t major_faults = 0;
+};
+
+// Fills usage of a current thread: CLOCK_THREAD_CPUTIME_ID and
+// getrusage(RUSAGE_THREAD), two syscalls. Counters the OS doesn't track per
+// thread stay 0. Returns false on failure.
+bool get_thread_usage(ThreadUsage* usage);
+
+}  // namespace os
+}  // namespace util
+}  // namespace slog
+
+#endif
@@ -0,0 +1,99 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_util_usdt
+#define slog_cc_util_usdt
+
+#include <cstdint>
+
+// USDT (user space statically defined tracing) probes in the format of
+// SystemTap's sys/sdt.h, for bpftrace, perf, BCC, e.g.
+//   bpftrace -e 'usdt:./binary:slog:event { @[arg0] = count(); }'
+// A probe is a nop where the probe is placed, and an ELF note in the
+// .note.stapsdt section with the address of the nop and where its arguments
+// are (registers, memory or constants). An attached tracer replaces the nop
+// with a breakpoint. There are no semaphores: arguments are computed whether
+// a tracer is attached or not, so they must be cheap.
+//
+// Arguments are int64_t. Build with -DSLOG_NO_USDT to drop the probes.
+#if !defined(SLOG_NO_USDT) && defined(__ELF__) && \
+    (defined(__x86_64__) || defined(__aarch64__))
+
+#define SLOG_USDT_ENABLED 1
+
+// The note of a probe of the slog provider, and the .stapsdt.base section
+// tracers use to find the load bias of the binary. The note is in the COMDAT
+// group of the code ("?"), so it goes away with a discarded inline function.
+#define _SLOG_USDT_ASM(name, args)                                  \
+  "990: nop\n"                                                      \
+  ".pushsection .note.stapsdt,\"?\",\"note\"\n"                     \
+  ".balign 4\n"                                                     \
+  ".4byte 992f-991f, 994f-993f, 3\n"                                \
+  "991: .asciz \"stapsdt\"\n"                                       \
+  "992: .balign 4\n"                                                \
+  "993: .8byte 990b\n"                                              \
+  ".8byte _.stapsdt.base\n"                                         \
+  ".8byte 0\n"                                                      \
+  ".asciz \"slog\"\n"                                               \
+  ".asciz \"" #name "\"\n"                                          \
+  ".asciz \"" args "\"\n"                                           \
+  "994: .balign 4\n"                                                \
+  ".popsection\n"                                                   \
+  ".ifndef _.stapsdt.base\n"                                        \
+  ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+  ".weak _.stapsdt.base\n"                                          \
+  ".hidden _.stapsdt.base\n"                                        \
+  "_.stapsdt.base: .space 1\n"                                      \
+  ".size _.stapsdt.base, 1\n"                                       \
+  ".popsection\n"                                                   \
+  ".endif\n"
+
+#define _SLOG_USDT_ARG(index, value) \
+  [a##index] "nor"(static_cast<int64_t>(value))
+
+#define SLOG_USDT2(name, a0, a1)                                     \
+  __asm__ __volatile__(_SLOG_USDT_ASM(name, "-8@%[a0] -8@%[a1]")     \
+                       :                                             \
+                       : _SLOG_USDT_ARG(0, a0), _SLOG_USDT_ARG(1, a1))
+
+#define SLOG_USDT3(name, a0, a1, a2)                                    \
+  __asm__ __volatile__(                                                 \
+      _SLOG_USDT_ASM(name, "-8@%[a0] -8@%[a1] -8@%[a2]")                \
+      :                                                                 \
+      : _SLOG_USDT_ARG(0, a0), _SLOG_USDT_ARG(1, a1), _SLOG_USDT_ARG(2, a2))
+
+#define SLOG_USDT4(name, a0, a1, a2, a3)                                \
+  __asm__ __volatile__(                                                 \
+      _SLOG_USDT_ASM(name, "-8@%[a0] -8@%[a1] -8@%[a2] -8@%[a3]")       \
+      :                                                                 \
+      : _SLOG_USDT_ARG(0, a0), _SLOG_USDT_ARG(1, a1), _SLOG_USDT_ARG(2, a2), \
+        _SLOG_USDT_ARG(3, a3))
+
+#else
+
+#define SLOG_USDT_ENABLED 0
+
+#define SLOG_USDT2(name, a0, a1) \
+  do {                           \
+  } while (false)
+#define SLOG_USDT3(name, a0, a1, a2) \
+  do {                               \
+  } while (false)
+#define SLOG_USDT4(name, a0, a1, a2, a3) \
+  do {                                   \
+  } while (false)
+
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+// Copyright 2022 Woven Planet Holdings
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef slog_cc_util_varint
+#define slog_cc_util_varint
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "slog_cc/util/inline_macro.h"
+
+namespace slog {
+namespace util {
+
+// LEB128 variable-length integers: 7 bits per byte, high bit set on all bytes
+// but the last one. Small values (IDs, short lengths, small deltas) take a
+// single byte.
+SLOG_INLINE void appendVarint(uint64_t value, std::string* out) {
+  char buffer[10];
+  size_t n = 0;
+  while (value >= 0x80) {
+    buffer[n++] = static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  buffer[n++] = static_cast<char>(value);
+  out->append(buffer, n);
+}
+
+// Reads a varint at *pos and advances *pos past it. Returns false if the
+// buffer ends in the middle of the value or the value is longer than 64 bits.
+SLOG_INLINE bool readVarint(const char** pos, const char* end,
+                            uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(*(*pos)++);
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Zigzag mapping keeps small negative numbers small when varint encoded:
+// 0 -> 0, -1 -> 1, 1 -> 2, -2 -> 3, ...
+SLOG_INLINE uint64_t zigzagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+SLOG_INLINE int64_t zigzagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Fixed width little-endian values. Slog targets little-endian platforms only
+// (x86-64 and aarch64), so these are plain memcpy's.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "slog binary encoding assumes a little-endian host.");
+
+template <class T>
+SLOG_INLINE void appendFixed(T value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+SLOG_INLINE bool readFixed(const char** pos, const char* end, T* value) {
+  if (end - *pos < static_cast<ptrdiff_t>(sizeof(T))) {
+    return false;
+  }
+  memcpy(value, *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+
+// Length-prefixed byte strings.
+SLOG_INLINE void appendLengthPrefixed(const char* data, size_t size,
+                                      std::string* out) {
+  appendVarint(size, out);
+  out->append(data, size);
+}
+
+SLOG_INLINE bool readLengthPrefixed(const char** pos, const char* end,
+                                    const char** data, size_t* size) {
+  uint64_t n = 0;
+  if (!readVarint(pos, end, &n) || static_cast<uint64_t>(end - *pos) < n) {
+    return false;
+  }
+  *data = *pos;
+  *size = n;
+  *pos += n;
+  return true;
+}
+
+}  // namespace util
+}  // namespace slog
+
+#endif
@@ -93,9 +93,10 @@ class SlogPyTest(unittest.TestCase):
             self.assertTrue(call_site.file().endswith('slog_py/slog_test.py'))
             self.assertEqual(81, call_site.line())
             self.assertEqual('test_scope', call_site.function())
-            self.assertEqual(5, len(record_0['tags']))
+            self.assertEqual(6, len(record_0['tags']))
             self.assertEqual('.scope_name', record_0['tags'][0]['key'])
             self.assertEqual('foo_scope', record_0['tags'][0]['valueString'])
+            self.assertEqual('.scope_name_id', record_0['tags'][5]['key'])
 
             record_1 = json.loads(str(records[1]))
             self.assertEqual(1, len(record_1['tags']))
@@ -103,8 +104,7 @@ class SlogPyTest(unittest.TestCase):
             self.assertEqual(1.5, float(record_1['tags'][0]['valueDouble']))
 
             record_2 = json.loads(str(records[2]))
-            self.assertEqual(0, int(record_2['call_site_id']))
-            self.assertEqual(2, len(record_2['tags']))
+            self.assertScopeClose(record_0, record_2)
 
     def test_scope_decorator(self):
         with SlogBuffer(slog.SlogContext.get_instance()) as slog_buffer:
@@ -125,9 +125,10 @@ class SlogPyTest(unittest.TestCase):
             self.assertTrue(call_site.file().endswith('slog_py/slog_test.py'))
             self.assertEqual(114, call_site.line())
             self.assertEqual('test_scope_decorator', call_site.function())
-            self.assertEqual(4, len(record_0['tags']))
+            self.assertEqual(5, len(record_0['tags']))
             self.assertEqual('.scope_name', record_0['tags'][0]['key'])
             self.assertEqual('decorated_f', record_0['tags'][0]['valueString'])
+            self.assertEqual('.scope_name_id', record_0['tags'][4]['key'])
 
             record_1 = json.loads(str(records[1]))
             self.assertEqual(1, len(record_1['tags']))
@@ -135,8 +136,7 @@ class SlogPyTest(unittest.TestCase):
             self.assertEqual('msg: msg1', record_1['tags'][0]['valueString'])
 
             record_2 = json.loads(str(records[2]))
-            self.assertEqual(0, int(record_2['call_site_id']))
-            self.assertEqual(2, len(record_2['tags']))
+            self.assertScopeClose(record_0, record_2)
 
     def test_scope_with_exception(self):
         with SlogBuffer(slog.SlogContext.get_instance()) as slog_buffer:
@@ -160,13 +160,37 @@ class SlogPyTest(unittest.TestCase):
             self.assertTrue(call_site.file().endswith('slog_py/slog_test.py'))
             self.assertEqual(144, call_site.line())
             self.assertEqual('test_scope_with_exception', call_site.function())
-            self.assertEqual(4, len(record_0['tags']))
+            self.assertEqual(5, len(record_0['tags']))
             self.assertEqual('.scope_name', record_0['tags'][0]['key'])
             self.assertEqual('fooz_scope', record_0['tags'][0]['valueString'])
+            self.assertEqual('.scope_name_id', record_0['tags'][4]['key'])
 
             record_1 = json.loads(str(records[1]))
-            self.assertEqual(0, int(record_1['call_site_id']))
-            self.assertEqual(2, len(record_1['tags']))
+            self.assertScopeClose(record_0, record_1)
+
+    def assertScopeClose(self, record_open, record_close):
+        # The close record carries the scope ID, the name ID of the open
+        # record, the parent scope ID and the duration, see scope_close in
+        # slog_cc/slog_test.cpp.
+        self.assertEqual(0, int(record_close['call_site_id']))
+        self.assertEqual(
+            ['.scope_close', '.scope_id', '.scope_name_id',
+             '.parent_scope_id', '.duration_ns'],
+            [tag['key'] for tag in record_close['tags']])
+
+        def value(record, key):
+            tag = next(t for t in record['tags'] if t['key'] == key)
+            return int(tag['valueInt'])
+
+        self.assertEqual(value(record_open, '.scope_id'),
+                         value(record_close, '.scope_id'))
+        name_id = value(record_open, '.scope_name_id')
+        self.assertLessEqual(0, name_id)
+        self.assertEqual(name_id, value(record_close, '.scope_name_id'))
+        self.assertEqual(0, value(record_close, '.parent_scope_id'))
+        self.assertEqual(int(record_close['time']['elapsed_ns']) -
+                         int(record_open['time']['elapsed_ns']),
+                         value(record_close, '.duration_ns'))
 
 
 if __name__ == '__main__':